@@ -36,6 +36,8 @@ SECTIONS
     .init_array : > FLASH
 
     .vtable :   > 0x20000000
+    /* control hot path (ramfunc.h), copied to SRAM by ramfunc_copy at the start of main */
+    .ramfunc :  LOAD = FLASH, RUN = SRAM, LOAD_START(ramfuncLoadStart), RUN_START(ramfuncRunStart), SIZE(ramfuncSize)
     .data   :   > SRAM
     .bss    :   > SRAM
     .sysmem :   > SRAM
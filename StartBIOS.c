@@ -28,13 +28,32 @@
 #include <Board.h>
 #include <EK_TM4C1294XL.h>
 
+#include <blackbox.h>
 #include <bluetooth.h>
+#include <config.h>
+#include <console.h>
+#include <control.h>
+#include <deadline.h>
+#include <display.h>
+#include <executor.h>
 #include <joystick.h>
+#include <metrics.h>
+#include <ramfunc.h>
+#include <rcout.h>
+#include <relay.h>
+#include <sysmon.h>
+#include <trace.h>
+#include <udpbridge.h>
+#include <usbcdc.h>
 
 int main(void)
 {
     //Clock auf 120MHZ setzen
     SysCtlClockFreqSet(SYSCTL_XTAL_25MHZ | SYSCTL_OSC_MAIN | SYSCTL_USE_PLL | SYSCTL_CFG_VCO_480, 120000000);
+    //start of the boot time measurement, the timestamp counter runs with the final clock from here
+    sysmon_bootStart();
+    //hot path into SRAM before any of its interrupts or clocks can run
+    ramfunc_copy();
 
     //Aktivieren Port C
      SysCtlPeripheralEnable(SYSCTL_PERIPH_GPIOC);
@@ -49,8 +68,24 @@ int main(void)
     (void)ui32SysClock;
     Board_initI2C();
     Board_initGPIO();
+    Board_initWatchdog();
+    Board_initSDSPI();
+    Board_initUSB(Board_USBDEVICE);
+    Board_initEMAC();
+    Board_initDMA();
+
+    //stored configuration before all modules that read it
+    config_init();
+
+    //executor first, the other modules add their jobs to it
+    setUpHousekeeping_Task();
 
     setup_UART();
+    setUpConsole_Task();
+    setUpRelay();
+    metrics_start();
+    trace_start();
+    setUpRamFunc();
 
     setup_ADC_edumkII();
     System_printf("Setting up ADC for Joystick Done\n");
@@ -60,6 +95,16 @@ int main(void)
     System_printf("Set up Joystick Task\n");
     System_flush();
 
+    setUpControl_Task();
+    setUpRcOut();
+    setUpBlackbox_Task();
+    setUpDisplay_Task();
+    setUpUsbCdc_Task();
+    setUpUdpBridge();
+    sysmon_start();
+    //watchdog runs from here on, fed by the deadline monitor
+    deadline_start();
+
     //SysMin will only print to the console upon calling flush or exit
     //Start BIOS
     BIOS_start();
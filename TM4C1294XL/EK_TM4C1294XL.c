@@ -487,24 +487,11 @@ const SDSPITiva_HWAttrs sdspiTivaHWattrs[EK_TM4C1294XL_SDSPICOUNT] = {
         GPIO_PIN_1,         /* MOSI PIN */
         GPIO_PORTH_BASE,    /* GPIO CS PORT */
         GPIO_PIN_2,         /* CS PIN */
-    },
-    {
-        SSI3_BASE,          /* SPI base address */
-
-        GPIO_PORTQ_BASE,    /* SPI SCK PORT */
-        GPIO_PIN_0,         /* SCK PIN */
-        GPIO_PORTQ_BASE,    /* SPI MISO PORT*/
-        GPIO_PIN_3,         /* MISO PIN */
-        GPIO_PORTQ_BASE,    /* SPI MOSI PORT */
-        GPIO_PIN_2,         /* MOSI PIN */
-        GPIO_PORTP_BASE,    /* GPIO CS PORT */
-        GPIO_PIN_4,         /* CS PIN */
     }
 };
 
 const SDSPI_Config SDSPI_config[] = {
     {&SDSPITiva_fxnTable, &sdspiTivaObjects[0], &sdspiTivaHWattrs[0]},
-    {&SDSPITiva_fxnTable, &sdspiTivaObjects[1], &sdspiTivaHWattrs[1]},
     {NULL, NULL, NULL}
 };
 
@@ -534,26 +521,10 @@ void EK_TM4C1294XL_initSDSPI(void)
     GPIOPinConfigure(GPIO_PD0_SSI2XDAT1);
     GPIOPinConfigure(GPIO_PD1_SSI2XDAT0);
 
-    /* SDSPI1 configuration */
-    /* Enable the peripherals used by the SD Card */
-    SysCtlPeripheralEnable(SYSCTL_PERIPH_SSI3);
-
-    /* Configure pad settings */
-    GPIOPadConfigSet(GPIO_PORTQ_BASE,
-                     GPIO_PIN_0 | GPIO_PIN_2,
-                     GPIO_STRENGTH_4MA, GPIO_PIN_TYPE_STD);
-
-    GPIOPadConfigSet(GPIO_PORTQ_BASE,
-                     GPIO_PIN_3,
-                     GPIO_STRENGTH_4MA, GPIO_PIN_TYPE_STD_WPU);
-
-    GPIOPadConfigSet(GPIO_PORTP_BASE,
-                     GPIO_PIN_4,
-                     GPIO_STRENGTH_4MA, GPIO_PIN_TYPE_STD);
-
-    GPIOPinConfigure(GPIO_PQ0_SSI3CLK);
-    GPIOPinConfigure(GPIO_PQ3_SSI3XDAT1);
-    GPIOPinConfigure(GPIO_PQ2_SSI3XDAT0);
+    /*
+     *  No SDSPI1 on SSI3: PQ0, PQ3 and PP4 are the STATUS2, STATUS1 and RST
+     *  lines of the bluetooth module (setup_UART).
+     */
 
     /*
      *  These GPIOs are connected to PA2 and PA3 and need to be brought into a
@@ -712,7 +683,7 @@ const UART_Config UART_config[] = {
 
 /* UART objects */
 UARTTiva_Object uartTivaObjects[EK_TM4C1294XL_UARTCOUNT];
-unsigned char uartTivaRingBuffer[2][32];
+unsigned char uartTivaRingBuffer[3][32];
 
 /* UART configuration structure */
 const UARTTiva_HWAttrs uartTivaHWAttrs[EK_TM4C1294XL_UARTCOUNT] = {
@@ -731,6 +702,14 @@ const UARTTiva_HWAttrs uartTivaHWAttrs[EK_TM4C1294XL_UARTCOUNT] = {
         .flowControl = UART_FLOWCONTROL_NONE,
         .ringBufPtr  = uartTivaRingBuffer[1],
         .ringBufSize = sizeof(uartTivaRingBuffer[1])
+    },
+    {/* EK_TM4C1294XL_UART7 */
+        .baseAddr = UART7_BASE,
+        .intNum = INT_UART7,
+        .intPriority = ~0,
+        .flowControl = UART_FLOWCONTROL_NONE,
+        .ringBufPtr  = uartTivaRingBuffer[2],
+        .ringBufSize = sizeof(uartTivaRingBuffer[2])
     }
 };
 
@@ -745,6 +724,11 @@ const UART_Config UART_config[] = {
         &uartTivaObjects[1],
         &uartTivaHWAttrs[1]
     },
+    {
+        &UARTTiva_fxnTable,
+        &uartTivaObjects[2],
+        &uartTivaHWAttrs[2]
+    },
     {NULL, NULL, NULL}
 };
 #endif /* TI_DRIVERS_UART_DMA */
@@ -760,6 +744,11 @@ void EK_TM4C1294XL_initUART(void)
     GPIOPinConfigure(GPIO_PP1_U6TX);
     GPIOPinTypeUART(GPIO_PORTP_BASE, GPIO_PIN_0 | GPIO_PIN_1);
 
+    SysCtlPeripheralEnable(SYSCTL_PERIPH_UART7);
+    GPIOPinConfigure(GPIO_PC4_U7RX);
+    GPIOPinConfigure(GPIO_PC5_U7TX);
+    GPIOPinTypeUART(GPIO_PORTC_BASE, GPIO_PIN_4 | GPIO_PIN_5);
+
     /* Initialize the UART driver */
 #if TI_DRIVERS_UART_DMA
     EK_TM4C1294XL_initDMA();
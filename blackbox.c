@@ -0,0 +1,346 @@
+/*
+ * blackbox.c
+ *
+ *  Created on: 19.10.2026
+ *
+ *  Flight recorder on an SD card (SDSPI + FatFS).
+ *  Stick samples, sent packets, telemetry and link metrics are appended as compact binary
+ *  records (blackbox.h) into one of two RAM blocks. blackbox_log only copies the record with
+ *  interrupts disabled, it never waits: if the full block was not written yet the record is
+ *  dropped and counted. The blackbox task at the lowest priority writes every full block to
+ *  the card in one piece and syncs the file, a new file BBnnnn.BIN is started on every boot.
+ *  Console: blackbox [start|stop], stop writes the last block and closes the file.
+ *  SSI2 is shared with the LCD (display.c): every card access holds the bus lock.
+ *  tools/blackbox_decode.py converts a file into CSV.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include <xdc/std.h>
+#include <xdc/runtime/System.h>
+
+#include <ti/drivers/SDSPI.h>
+#include <ti/sysbios/BIOS.h>
+#include <ti/sysbios/fatfs/ff.h>
+#include <ti/sysbios/hal/Hwi.h>
+#include <ti/sysbios/knl/Clock.h>
+#include <ti/sysbios/knl/Semaphore.h>
+#include <ti/sysbios/knl/Task.h>
+
+#include <Board.h>
+
+#include <blackbox.h>
+#include <config.h>
+#include <console.h>
+#include <metrics.h>
+#include <sysmon.h>
+#include <tasks.h>
+
+#define BB_MAX_FILES    9999
+
+static uint8_t blocks[2][BB_BLOCK_SIZE];
+static volatile uint8_t active = 0;         //block that is filled
+static volatile uint16_t fill = 0;
+static volatile bool pending = false;       //the other block is full and waits for the task
+static volatile bool recording = false;
+static uint32_t dropped = 0;
+
+static volatile bool startRequested = false;
+static volatile bool stopRequested = false;
+
+static SDSPI_Handle sdspi = NULL;
+static FIL file;
+static bool fileOpen = false;       //file is open, write_block closes it when the card fails
+static char fileName[16];
+static uint32_t bytesWritten = 0;
+
+static Semaphore_Struct flushSem;   //posted when a block is full or a command is requested
+static Semaphore_Struct busLock;    //SSI2, shared with the LCD
+static Task_Struct blackboxTaskStruct;
+static Char blackboxTaskStack[TASK_STACK_BLACKBOX];
+
+//appends a record to the active block, interrupts must be disabled and the record must fit
+static void put_locked(bb_type_t type, const void *data, uint8_t size)
+{
+    bb_header_t header;
+
+    header.type = type;
+    header.size = size;
+    header.time = Clock_getTicks();
+    memcpy(&blocks[active][fill], &header, sizeof(header));
+    memcpy(&blocks[active][fill + sizeof(header)], data, size);
+    fill += sizeof(header) + size;
+}
+
+//hands the active block to the task and starts the other one with a sync record
+//interrupts must be disabled and no block may be pending
+static void seal_locked(void)
+{
+    bb_sync_t sync;
+
+    if(fill < BB_BLOCK_SIZE)
+    {
+        blocks[active][fill] = BB_PAD; //the decoder skips the rest of the block
+    }
+    pending = true;
+    active ^= 1;
+    fill = 0;
+
+    sync.tick = Clock_getTicks();
+    sync.dropped = dropped;
+    put_locked(BB_SYNC, &sync, sizeof(sync));
+}
+
+//adds a record, can be called from Task, Swi and Hwi context and never blocks
+void blackbox_log(bb_type_t type, const void *data, uint8_t size)
+{
+    bool full = false;
+    UInt key;
+
+    if(!recording || size > BB_MAX_PAYLOAD)
+    {
+        return;
+    }
+    key = Hwi_disable();
+    if(recording)
+    {
+        if(fill + sizeof(bb_header_t) + size > BB_BLOCK_SIZE)
+        {
+            if(pending)
+            {
+                dropped++;  //the card is too slow, never wait for it
+                Hwi_restore(key);
+                return;
+            }
+            seal_locked();
+            full = true;
+        }
+        put_locked(type, data, size);
+    }
+    Hwi_restore(key);
+
+    if(full)
+    {
+        Semaphore_post(Semaphore_handle(&flushSem));
+    }
+}
+
+//fills the link metrics record, also streamed over USB (usbcdc.c)
+void blackbox_linkRecord(bb_link_t *link)
+{
+    link->linkUp = metrics_get(MET_LINK_UP);
+    link->framesSent = metrics_get(MET_FRAMES_SENT);
+    link->txDropped = metrics_get(MET_TX_DROPPED);
+    link->rtsStalls = metrics_get(MET_RTS_STALLS);
+    link->rxBytes = metrics_get(MET_RX_BYTES);
+    link->reconnects = metrics_get(MET_RECONNECTS);
+    link->deadlineMisses = metrics_get(MET_DEADLINE_MISSES);
+    link->cpuLoad = metrics_get(MET_CPU_LOAD);
+}
+
+static void log_link(void)
+{
+    bb_link_t link;
+
+    blackbox_linkRecord(&link);
+    blackbox_log(BB_LINK, &link, sizeof(link));
+}
+
+//writes the pending block, stops recording if the card fails
+static void write_block(void)
+{
+    UINT written;
+
+    if(f_write(&file, blocks[active ^ 1], BB_BLOCK_SIZE, &written) != FR_OK || written != BB_BLOCK_SIZE
+       || f_sync(&file) != FR_OK)
+    {
+        recording = false;
+        f_close(&file);
+        fileOpen = false;
+        System_printf("blackbox: writing %s failed, recording stopped\n", fileName);
+        System_flush();
+    }
+    else
+    {
+        bytesWritten += written;
+    }
+    pending = false;
+}
+
+//opens the next free BBnnnn.BIN and starts the first block
+static bool start_file(void)
+{
+    static uint16_t number = 0;
+    bb_start_t start;
+    FRESULT result = FR_EXIST;
+    UInt key;
+
+    while(result == FR_EXIST && number < BB_MAX_FILES)
+    {
+        number++;
+        System_snprintf(fileName, sizeof(fileName), "%u:BB%04u.BIN", BB_DRIVE, number);
+        result = f_open(&file, fileName, FA_WRITE | FA_CREATE_NEW);
+    }
+    if(result != FR_OK)
+    {
+        System_printf("blackbox: no file created (%d)\n", result);
+        System_flush();
+        return false;
+    }
+    fileOpen = true;
+
+    start.magic = BB_MAGIC;
+    start.version = BB_VERSION;
+    start.blockSize = BB_BLOCK_SIZE;
+    start.tick = Clock_getTicks();
+    start.loopPeriodMs = config->loopPeriodMs;
+    start.reserved = 0;
+
+    key = Hwi_disable();
+    fill = 0;
+    pending = false;
+    dropped = 0;
+    put_locked(BB_START, &start, sizeof(start));
+    recording = true;
+    Hwi_restore(key);
+    bytesWritten = 0;
+
+    System_printf("blackbox: recording to %s\n", fileName);
+    System_flush();
+    return true;
+}
+
+//writes the partly filled block and closes the file
+static void stop_file(void)
+{
+    UInt key = Hwi_disable();
+
+    recording = false;
+    if(!pending)
+    {
+        seal_locked();
+    }
+    Hwi_restore(key);
+    write_block(); //a block that was pending already is written, the partly filled one is lost
+    if(fileOpen)
+    {
+        f_close(&file);
+        fileOpen = false;
+    }
+}
+
+//SSI2 and its uDMA channel belong to the caller until blackbox_unlockBus, Task context only
+void blackbox_lockBus(void)
+{
+    Semaphore_pend(Semaphore_handle(&busLock), BIOS_WAIT_FOREVER);
+}
+
+void blackbox_unlockBus(void)
+{
+    Semaphore_post(Semaphore_handle(&busLock));
+}
+
+/*
+ *  Blackbox task: mounts the card, writes full blocks and adds the link metrics once per period
+ */
+void blackbox_fnx(UArg arg0, UArg arg1)
+{
+    SDSPI_Params sdspiParams;
+
+    SDSPI_Params_init(&sdspiParams);
+    blackbox_lockBus();
+    sdspi = SDSPI_open(BB_SDSPI, BB_DRIVE, &sdspiParams);
+    if(sdspi == NULL)
+    {
+        blackbox_unlockBus();
+        System_printf("blackbox: no SD card interface, not recording\n");
+        System_flush();
+        return;
+    }
+    start_file();
+    blackbox_unlockBus();
+
+    while(1)
+    {
+        Semaphore_pend(Semaphore_handle(&flushSem), BB_LINK_PERIOD_MS);
+        if(recording)
+        {
+            log_link();
+        }
+        if(pending && recording)
+        {
+            blackbox_lockBus();
+            write_block();
+            blackbox_unlockBus();
+        }
+        if(stopRequested)
+        {
+            stopRequested = false;
+            if(recording)
+            {
+                blackbox_lockBus();
+                stop_file();
+                blackbox_unlockBus();
+            }
+        }
+        if(startRequested)
+        {
+            startRequested = false;
+            if(!recording)
+            {
+                blackbox_lockBus();
+                start_file();
+                blackbox_unlockBus();
+            }
+        }
+    }
+}
+
+static void cmd_blackbox(uint8_t argc, char *argv[])
+{
+    if(argc == 1)
+    {
+        console_printf("%s %s, %u bytes written, %u records dropped\r\n",
+                       recording ? "recording to" : "stopped, last file", fileName, bytesWritten, dropped);
+    }
+    else if(strcmp(argv[1], "start") == 0)
+    {
+        startRequested = true;
+        Semaphore_post(Semaphore_handle(&flushSem));
+    }
+    else if(strcmp(argv[1], "stop") == 0)
+    {
+        stopRequested = true;
+        Semaphore_post(Semaphore_handle(&flushSem));
+    }
+    else
+    {
+        console_printf("usage: blackbox [start|stop]\r\n");
+    }
+}
+
+static const console_cmd_t blackboxCmd = { "blackbox", "flight recorder: start|stop", cmd_blackbox };
+
+/*
+ *  Creates the blackbox task and the bus lock, Board_initSDSPI must have been called
+ */
+void setUpBlackbox_Task(void)
+{
+    Semaphore_Params semParams;
+    Semaphore_Params_init(&semParams);
+    semParams.mode = Semaphore_Mode_BINARY;
+    Semaphore_construct(&flushSem, 0, &semParams);
+    Semaphore_construct(&busLock, 1, &semParams);
+
+    Task_Params taskParams;
+    Task_Params_init(&taskParams);
+    taskParams.stack = &blackboxTaskStack;
+    taskParams.stackSize = sizeof(blackboxTaskStack);
+    taskParams.priority = TASK_PRIO_BLACKBOX;
+    Task_construct(&blackboxTaskStruct, (Task_FuncPtr) blackbox_fnx, &taskParams, NULL);
+
+    sysmon_registerTask(Task_handle(&blackboxTaskStruct), "blackbox");
+    console_addCommand(&blackboxCmd);
+}
@@ -21,6 +21,10 @@
 #include <ti/drivers/UART.h>
 
 /* BIOS Header files */
+#include <ti/sysbios/BIOS.h>
+#include <ti/sysbios/hal/Hwi.h>
+#include <ti/sysbios/knl/Clock.h>
+#include <ti/sysbios/knl/Semaphore.h>
 #include <ti/sysbios/knl/Task.h>
 
 #include <string.h>
@@ -28,47 +32,303 @@
 /* XDCtools Header files */
 #include <xdc/runtime/Error.h>
 #include <xdc/runtime/System.h>
+#include <xdc/runtime/Timestamp.h>
+#include <xdc/runtime/Types.h>
 
+#include <blackbox.h>
 #include <bluetooth.h>
+#include <btcmd.h>
+#include <config.h>
+#include <connection.h>
+#include <console.h>
+#include <control.h>
+#include <deadline.h>
+#include <display.h>
+#include <executor.h>
+#include <metrics.h>
+#include <ramfunc.h>
+#include <sysmon.h>
+#include <tasks.h>
+#include <trace.h>
+#include <udpbridge.h>
+#include <usbcdc.h>
 
+#define MSP_STATUS      101     //request without payload, presence check of the aux link
 
-//uart global handler for reading/writing to uart
-UART_Handle uart;
+//pins and UART of one copter link, port 0: not connected
+typedef struct bt_link_hw_t {
+    const char *name;
+    uint32_t uartIndex;     //Board_UARTx
+    uint32_t uartBase;
+    uint32_t ctsPort;       //CTS of the module (input), high while writing
+    uint8_t ctsPin;
+    uint32_t rtsPort;       //RTS of the module (output), writing waits while it is high
+    uint8_t rtsPin;
+    uint32_t statusPort;    //STATUS1/STATUS2 of the module, without them the module counts as connected
+    uint8_t status1Pin;
+    uint8_t status2Pin;
+    bool managed;           //powered up and connected by the connection manager, else in data mode once open
+    deadline_id_t deadline;
+    const char *rxTaskName;
+    const char *txTaskName;
+} bt_link_hw_t;
 
-//global variable that indicates if the copter is ready for controls
-uint8_t bluetooth_ready = 0;
+static const bt_link_hw_t linkHw[BT_LINK_COUNT] = {
+    //RN4871 on the boosterpack2 slot: CTS = D4 (INT), RTS = P5 (CS), STATUS1 = Q3 (SDI), STATUS2 = Q0 (SCK)
+    { "module", Board_UART6, UART6_BASE, GPIO_PORTD_BASE, GPIO_PIN_4, GPIO_PORTP_BASE, GPIO_PIN_5,
+      GPIO_PORTQ_BASE, GPIO_PIN_3, GPIO_PIN_0, true, DL_LINK_TX, "link rx", "link tx" },
+    //module in transparent mode on the boosterpack1 slot, only RX/TX are connected
+    { "aux", Board_UART7, UART7_BASE, 0, 0, 0, 0,
+      0, 0, 0, false, DL_LINK_AUX_TX, "aux rx", "aux tx" },
+};
 
-//used to send data via uart to the bluetooth module
-void send_data(char *data, size_t size)
+//other MSP frames, packed behind the control frame into the same notification
+typedef struct bt_frame_t {
+    uint8_t size;
+    char data[BT_PAYLOAD_MAX];
+} bt_frame_t;
+
+//session of one copter link, everything the link tasks of different links share is in here
+struct bt_link_t {
+    const bt_link_hw_t *hw;
+    uint8_t index;
+    UART_Handle uart;
+    volatile bool ready;            //the copter is connected and ready for controls
+
+    //latest control frame, written by send_controls and sent by the link TX task
+    char txFrame[MSP_RC_FRAME_SIZE];
+    volatile bool txFramePending;
+    Semaphore_Struct txSem;
+
+    bt_frame_t txQueue[BT_TX_QUEUE_SIZE];
+    volatile uint8_t txQueueHead;
+    volatile uint8_t txQueueTail;
+
+    //packet of whole frames for one notification
+    char txPacket[BT_PAYLOAD_MAX];
+    uint8_t payloadSize;
+
+    //frames per radio event: packets written within the same connection interval are counted together
+    uint32_t eventStart;            //timestamp of the first packet in the current interval
+    uint8_t eventFrames;
+
+    //current baud rate, starts with the stored rate and is changed in place by bt_setBaudRate
+    uint32_t baudRate;
+
+    //only one writer on the UART at a time (link TX task and connection job)
+    Semaphore_Struct txLock;
+
+    //relay mode (relay.c): the frames of the PC are written into the UART by the relay, the driver stays silent
+    volatile bool txRelay;
+
+    //failsafe (bt_linkFailsafe): a driver write is in progress, the failsafe frame waits behind it
+    volatile bool txWriting;
+    volatile bool failsafePending;
+
+    Semaphore_Struct rxStartSem;    //posted once the UART is open
+
+    //command mode: received lines, written by the link RX task and read by the command channel (btcmd.c)
+    volatile bool rxDataMode;
+    bt_line_t rxLine;
+    uint8_t rxLineLen;
+    bt_line_t lines[BT_LINE_COUNT];
+    volatile uint8_t lineHead;
+    volatile uint8_t lineTail;
+
+    //data mode: bytes of the copter, one MSP frame per record
+    char telemetry[BB_TELEMETRY_MAX];
+    uint8_t telemetryLen;
+    uint32_t rxTick;                //Clock tick of the latest byte, presence check of the aux link
+
+    bt_link_stats_t stats;
+};
+
+static bt_link_t links[BT_LINK_COUNT];
+
+//controls and MSP frames go to this link or to all of them (BT_ROUTE_ALL)
+static volatile uint8_t route = BT_LINK_MODULE;
+//link that gets the next control frame first, rotates so no link is always served last
+static uint8_t nextLink = 0;
+
+//statically allocated link tasks
+static Task_Struct rxTaskStructs[BT_LINK_COUNT];
+static Char rxTaskStacks[BT_LINK_COUNT][TASK_STACK_LINK_RX];
+static Task_Struct txTaskStructs[BT_LINK_COUNT];
+static Char txTaskStacks[BT_LINK_COUNT][TASK_STACK_LINK_TX];
+
+static void build_rc_frame(char *payload, uint16_t roll, uint16_t pitch, uint16_t throttle, bool armed);
+
+static bool rts_busy(const bt_link_t *link)
 {
-    //Set D4 = Set CTS high
-    GPIOPinWrite(GPIO_PORTD_BASE, GPIO_PIN_4, GPIO_PIN_4);
-    //Read P5 = make sure there is no RTS
-    while(GPIOPinRead(GPIO_PORTP_BASE, GPIO_PIN_5) != 0x00);
+    return link->hw->rtsPort != 0 && GPIOPinRead(link->hw->rtsPort, link->hw->rtsPin) != 0x00;
+}
 
-    if(UART_write(uart, data, size) == UART_ERROR)
+static void set_cts(const bt_link_t *link, bool high)
+{
+    if(link->hw->ctsPort != 0)
     {
-        System_printf("Error on writing uart!\n");
-        System_flush();
+        GPIOPinWrite(link->hw->ctsPort, link->hw->ctsPin, high ? link->hw->ctsPin : 0);
+    }
+}
+
+static bool uart_busy(const bt_link_t *link)
+{
+    return UARTBusy(link->hw->uartBase);
+}
+
+//waits until busy() is false, sleeps 1 ms per check: Task_yield would only let the other TX task
+//(same priority) run, the RX tasks, the executor and the console that notice a dead module starve
+//returns false after BT_TX_TIMEOUT_MS
+static bool wait_idle(bt_link_t *link, bool (*busy)(const bt_link_t *link))
+{
+    uint32_t deadline = Clock_getTicks() + BT_TX_TIMEOUT_MS;
+
+    while(busy(link))
+    {
+        if((int32_t)(Clock_getTicks() - deadline) >= 0)
+        {
+            link->stats.txTimeouts++;
+            metrics_inc(MET_TX_TIMEOUTS);
+            return false;
+        }
+        Task_sleep(1);
+    }
+    return true;
+}
+
+//used to send data via uart to the bluetooth module of the link
+//RTS and the FIFO are waited for at most BT_TX_TIMEOUT_MS each, a stalled module never holds up
+//the packets of another link
+void send_data(bt_link_t *link, char *data, size_t size)
+{
+    char payload[MSP_RC_FRAME_SIZE];
+    Types_FreqHz freq;
+    uint32_t start;
+    bool failsafe;
+    int result;
+    UInt key;
+
+    Semaphore_pend(Semaphore_handle(&link->txLock), BIOS_WAIT_FOREVER);
+    if(link->txRelay)
+    {
+        Semaphore_post(Semaphore_handle(&link->txLock));
         return;
     }
+    start = Timestamp_get32();
+
+    //Set CTS high
+    set_cts(link, true);
+    //make sure there is no RTS
+    if(rts_busy(link))
+    {
+        link->stats.rtsStalls++;
+        metrics_inc(MET_RTS_STALLS);
+        if(!wait_idle(link, rts_busy))
+        {
+            set_cts(link, false);
+            Semaphore_post(Semaphore_handle(&link->txLock));
+            return;
+        }
+    }
 
+    link->txWriting = true;
+    result = UART_write(link->uart, data, size);
+    key = Hwi_disable();
+    link->txWriting = false;
+    failsafe = link->failsafePending;
+    link->failsafePending = false;
+    Hwi_restore(key);
+
+    //a failsafe frame that found this write in progress follows right behind it
+    if(failsafe)
+    {
+        build_rc_frame(payload, 1500, 1500, 1000, false);
+        UART_write(link->uart, payload, sizeof(payload));
+    }
+
+    if(result == UART_ERROR)
+    {
+        link->stats.txErrors++;
+        metrics_inc(MET_UART_TX_ERRORS);
+        System_printf("Error on writing uart of link %s!\n", link->hw->name);
+        System_flush();
+        set_cts(link, false);
+        Semaphore_post(Semaphore_handle(&link->txLock));
+        return;
+    }
 
-    while(UARTBusy(UART6_BASE));
+    //on a timeout the bytes stay in the FIFO, only the wait is given up
+    wait_idle(link, uart_busy);
 
     //Set CTS low
-    GPIOPinWrite(GPIO_PORTD_BASE, GPIO_PIN_4, 0);
+    set_cts(link, false);
+    Semaphore_post(Semaphore_handle(&link->txLock));
+
+    Timestamp_getFreq(&freq);
+    metrics_observe(MET_HIST_TX_US, (Timestamp_get32() - start) / (freq.lo / 1000000));
 }
 
+//link by number, NULL if there is no such link
+bt_link_t *bt_getLink(uint8_t index)
+{
+    return index < BT_LINK_COUNT ? &links[index] : NULL;
+}
 
-//global function that can be used to send controls to the copter
-//must only be used if the global "bluetooth_ready" is != 0!
-//also values for roll, pitch and throttle must only be 1000-2000
-void send_controls(uint16_t roll, uint16_t pitch, uint16_t throttle, bool armed)
+const char *bt_linkName(const bt_link_t *link)
+{
+    return link->hw->name;
+}
+
+//marks the copter of the link connected and ready for controls or lost
+//the control task sends as long as one link of the route is ready
+void bt_setReady(bt_link_t *link, bool ready)
+{
+    link->ready = ready;
+    control_post(ready ? CONTROL_EVT_LINK_UP : CONTROL_EVT_LINK_DOWN);
+}
+
+bool bt_isReady(const bt_link_t *link)
+{
+    return link->ready;
+}
+
+static bool routed(const bt_link_t *link)
+{
+    return (route == BT_ROUTE_ALL || route == link->index) && link->ready;
+}
+
+//selects the link the controls and MSP frames go to, BT_ROUTE_ALL for every link
+void bt_setRoute(uint8_t newRoute)
+{
+    route = newRoute;
+    control_post(bt_routeReady() ? CONTROL_EVT_LINK_UP : CONTROL_EVT_LINK_DOWN);
+}
+
+uint8_t bt_getRoute(void)
+{
+    return route;
+}
+
+//true if at least one link of the route is ready for controls
+bool bt_routeReady(void)
+{
+    uint8_t i;
+
+    for(i = 0; i < BT_LINK_COUNT; i++)
+    {
+        if(routed(&links[i]))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+//builds an MSP_SET_RAW_RC frame
+static RAMFUNC void build_rc_frame(char *payload, uint16_t roll, uint16_t pitch, uint16_t throttle, bool armed)
 {
     uint16_t spin = 1500; //currently not possible to control the spin (leave at default: 1500)
 
-    char payload[16];
     payload[0] = 0x24; // $
     payload[1] = 0x4D; // M
     payload[2] = 0x3C; // >
@@ -93,108 +353,336 @@ void send_controls(uint16_t roll, uint16_t pitch, uint16_t throttle, bool armed)
         checksum ^= payload[i];
     }
     payload[15] = checksum;
+}
 
-    send_data(payload, sizeof(payload));
+//control frame of the hot path for the ramfunc benchmark (ramfunc.c)
+RAMFUNC void bt_benchFrame(char *payload, uint16_t roll, uint16_t pitch)
+{
+    build_rc_frame(payload, roll, pitch, 1000, false);
 }
 
-//Used to send commands to the bluetooth module using UART
-//returns 1 if command was sent successfully, NULL if an ERROR occured
-int send_command(char *cmd, uint8_t cmdSize, uint8_t returnSize, char *returnVal)
+//global function that can be used to send controls to the copters of the route
+//must only be used while the route is ready (CONTROL_EVT_LINK_UP)!
+//also values for roll, pitch and throttle must only be 1000-2000
+//the frame is only built here, the link TX tasks send it
+void send_controls(uint16_t roll, uint16_t pitch, uint16_t throttle, bool armed)
 {
-    char uartReturn[16] = { '\0' };
+    char payload[MSP_RC_FRAME_SIZE];
+    bt_link_t *link;
+    uint8_t i;
 
-    //Set D4 = Set CTS high
-    GPIOPinWrite(GPIO_PORTD_BASE, GPIO_PIN_4, GPIO_PIN_4);
+    build_rc_frame(payload, roll, pitch, throttle, armed);
 
-    //Read P5 = make sure RTS is low
-    while(GPIOPinRead(GPIO_PORTP_BASE, GPIO_PIN_5) != 0x00)
-    {}
+    //the TX tasks have the same priority and run in the order they are posted
+    for(i = 0; i < BT_LINK_COUNT; i++)
+    {
+        link = &links[(nextLink + i) % BT_LINK_COUNT];
+        if(!routed(link) || link->txRelay)
+        {
+            continue; //the PC controls this copter
+        }
+
+        //an unsent older frame is simply overwritten, only the latest controls matter
+        UInt key = Hwi_disable();
+        memcpy(link->txFrame, payload, sizeof(link->txFrame));
+        link->txFramePending = true;
+        Hwi_restore(key);
+        trace_event(TRACE_SEM_POST, TRACE_SEM_TX_FRAME);
+        Semaphore_post(Semaphore_handle(&link->txSem));
+    }
+    nextLink = (nextLink + 1) % BT_LINK_COUNT;
+}
 
-    //write to uart
-    if(UART_write(uart, cmd, cmdSize) == UART_ERROR)
+//writes a disarm frame (throttle minimum, sticks centered) straight into the UART FIFO of the link
+//bypasses the driver, txLock and the link TX task, which may be the one that hangs, but only while
+//the UART is idle: the frame then fits into the empty FIFO and nothing can interleave with it.
+//During a driver write (or a relayed frame still in the FIFO) it is left to send_data, which writes
+//it right behind the current packet; the callers repeat it, a later call finds the UART idle.
+//can be called from Task, Swi and Hwi context, does nothing in command mode
+//returns false if the frame was left to send_data
+bool bt_linkFailsafe(bt_link_t *link)
+{
+    char payload[MSP_RC_FRAME_SIZE];
+    bool idle;
+    uint8_t i;
+    UInt key;
+
+    if(!link->rxDataMode)
+    {
+        return true;
+    }
+    build_rc_frame(payload, 1500, 1500, 1000, false);
+
+    key = Hwi_disable();
+    idle = !link->txWriting && !UARTBusy(link->hw->uartBase);
+    if(idle)
+    {
+        set_cts(link, true);
+        for(i = 0; i < MSP_RC_FRAME_SIZE; i++)
+        {
+            UARTCharPutNonBlocking(link->hw->uartBase, payload[i]);
+        }
+    }
+    else
     {
-        return NULL;
+        link->failsafePending = true;
     }
+    Hwi_restore(key);
+    return idle;
+}
+
+//disarm frame on every link in data mode, whatever the route
+//returns false if one of them was left to send_data
+bool bt_sendFailsafe(void)
+{
+    bool written = true;
+    uint8_t i;
 
+    for(i = 0; i < BT_LINK_COUNT; i++)
+    {
+        if(!bt_linkFailsafe(&links[i]))
+        {
+            written = false;
+        }
+    }
+    return written;
+}
 
-    //wait until finished
-    while(UARTBusy(UART6_BASE))
+//hands the UART of the link to the relay (relay.c) or takes it back, waits for a packet the driver is writing
+//CTS stays high during the relay as during send_data
+void bt_setRelay(bt_link_t *link, bool on)
+{
+    Semaphore_pend(Semaphore_handle(&link->txLock), BIOS_WAIT_FOREVER);
+    while(UARTBusy(link->hw->uartBase))
     {}
+    link->txRelay = on;
+    set_cts(link, on);
+    Semaphore_post(Semaphore_handle(&link->txLock));
+}
 
-    //set CTS low again
-    GPIOPinWrite(GPIO_PORTD_BASE, GPIO_PIN_4, 0);
+//true while the module is in data mode, frames written into the UART go to the copter
+bool bt_isDataMode(const bt_link_t *link)
+{
+    return link->rxDataMode;
+}
+
+//true if a frame written into the UART FIFO now reaches the copter: data mode and no RTS
+//can be called from Hwi context
+bool bt_txReady(const bt_link_t *link)
+{
+    return link->rxDataMode && !rts_busy(link);
+}
 
-    //read response
-    if(UART_read(uart, &uartReturn, returnSize) == UART_ERROR)
+uint32_t bt_uartBase(const bt_link_t *link)
+{
+    return link->hw->uartBase;
+}
+
+//queues another MSP frame on one link, it is sent with the next packet of its TX task
+static bool queue_frame(bt_link_t *link, const char *frame, uint8_t size)
+{
+    UInt key;
+    uint8_t next;
+
+    key = Hwi_disable();
+    next = (link->txQueueHead + 1) % BT_TX_QUEUE_SIZE;
+    if(next == link->txQueueTail)
     {
-        return NULL;
+        link->stats.tx.dropped++;
+        metrics_inc(MET_TX_DROPPED);
+        Hwi_restore(key);
+        return false;
     }
-    strcpy(returnVal, uartReturn);
+    memcpy(link->txQueue[link->txQueueHead].data, frame, size);
+    link->txQueue[link->txQueueHead].size = size;
+    link->txQueueHead = next;
+    Hwi_restore(key);
 
-    Task_sleep(5);
-    return 1;
+    trace_event(TRACE_SEM_POST, TRACE_SEM_TX_FRAME);
+    Semaphore_post(Semaphore_handle(&link->txSem));
+    return true;
 }
 
-//Tries to establish a connection to the copter, aborts if connection fails
-//returns 1 on successful connection, NULL if an error occured
-int connect_to_copter()
+//queues another MSP frame on every ready link of the route
+//returns true if at least one link took it, false if none did or the frame is too large
+bool bt_queueFrame(const char *frame, uint8_t size)
 {
-    char returnVal[30];
+    bool queued = false;
+    uint8_t i;
 
-    //first enter command mode of bluetooth module
-    char cmdMode[3] = "$$$";
-    if(send_command(cmdMode, sizeof(cmdMode), 4, returnVal) == NULL)
+    if(size == 0 || size > BT_PAYLOAD_MAX)
     {
-        return NULL;
+        return false;
     }
+    for(i = 0; i < BT_LINK_COUNT; i++)
+    {
+        if(routed(&links[i]) && queue_frame(&links[i], frame, size))
+        {
+            queued = true;
+        }
+    }
+    return queued;
+}
 
-    if(strstr(returnVal, "CMD") == NULL)
+//sets the notification payload size (ATT MTU - 3) the packets of the link are aligned to
+void bt_setPayloadSize(bt_link_t *link, uint8_t size)
+{
+    if(size > BT_PAYLOAD_MAX)
     {
-        System_printf("Failed to enter command mode\n");
-        System_flush();
-        return NULL;
+        size = BT_PAYLOAD_MAX;
     }
+    link->payloadSize = size;
+}
+
+//counts the frames of one packet into the radio event it is sent in
+//all packets written within one connection interval reach the copter in the same event
+static void count_event(bt_link_t *link, uint8_t frames)
+{
+    conn_params_t params;
+    Types_FreqHz freq;
+    uint32_t now = Timestamp_get32();
+    uint32_t intervalTicks;
 
-    // connect to copter
-    char connectCmd[15] = "C,0006668CB2AC\r"; // connect to copter with its MAC-address
-    if(send_command(connectCmd, sizeof(connectCmd), 16, returnVal) == NULL)
+    if(!link->hw->managed || !conn_getParams(&params))
     {
-        return NULL;
+        params.intervalMax = 12; //flight profile until the copter reported its parameters
     }
+    Timestamp_getFreq(&freq);
+    intervalTicks = (freq.lo / 1000000) * params.intervalMax * 1250;
 
-    //if connection was not successful returnVal[10] would be 'E' (error)
-    if(returnVal[10] != 'C')
+    if(link->eventFrames > 0 && (now - link->eventStart) >= intervalTicks)
     {
-        System_printf("Failed to connect to copter!\n");
-        System_flush();
-        return NULL;
+        link->stats.tx.framesPerEvent[(link->eventFrames > BT_EVENT_HIST_SIZE ? BT_EVENT_HIST_SIZE : link->eventFrames) - 1]++;
+        link->eventFrames = 0;
     }
-    System_printf("Connected to copter\n");
-    System_flush();
+    if(link->eventFrames == 0)
+    {
+        link->eventStart = now;
+    }
+    link->eventFrames += frames;
+}
 
-    //Check status pins of bluetooth module: wait for correct status
-    while((GPIOPinRead(GPIO_PORTQ_BASE, GPIO_PIN_0) != 0x00) || (GPIOPinRead(GPIO_PORTQ_BASE, GPIO_PIN_3) == 0x00))
-    {}
+//moves the next frame into the packet, returns its size or 0 if there is none or it does not fit
+static RAMFUNC uint8_t pack_next(bt_link_t *link, uint8_t used)
+{
+    UInt key = Hwi_disable();
+    uint8_t size = 0;
 
-    // leave command mode
-    char leaveCmdMode[5] = "---\r\n";
-    if(send_command(leaveCmdMode, sizeof(leaveCmdMode), 1, returnVal) == NULL)
+    if(link->txFramePending)
     {
-        return NULL;
+        if(used + MSP_RC_FRAME_SIZE <= BT_PAYLOAD_MAX && (used == 0 || used + MSP_RC_FRAME_SIZE <= link->payloadSize))
+        {
+            memcpy(&link->txPacket[used], link->txFrame, MSP_RC_FRAME_SIZE);
+            link->txFramePending = false;
+            size = MSP_RC_FRAME_SIZE;
+        }
     }
+    else if(link->txQueueTail != link->txQueueHead)
+    {
+        bt_frame_t *frame = &link->txQueue[link->txQueueTail];
+        if(used + frame->size <= BT_PAYLOAD_MAX && (used == 0 || used + frame->size <= link->payloadSize))
+        {
+            memcpy(&link->txPacket[used], frame->data, frame->size);
+            link->txQueueTail = (link->txQueueTail + 1) % BT_TX_QUEUE_SIZE;
+            size = frame->size;
+        }
+    }
+    Hwi_restore(key);
+    return size;
+}
+
+//Link TX task, one per link (arg0): packs the latest control frame and queued frames into packets of whole frames
+//a packet never exceeds one notification (unless a single frame is larger), after each packet
+//the UART stays idle for BT_FLUSH_GAP_MS so the module sends it before the next frame starts
+void linkTx_fnx(UArg arg0, UArg arg1)
+{
+    bt_link_t *link = (bt_link_t *)arg0;
+    Types_FreqHz freq;
+    uint32_t start;
+    uint8_t used;
+    uint8_t frames;
+    uint8_t size;
+
+    Timestamp_getFreq(&freq);
 
-    // flush UART In-Buffer
-    while(UARTCharsAvail(UART6_BASE))
+    while(1)
     {
-        //read all chars in uart
-        UART_read(uart, &returnVal, 1);
+        deadline_idle(link->hw->deadline);
+        Semaphore_pend(Semaphore_handle(&link->txSem), BIOS_WAIT_FOREVER);
+
+        do
+        {
+            deadline_checkIn(link->hw->deadline); //per packet, a continuous stream of frames is no overrun
+            used = 0;
+            frames = 0;
+            while((size = pack_next(link, used)) != 0)
+            {
+                used += size;
+                frames++;
+            }
+
+            //in command mode the module would take the frames for a command
+            if(used == 0 || !link->rxDataMode || link->txRelay)
+            {
+                break;
+            }
+            start = Timestamp_get32();
+            send_data(link, link->txPacket, used);
+            blackbox_log(BB_FRAME, link->txPacket, used);
+            usbcdc_send(BB_FRAME, link->txPacket, used);
+            udp_frameSent(link->txPacket, used, frames, (Timestamp_get32() - start) / (freq.lo / 1000000));
+            sysmon_bootMark(BOOT_FIRST_FRAME);
+
+            link->stats.tx.packets++;
+            link->stats.tx.frames += frames;
+            metrics_inc(MET_PACKETS_SENT);
+            metrics_add(MET_FRAMES_SENT, frames);
+            if(used > link->payloadSize)
+            {
+                link->stats.tx.splitFrames++;
+            }
+            count_event(link, frames);
+
+            Task_sleep(BT_FLUSH_GAP_MS);
+        } while(link->txFramePending || link->txQueueTail != link->txQueueHead);
     }
+}
 
-    return 1;
+void bt_getStats(bt_link_t *link, bt_link_stats_t *stats)
+{
+    UInt key = Hwi_disable();
+    *stats = link->stats;
+    Hwi_restore(key);
 }
 
-//This task establishes a connection to the copter and creates a global UART handler for sending commands to the copter
-void UART_Task(UArg arg0, UArg arg1)
+//prints packing and frames per radio event of every link, added to the periodic sysmon reports
+void bt_reportTx(void)
+{
+    bt_link_stats_t stats;
+    uint8_t i;
+
+    for(i = 0; i < BT_LINK_COUNT; i++)
+    {
+        bt_getStats(&links[i], &stats);
+        System_printf("Link TX %s: %u frames in %u packets (payload %u), %u split, %u dropped\n",
+                      links[i].hw->name, stats.tx.frames, stats.tx.packets, links[i].payloadSize,
+                      stats.tx.splitFrames, stats.tx.dropped);
+        System_printf("  frames per radio event: 1:%u 2:%u 3:%u more:%u\n", stats.tx.framesPerEvent[0],
+                      stats.tx.framesPerEvent[1], stats.tx.framesPerEvent[2], stats.tx.framesPerEvent[3]);
+    }
+    System_flush();
+}
+
+//sends a command string to the bluetooth module, the response arrives as lines via bt_readLine
+//use the command channel (btcmd.c) instead of calling this directly
+void bt_sendCommand(bt_link_t *link, const char *cmd)
+{
+    send_data(link, (char *)cmd, strlen(cmd));
+}
+
+//opens the UART of the link and starts its link RX task
+//returns false if the UART could not be opened
+bool bt_openUart(bt_link_t *link)
 {
     UART_Params uartParams;
 
@@ -204,59 +692,296 @@ void UART_Task(UArg arg0, UArg arg1)
     uartParams.readDataMode = UART_DATA_BINARY;
     uartParams.readReturnMode = UART_RETURN_FULL;
     uartParams.readEcho = UART_ECHO_OFF;
-    uartParams.baudRate = 115200;
+    uartParams.baudRate = link->baudRate;
     uartParams.readMode = UART_MODE_BLOCKING;
+    //a link without status pins checks the presence of the copter itself, see aux_presence
+    uartParams.readTimeout = link->hw->managed ? BIOS_WAIT_FOREVER : BT_AUX_PROBE_MS;
 
-    //set global uart handler
-    uart = UART_open(Board_UART6, &uartParams);
+    link->uart = UART_open(link->hw->uartIndex, &uartParams);
 
-    if (uart == NULL)
+    if (link->uart == NULL)
     {
-        System_abort("Error opening the UART");
+        return false;
     }
 
-    System_printf("UART initialized\n");
+    System_printf("UART of link %s initialized\n", link->hw->name);
     System_flush();
-    Task_sleep(10);
+    Semaphore_post(Semaphore_handle(&link->rxStartSem)); //link RX task starts reading
+    return true;
+}
+
+//reconfigures the baud rate of the open UART in place
+//waits until a running transmission is finished, the RX side simply continues at the new rate
+void bt_setBaudRate(bt_link_t *link, uint32_t newBaudRate)
+{
+    Types_FreqHz cpuFreq;
+    BIOS_getCpuFreq(&cpuFreq);
 
-    //try to connect to the copter
-    if(connect_to_copter() == NULL)
+    Semaphore_pend(Semaphore_handle(&link->txLock), BIOS_WAIT_FOREVER);
+    while(UARTBusy(link->hw->uartBase))
+    {}
+    UARTConfigSetExpClk(link->hw->uartBase, cpuFreq.lo, newBaudRate,
+                        UART_CONFIG_WLEN_8 | UART_CONFIG_STOP_ONE | UART_CONFIG_PAR_NONE);
+    link->baudRate = newBaudRate;
+    Semaphore_post(Semaphore_handle(&link->txLock));
+}
+
+uint32_t bt_getBaudRate(const bt_link_t *link)
+{
+    return link->baudRate;
+}
+
+//switches between command mode (responses are split into lines, control frames are dropped)
+//and data mode (everything is passed on as copter data, control frames are sent)
+void bt_setDataMode(bt_link_t *link, bool dataMode)
+{
+    link->rxDataMode = dataMode;
+}
+
+//takes the oldest received line, returns false if there is none
+bool bt_readLine(bt_link_t *link, bt_line_t *line)
+{
+    if(link->lineTail == link->lineHead)
     {
-        System_abort("Connection to copter failed\n");
+        return false;
     }
+    memcpy(line, &link->lines[link->lineTail], sizeof(bt_line_t));
+    link->lineTail = (link->lineTail + 1) % BT_LINE_COUNT;
+    return true;
+}
 
-    Task_sleep(100);
+//true if a received line is waiting for the reader
+bool bt_lineAvailable(const bt_link_t *link)
+{
+    return link->lineTail != link->lineHead;
+}
 
-    System_printf("Bluetooth is ready!\n");
-    System_flush();
-    bluetooth_ready = 1;
+//drops all received lines
+void bt_flushLines(bt_link_t *link)
+{
+    link->lineTail = link->lineHead;
 }
 
-//runs the init sequence for the bluetooth module
-//all necessary pins must be activated before calling
-void init_bt_module()
+//hands a complete line to the reader, drops it if the reader is too slow
+static void rx_emit_line(bt_link_t *link)
 {
-    //set M7 = WAKE_UP high -> wake up from sleep mode
-    GPIOPinWrite(GPIO_PORTM_BASE, GPIO_PIN_7, GPIO_PIN_7);
-    SysCtlDelay((120000000 / 1000) * 500);
-    //P4 = RST on module low
-    GPIOPinWrite(GPIO_PORTP_BASE, GPIO_PIN_4, 0);
-    SysCtlDelay((120000000 / 1000) * 100);
-    //P4 = RST on module high -> module reset (pulse of at least 63ns)
-    GPIOPinWrite(GPIO_PORTP_BASE, GPIO_PIN_4, GPIO_PIN_4);
-    SysCtlDelay((120000000 / 1000) * 100);
-    //D2 = SW_BTN high -> power ON
-    GPIOPinWrite(GPIO_PORTD_BASE, GPIO_PIN_2, GPIO_PIN_2);
-    SysCtlDelay((120000000 / 1000) * 500);
-
-    //check status pins of the bluetooth module
-    //Q0 must be != 0 AND Q3 must be != 0
-    while((GPIOPinRead(GPIO_PORTQ_BASE, GPIO_PIN_0) != 0x00) && (GPIOPinRead(GPIO_PORTQ_BASE, GPIO_PIN_3) != 0x00))
-    {}
+    uint8_t next = (link->lineHead + 1) % BT_LINE_COUNT;
+
+    if(link->rxLineLen == 0)
+    {
+        return;
+    }
+    link->rxLine.text[link->rxLineLen] = '\0';
+    link->rxLineLen = 0;
+    if(next == link->lineTail)
+    {
+        return;
+    }
+    memcpy(&link->lines[link->lineHead], &link->rxLine, sizeof(bt_line_t));
+    link->lineHead = next;
+    exec_wake(); //the command channel waits for responses
+}
+
+//splits the responses of the module in command mode into lines
+//lines end with CR/LF, status messages are enclosed in '%' and the prompt "CMD> " has no line end
+static void rx_command_char(bt_link_t *link, char c)
+{
+    if(c == '\r' || c == '\n')
+    {
+        rx_emit_line(link);
+        return;
+    }
+    if(c == '%' && link->rxLineLen > 0)
+    {
+        if(link->rxLine.text[0] == '%')
+        {
+            //end of a status message
+            link->rxLine.text[link->rxLineLen++] = c;
+            rx_emit_line(link);
+            return;
+        }
+        rx_emit_line(link); //a status message starts in the middle of a line
+    }
+    link->rxLine.text[link->rxLineLen++] = c;
+    if(link->rxLineLen == BT_LINE_SIZE - 1 || (link->rxLineLen == 4 && strncmp(link->rxLine.text, "CMD>", 4) == 0))
+    {
+        rx_emit_line(link);
+    }
+}
+
+//hands the collected bytes of the copter to the blackbox, the USB stream, the UDP bridge and the display
+static void rx_flush_telemetry(bt_link_t *link)
+{
+    blackbox_log(BB_TELEMETRY, link->telemetry, link->telemetryLen);
+    usbcdc_send(BB_TELEMETRY, link->telemetry, link->telemetryLen);
+    udp_publish(BB_TELEMETRY, link->telemetry, link->telemetryLen);
+    display_telemetry(link->telemetry, link->telemetryLen);
+    link->telemetryLen = 0;
+}
+
+//data mode: collects the bytes of the copter, one record per MSP frame ("$" starts it)
+//a complete frame (header, size payload bytes, checksum) is handed on at once, not with the next "$"
+static void rx_telemetry_char(bt_link_t *link, char c)
+{
+    if((c == '$' && link->telemetryLen > 0) || link->telemetryLen == BB_TELEMETRY_MAX)
+    {
+        rx_flush_telemetry(link);
+    }
+    link->telemetry[link->telemetryLen++] = c;
+    if(link->telemetry[0] == '$' && link->telemetryLen > 3 && link->telemetryLen == (uint8_t)link->telemetry[3] + 6)
+    {
+        rx_flush_telemetry(link);
+    }
+}
+
+//presence check of a link without status pins, called by its RX task for every byte and read timeout
+//an open UART proves nothing: the link is ready from the first byte of the copter on and down after
+//BT_AUX_SILENT_MS without one. Every BT_AUX_PROBE_MS without a byte MSP_STATUS is requested,
+//a copter answers every MSP request.
+static void aux_presence(bt_link_t *link, bool received)
+{
+    static const char probe[6] = { '$', 'M', '<', 0, MSP_STATUS, MSP_STATUS };
+    uint32_t now = Clock_getTicks();
+
+    if(received)
+    {
+        link->rxTick = now;
+        if(!link->ready)
+        {
+            bt_setReady(link, true);
+        }
+        return;
+    }
+    if(link->ready && now - link->rxTick >= BT_AUX_SILENT_MS)
+    {
+        bt_setReady(link, false);
+    }
+    send_data(link, (char *)probe, sizeof(probe));
+}
+
+//Link RX task, one per link (arg0): receives everything the module sends once the UART is open
+void UART_Task(UArg arg0, UArg arg1)
+{
+    bt_link_t *link = (bt_link_t *)arg0;
+    int size;
+    char rxByte;
+
+    if(!link->hw->managed)
+    {
+        //nothing to power up or connect: the module forwards everything from the start,
+        //the link is ready once the copter answers (aux_presence)
+        if(!bt_openUart(link))
+        {
+            System_printf("Error opening the UART of link %s\n", link->hw->name);
+            System_flush();
+            return;
+        }
+        bt_setDataMode(link, true);
+    }
+    Semaphore_pend(Semaphore_handle(&link->rxStartSem), BIOS_WAIT_FOREVER);
+
+    //blocks until data is available (or BT_AUX_PROBE_MS passed on the aux link)
+    while(1)
+    {
+        size = UART_read(link->uart, &rxByte, 1);
+        if(size == UART_ERROR)
+        {
+            link->stats.rxErrors++;
+            metrics_inc(MET_UART_RX_ERRORS);
+            System_printf("Error on reading uart of link %s!\n", link->hw->name);
+            System_flush();
+            continue;
+        }
+        if(!link->hw->managed)
+        {
+            aux_presence(link, size > 0);
+        }
+        if(size == 0)
+        {
+            continue;
+        }
+        link->stats.rxBytes++;
+        metrics_inc(MET_RX_BYTES);
+
+        if(!link->rxDataMode)
+        {
+            rx_command_char(link, rxByte);
+        }
+        else
+        {
+            rx_telemetry_char(link, rxByte);
+        }
+    }
+}
+
+//status pins of the bluetooth module signal that it finished booting
+//STATUS2 (Q0) and STATUS1 (Q3) must not be high both
+bool bt_module_started(const bt_link_t *link)
+{
+    const bt_link_hw_t *hw = link->hw;
+
+    return hw->statusPort == 0 || (GPIOPinRead(hw->statusPort, hw->status2Pin) == 0x00)
+           || (GPIOPinRead(hw->statusPort, hw->status1Pin) == 0x00);
+}
+
+//status pins of the bluetooth module while a connection is established
+//STATUS2 (Q0) low and STATUS1 (Q3) high
+bool bt_link_connected(const bt_link_t *link)
+{
+    const bt_link_hw_t *hw = link->hw;
+
+    return hw->statusPort == 0 || ((GPIOPinRead(hw->statusPort, hw->status2Pin) == 0x00)
+                                   && (GPIOPinRead(hw->statusPort, hw->status1Pin) != 0x00));
 }
 
+//lists the links and selects the route of the controls
+static void cmd_link(uint8_t argc, char *argv[])
+{
+    bt_link_stats_t stats;
+    bt_link_t *link;
+    uint8_t i;
+
+    if(argc == 3 && strcmp(argv[1], "select") == 0)
+    {
+        if(strcmp(argv[2], "all") == 0)
+        {
+            bt_setRoute(BT_ROUTE_ALL);
+        }
+        else if(argv[2][0] >= '0' && argv[2][0] < '0' + BT_LINK_COUNT && argv[2][1] == '\0')
+        {
+            bt_setRoute(argv[2][0] - '0');
+        }
+        else
+        {
+            console_printf("no link %s\r\n", argv[2]);
+            return;
+        }
+    }
+    else if(argc != 1)
+    {
+        console_printf("usage: link [select <0-%u>|all]\r\n", BT_LINK_COUNT - 1);
+        return;
+    }
+
+    for(i = 0; i < BT_LINK_COUNT; i++)
+    {
+        link = &links[i];
+        bt_getStats(link, &stats);
+        console_printf("%c%u %s: %s, %s mode, %u baud\r\n", (route == BT_ROUTE_ALL || route == i) ? '*' : ' ',
+                       i, link->hw->name, link->ready ? "ready" : "down", link->rxDataMode ? "data" : "command",
+                       link->baudRate);
+        console_printf("   tx %u frames in %u packets, %u dropped, %u errors, %u RTS stalls, %u timeouts\r\n",
+                       stats.tx.frames, stats.tx.packets, stats.tx.dropped, stats.txErrors, stats.rtsStalls,
+                       stats.txTimeouts);
+        console_printf("   rx %u bytes, %u errors\r\n", stats.rxBytes, stats.rxErrors);
+    }
+}
+
+static const console_cmd_t linkCmd = { "link", "copter links, * = route: select <n>|all", cmd_link };
+
 //sets up all necessary pins for using UART6 and for using the bluetooth module on the boosterpack2 slot
-//also creates task to connect and controll the copter
+//and UART7 for the second link, creates the tasks of every link and starts the connection manager (see connection.c)
+//does not block, the power up sequence runs after BIOS_start
 int setup_UART()
 {
     //configure uart6
@@ -268,6 +993,13 @@ int setup_UART()
     GPIOPinConfigure(GPIO_PP1_U6TX); //P1 connects to data input (RX) of bluetooth module
     GPIOPinTypeUART(GPIO_PORTP_BASE, GPIO_PIN_1 | GPIO_PIN_0);
 
+    //C4 and C5 for uart7, module of the second link (BT_LINK_AUX)
+    SysCtlPeripheralEnable(SYSCTL_PERIPH_GPIOC);
+    SysCtlPeripheralEnable(SYSCTL_PERIPH_UART7);
+    GPIOPinConfigure(GPIO_PC4_U7RX);
+    GPIOPinConfigure(GPIO_PC5_U7TX);
+    GPIOPinTypeUART(GPIO_PORTC_BASE, GPIO_PIN_4 | GPIO_PIN_5);
+
     UART_init();
 
     //see jumper4 -> uart -> D4 = INT on boosterpack -> CTS on bluetooth module (input) = Clear to send
@@ -306,26 +1038,48 @@ int setup_UART()
     GPIOPinTypeGPIOOutput(GPIO_PORTM_BASE, GPIO_PIN_7);
     GPIOPadConfigSet(GPIO_PORTM_BASE, GPIO_PIN_7, GPIO_STRENGTH_2MA, GPIO_PIN_TYPE_STD_WPU);
 
-    //initialize bluetooth module
-    init_bt_module();
-    System_printf("Bluetooth module initialized\n");
-    System_flush();
-
-    //Create the task
+    Semaphore_Params semParams;
     Task_Params UART_Task_Params;
-    Task_Handle UART_Task_Handle;
-    Error_Block eb;
+    bt_link_t *link;
+    uint8_t i;
 
-    Error_init(&eb);
-    Task_Params_init(&UART_Task_Params);
-    UART_Task_Params.stackSize = 1024; /* stack in bytes */
-    UART_Task_Params.priority = 15; /* 0-15 (15 is highest priority on default -> see RTOS Task configuration) */
-    UART_Task_Handle = Task_create((Task_FuncPtr)UART_Task, &UART_Task_Params, &eb);
-    if (UART_Task_Handle == NULL)
+    for(i = 0; i < BT_LINK_COUNT; i++)
     {
-        System_printf("Failed to create UART task");
-        System_flush();
-        return NULL;
+        link = &links[i];
+        link->hw = &linkHw[i];
+        link->index = i;
+        link->payloadSize = BT_PAYLOAD_DEFAULT;
+        link->baudRate = link->hw->managed ? config->baudRate : BT_AUX_BAUD;
+
+        Semaphore_Params_init(&semParams);
+        semParams.mode = Semaphore_Mode_BINARY;
+        Semaphore_construct(&link->txSem, 0, &semParams);
+        Semaphore_construct(&link->rxStartSem, 0, &semParams);
+        Semaphore_Params_init(&semParams);
+        Semaphore_construct(&link->txLock, 1, &semParams);
+
+        //Construct the tasks (static stacks, nothing is taken from the heap)
+        //all TX tasks share one priority and all RX tasks another, the links take turns
+        Task_Params_init(&UART_Task_Params);
+        UART_Task_Params.arg0 = (UArg)link;
+        UART_Task_Params.stack = &rxTaskStacks[i];
+        UART_Task_Params.stackSize = sizeof(rxTaskStacks[i]); /* stack in bytes */
+        UART_Task_Params.priority = TASK_PRIO_LINK_RX; /* 0-15 (15 is highest priority on default -> see RTOS Task configuration) */
+        Task_construct(&rxTaskStructs[i], (Task_FuncPtr)UART_Task, &UART_Task_Params, NULL);
+        sysmon_registerTask(Task_handle(&rxTaskStructs[i]), link->hw->rxTaskName);
+
+        Task_Params_init(&UART_Task_Params);
+        UART_Task_Params.arg0 = (UArg)link;
+        UART_Task_Params.stack = &txTaskStacks[i];
+        UART_Task_Params.stackSize = sizeof(txTaskStacks[i]);
+        UART_Task_Params.priority = TASK_PRIO_LINK_TX;
+        Task_construct(&txTaskStructs[i], (Task_FuncPtr)linkTx_fnx, &UART_Task_Params, NULL);
+        sysmon_registerTask(Task_handle(&txTaskStructs[i]), link->hw->txTaskName);
     }
+
+    sysmon_addReport(bt_reportTx);
+    console_addCommand(&linkCmd);
+    btcmd_start();
+    conn_start();
     return 1;
 }
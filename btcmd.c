@@ -0,0 +1,209 @@
+/*
+ * btcmd.c
+ *
+ *  Created on: 19.10.2026
+ *
+ *  Pipelined command channel to the RN4871, see btcmd.h
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include <xdc/std.h>
+#include <ti/sysbios/knl/Clock.h>
+
+#include <bluetooth.h>
+#include <btcmd.h>
+#include <executor.h>
+
+static exec_job_t btcmdJob;
+static bt_link_t *link;     //the link of the RN4871 (BT_LINK_MODULE)
+
+//queue of submitted commands: head = oldest outstanding, unsent = next one to send
+static btcmd_t *head = NULL;
+static btcmd_t *unsent = NULL;
+static btcmd_t *tail = NULL;
+static uint8_t inFlight = 0;
+
+static btcmd_event_fnx_t eventHandler = NULL;
+
+static bool starts_with(const char *text, const char *prefix)
+{
+    return strncmp(text, prefix, strlen(prefix)) == 0;
+}
+
+//queues a command, returns false if it is still in use
+bool btcmd_submit(btcmd_t *cmd)
+{
+    if(cmd->status == BTCMD_QUEUED || cmd->status == BTCMD_SENT)
+    {
+        return false;
+    }
+    cmd->status = BTCMD_QUEUED;
+    cmd->next = NULL;
+    if(tail == NULL)
+    {
+        head = cmd;
+    }
+    else
+    {
+        tail->next = cmd;
+    }
+    tail = cmd;
+    if(unsent == NULL)
+    {
+        unsent = cmd;
+    }
+    exec_wake();
+    return true;
+}
+
+//true once the command finished with any result
+bool btcmd_done(const btcmd_t *cmd)
+{
+    return cmd->status >= BTCMD_OK;
+}
+
+//true if no command is queued or outstanding
+bool btcmd_idle(void)
+{
+    return head == NULL;
+}
+
+//removes the oldest command from the queue with the given result
+static void complete_head(uint8_t status)
+{
+    btcmd_t *cmd = head;
+
+    head = cmd->next;
+    if(head == NULL)
+    {
+        tail = NULL;
+    }
+    if(cmd->status == BTCMD_SENT)
+    {
+        inFlight--;
+    }
+    cmd->status = status;
+
+    //timeout of the next command starts now, the module works on it from here
+    if(head != NULL && head->status == BTCMD_SENT)
+    {
+        head->deadline = Clock_getTicks() + head->timeoutMs;
+    }
+    exec_wake(); //jobs waiting for this command
+}
+
+//aborts all queued and outstanding commands and drops received lines
+//used when the module leaves command mode or answers got out of order
+void btcmd_flush(void)
+{
+    while(head != NULL)
+    {
+        complete_head(BTCMD_ABORTED);
+    }
+    unsent = NULL;
+    inFlight = 0;
+    bt_flushLines(link);
+}
+
+void btcmd_setEventHandler(btcmd_event_fnx_t fnx)
+{
+    eventHandler = fnx;
+}
+
+//matches one response line against the oldest outstanding command
+static void handle_line(const bt_line_t *line)
+{
+    if(head != NULL && head->status == BTCMD_SENT)
+    {
+        if(starts_with(line->text, head->expect))
+        {
+            if(head->response != NULL)
+            {
+                memcpy(head->response, line, sizeof(bt_line_t));
+            }
+            complete_head(BTCMD_OK);
+            return;
+        }
+        if(starts_with(line->text, "ERR") || starts_with(line->text, "%ERR")
+           || (starts_with(line->text, "%DISCONNECT") && starts_with(head->expect, "%")))
+        {
+            complete_head(BTCMD_FAIL);
+            return;
+        }
+    }
+    if(eventHandler != NULL)
+    {
+        eventHandler(line->text);
+    }
+}
+
+//sends queued commands as long as the pipeline has free slots
+static void send_queued(void)
+{
+    while(unsent != NULL && inFlight < BTCMD_PIPELINE_DEPTH)
+    {
+        btcmd_t *cmd = unsent;
+
+        unsent = cmd->next;
+        cmd->status = BTCMD_SENT;
+        cmd->deadline = Clock_getTicks() + cmd->timeoutMs;
+        inFlight++;
+        if(cmd->cmd != NULL)
+        {
+            bt_sendCommand(link, cmd->cmd);
+        }
+    }
+}
+
+//processes received lines, timeouts and the send queue
+static void process(void)
+{
+    bt_line_t line;
+
+    while(bt_readLine(link, &line))
+    {
+        handle_line(&line);
+    }
+
+    if(head != NULL && head->status == BTCMD_SENT && (int32_t)(Clock_getTicks() - head->deadline) > 0)
+    {
+        //the answers of all later commands cannot be assigned anymore
+        complete_head(BTCMD_TIMEOUT);
+        while(head != NULL && head->status == BTCMD_SENT)
+        {
+            complete_head(BTCMD_ABORTED);
+        }
+        bt_flushLines(link);
+    }
+
+    send_queued();
+}
+
+//true if process() has something to do
+static bool work_pending(void)
+{
+    return bt_lineAvailable(link)
+           || (unsent != NULL && inFlight < BTCMD_PIPELINE_DEPTH)
+           || (head != NULL && head->status == BTCMD_SENT && (int32_t)(Clock_getTicks() - head->deadline) > 0);
+}
+
+//executor job: re-checks on every received line (exec_wake) and every EXEC_POLL_MS for timeouts
+static int btcmd_job(exec_job_t *job)
+{
+    JOB_BEGIN(job);
+    while(1)
+    {
+        process();
+        JOB_WAIT_UNTIL(job, work_pending());
+    }
+    JOB_END(job);
+}
+
+void btcmd_start(void)
+{
+    link = bt_getLink(BT_LINK_MODULE);
+    exec_add(&btcmdJob, btcmd_job, "btcmd");
+}
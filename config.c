@@ -0,0 +1,326 @@
+/*
+ * config.c
+ *
+ *  Created on: 19.10.2026
+ *
+ *  Persistent configuration in the on-chip EEPROM.
+ *  A profile is stored as one record of key/length/value entries behind a header with
+ *  version, sequence number and CRC-32. Every commit writes the complete record into the
+ *  next of CFG_SLOT_COUNT slots, on boot the valid record with the highest sequence number wins.
+ *  An interrupted write only damages the new slot, the previous profile stays valid.
+ *  Unknown keys and entries of another size are skipped, their values keep the defaults.
+ *  Readers use the RAM cache (config->...), the EEPROM is only read once in config_init.
+ *  The cache is double buffered: a new profile is copied into the unused buffer and published
+ *  with a single pointer write, readers never take a lock and never see a half-written profile.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+
+#include <driverlib/eeprom.h>
+#include <driverlib/sysctl.h>
+
+#include <xdc/std.h>
+#include <xdc/runtime/System.h>
+
+#include <ti/sysbios/BIOS.h>
+#include <ti/sysbios/knl/Clock.h>
+#include <ti/sysbios/knl/Semaphore.h>
+
+#include <bluetooth.h>
+#include <config.h>
+#include <tasks.h>
+
+typedef struct cfg_header_t {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t length;    //bytes of entries behind the header
+    uint32_t sequence;
+    uint32_t crc;       //over the header up to crc and the entries
+} cfg_header_t;
+
+#define CFG_DATA_SIZE   (CFG_SLOT_SIZE - sizeof(cfg_header_t))
+
+//size and position of every key in config_t
+typedef struct cfg_entry_t {
+    uint8_t key;
+    uint8_t size;
+    uint16_t offset;
+} cfg_entry_t;
+
+static const cfg_entry_t entries[] = {
+    { CFG_KEY_COPTER, sizeof(cfg_copter_t), offsetof(config_t, copter) },
+    { CFG_KEY_THROTTLE_STEP, sizeof(uint16_t), offsetof(config_t, throttleStep) },
+    { CFG_KEY_STICK_CAL, sizeof(cfg_stick_cal_t), offsetof(config_t, stickCal) },
+    { CFG_KEY_RATES, sizeof(cfg_rate_t) * CFG_AXIS_COUNT, offsetof(config_t, rates) },
+    { CFG_KEY_BAUD_RATE, sizeof(uint32_t), offsetof(config_t, baudRate) },
+    { CFG_KEY_LOOP_PERIOD, sizeof(uint16_t), offsetof(config_t, loopPeriodMs) },
+    { CFG_KEY_FILTER, sizeof(uint8_t), offsetof(config_t, filterShift) },
+    { CFG_KEY_TX_KEEPALIVE, sizeof(uint8_t), offsetof(config_t, txKeepalive) },
+};
+#define ENTRY_COUNT (sizeof(entries) / sizeof(entries[0]))
+
+static config_t cache[2];
+const config_t * volatile config = &cache[0];
+static uint32_t lastSwap = 0;
+static bool swapped = false;
+
+static bool eepromReady = false;
+static uint8_t nextSlot = 0;
+static uint32_t sequence = 0;
+static uint32_t slot[CFG_SLOT_SIZE / 4];
+static Semaphore_Struct commitLock;    //one commit at a time, slot is shared
+
+static uint32_t crc32(uint32_t crc, const uint8_t *data, uint32_t size)
+{
+    uint8_t bit;
+
+    while(size--)
+    {
+        crc ^= *data++;
+        for(bit = 0; bit < 8; bit++)
+        {
+            crc = (crc >> 1) ^ (0xEDB88320 & -(crc & 1));
+        }
+    }
+    return crc;
+}
+
+static uint32_t record_crc(const cfg_header_t *header)
+{
+    uint32_t crc = crc32(0xFFFFFFFF, (const uint8_t *)header, offsetof(cfg_header_t, crc));
+    return ~crc32(crc, (const uint8_t *)(header + 1), header->length);
+}
+
+static const cfg_entry_t *find_entry(uint8_t key)
+{
+    uint8_t i;
+    for(i = 0; i < ENTRY_COUNT; i++)
+    {
+        if(entries[i].key == key)
+        {
+            return &entries[i];
+        }
+    }
+    return NULL;
+}
+
+//checks the record in slot, returns false if it is empty or damaged
+static bool record_valid(void)
+{
+    const cfg_header_t *header = (const cfg_header_t *)slot;
+
+    return header->magic == CFG_MAGIC
+        && header->version == CFG_VERSION
+        && header->length <= CFG_DATA_SIZE
+        && header->crc == record_crc(header);
+}
+
+//applies the entries of the record in slot to profile
+static void record_load(config_t *profile)
+{
+    const cfg_header_t *header = (const cfg_header_t *)slot;
+    const uint8_t *data = (const uint8_t *)(header + 1);
+    uint16_t pos = 0;
+
+    while(pos + 2 <= header->length)
+    {
+        const cfg_entry_t *entry = find_entry(data[pos]);
+        uint8_t size = data[pos + 1];
+
+        if(pos + 2 + size > header->length)
+        {
+            break;
+        }
+        if(entry != NULL && entry->size == size)
+        {
+            memcpy((uint8_t *)profile + entry->offset, &data[pos + 2], size);
+        }
+        pos += 2 + size;
+    }
+}
+
+//builds the record of profile in slot
+static void record_build(const config_t *profile)
+{
+    cfg_header_t *header = (cfg_header_t *)slot;
+    uint8_t *data = (uint8_t *)(header + 1);
+    uint16_t pos = 0;
+    uint8_t i;
+
+    memset(slot, 0xFF, sizeof(slot));
+    for(i = 0; i < ENTRY_COUNT; i++)
+    {
+        data[pos] = entries[i].key;
+        data[pos + 1] = entries[i].size;
+        memcpy(&data[pos + 2], (const uint8_t *)profile + entries[i].offset, entries[i].size);
+        pos += 2 + entries[i].size;
+    }
+
+    header->magic = CFG_MAGIC;
+    header->version = CFG_VERSION;
+    header->length = pos;
+    header->sequence = sequence + 1;
+    header->crc = record_crc(header);
+}
+
+//values used as long as nothing is stored
+void config_defaults(config_t *profile)
+{
+    uint8_t i;
+
+    memset(profile, 0, sizeof(config_t));
+    profile->throttleStep = 25;
+    for(i = 0; i < CFG_AXIS_COUNT; i++)
+    {
+        profile->rates[i].rate = 100;
+        profile->rates[i].expo = 0;
+    }
+    profile->baudRate = BT_BAUD_DEFAULT;
+    profile->loopPeriodMs = CONTROL_PERIOD_MS;
+    profile->filterShift = 0;
+    profile->txKeepalive = 0;
+}
+
+//loads the newest valid profile into the RAM cache, must be called in main before the tasks are set up
+void config_init(void)
+{
+    uint32_t bestSequence = 0;
+    int8_t best = -1;
+    uint8_t i;
+
+    Semaphore_Params semParams;
+    Semaphore_Params_init(&semParams);
+    semParams.mode = Semaphore_Mode_BINARY;
+    Semaphore_construct(&commitLock, 1, &semParams);
+
+    config_defaults(&cache[0]);
+
+    SysCtlPeripheralEnable(SYSCTL_PERIPH_EEPROM0);
+    while(!SysCtlPeripheralReady(SYSCTL_PERIPH_EEPROM0))
+    {}
+    if(EEPROMInit() != EEPROM_INIT_OK)
+    {
+        System_printf("EEPROM not available, using the default configuration\n");
+        System_flush();
+        return;
+    }
+    eepromReady = true;
+
+    for(i = 0; i < CFG_SLOT_COUNT; i++)
+    {
+        EEPROMRead(slot, CFG_EEPROM_BASE + i * CFG_SLOT_SIZE, CFG_SLOT_SIZE);
+        if(record_valid() && (best < 0 || (int32_t)(((cfg_header_t *)slot)->sequence - bestSequence) > 0))
+        {
+            best = i;
+            bestSequence = ((cfg_header_t *)slot)->sequence;
+        }
+    }
+    if(best < 0)
+    {
+        System_printf("No configuration stored, using defaults\n");
+        System_flush();
+        return;
+    }
+
+    EEPROMRead(slot, CFG_EEPROM_BASE + best * CFG_SLOT_SIZE, CFG_SLOT_SIZE);
+    record_load(&cache[0]);
+    sequence = bestSequence;
+    nextSlot = (best + 1) % CFG_SLOT_COUNT;
+    System_printf("Configuration %u loaded from slot %u\n", sequence, best);
+    System_flush();
+}
+
+//true if a profile can be published: the unused buffer may still be read by a task that took the
+//pointer before the last swap, it is only reused CFG_SWAP_GRACE_MS after that swap (reader contract, config.h)
+//publishing never waits for this, executor jobs wait with JOB_WAIT_UNTIL(job, config_ready())
+bool config_ready(void)
+{
+    return !swapped || Clock_getTicks() - lastSwap >= CFG_SWAP_GRACE_MS;
+}
+
+//copies profile into the unused buffer and swaps the pointer, commitLock must be taken and config_ready()
+static void publish_locked(const config_t *profile)
+{
+    config_t *next = (config == &cache[0]) ? &cache[1] : &cache[0];
+
+    *next = *profile;
+    config = next;
+    lastSwap = Clock_getTicks();
+    swapped = true;
+}
+
+//makes profile the current one without storing it, must be called from a task
+//returns false if the last swap is too recent (config_ready)
+bool config_publish(const config_t *profile)
+{
+    bool result = false;
+
+    Semaphore_pend(Semaphore_handle(&commitLock), BIOS_WAIT_FOREVER);
+    if(config_ready())
+    {
+        publish_locked(profile);
+        result = true;
+    }
+    Semaphore_post(Semaphore_handle(&commitLock));
+    return result;
+}
+
+//writes profile into the next slot and publishes it, commitLock must be taken
+static bool commit_locked(const config_t *profile)
+{
+    if(!eepromReady || !config_ready())
+    {
+        return false;
+    }
+
+    record_build(profile);
+    if(EEPROMProgram(slot, CFG_EEPROM_BASE + nextSlot * CFG_SLOT_SIZE, CFG_SLOT_SIZE) != 0)
+    {
+        System_printf("Configuration write to slot %u failed\n", nextSlot);
+        System_flush();
+        nextSlot = (nextSlot + 1) % CFG_SLOT_COUNT; //the next commit tries another slot
+        return false;
+    }
+    sequence++;
+    nextSlot = (nextSlot + 1) % CFG_SLOT_COUNT;
+
+    publish_locked(profile);
+    return true;
+}
+
+//stores a complete profile and makes it the current one, either all values change or none
+//must be called from a task, returns false if the last swap is too recent (config_ready)
+//or the EEPROM write failed
+bool config_commit(const config_t *profile)
+{
+    bool result;
+
+    Semaphore_pend(Semaphore_handle(&commitLock), BIOS_WAIT_FOREVER);
+    result = commit_locked(profile);
+    Semaphore_post(Semaphore_handle(&commitLock));
+    return result;
+}
+
+//changes a single value and commits the profile
+//returns false for an unknown key, if the last swap is too recent (config_ready)
+//or the EEPROM write failed
+bool config_set(cfg_key_t key, const void *value)
+{
+    static config_t profile;    //too large for the stacks of the callers, protected by commitLock
+    const cfg_entry_t *entry = find_entry(key);
+    bool result;
+
+    if(entry == NULL)
+    {
+        return false;
+    }
+    Semaphore_pend(Semaphore_handle(&commitLock), BIOS_WAIT_FOREVER);
+    profile = *config;
+    memcpy((uint8_t *)&profile + entry->offset, value, entry->size);
+    result = commit_locked(&profile);
+    Semaphore_post(Semaphore_handle(&commitLock));
+    return result;
+}
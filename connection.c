@@ -0,0 +1,694 @@
+/*
+ * connection.c
+ *
+ *  Created on: 19.10.2026
+ *
+ *  Connection manager for the RN4871 bluetooth module, runs as a job of the housekeeping executor.
+ *  Every step submits its command to the command channel (btcmd.c) and waits for the response without blocking:
+ *    power up -> command mode ("$$$") -> [scan ("F")] -> connect ("C,<type>,<mac>") -> status pins -> data mode ("---")
+ *  The copter is taken from the EEPROM cache, a scan (scan.c) only runs without a cached copter,
+ *  when the pilot holds the select button at power up or when the cached copter cannot be reached.
+ *  While connected the status pins are polled, a link loss releases the control path
+ *  (CONTROL_EVT_LINK_DOWN) and the sequence starts over with exponential backoff.
+ *  The module is reset after CONN_ATTEMPTS_BEFORE_RESET failed attempts in a row.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include <driverlib/gpio.h>
+#include <inc/hw_memmap.h>
+
+#include <ti/drivers/GPIO.h>
+
+#include <Board.h>
+
+#include <xdc/std.h>
+#include <xdc/runtime/System.h>
+
+#include <ti/sysbios/hal/Hwi.h>
+#include <ti/sysbios/knl/Clock.h>
+
+#include <bluetooth.h>
+#include <btcmd.h>
+#include <config.h>
+#include <connection.h>
+#include <executor.h>
+#include <joystick.h>
+#include <metrics.h>
+#include <scan.h>
+#include <sysmon.h>
+
+static exec_job_t connJob;
+static conn_stats_t stats;
+static bt_link_t *link;     //the link of the RN4871 (BT_LINK_MODULE)
+
+//time stamps of the current step/attempt in Clock ticks (ms)
+static uint32_t stepTick;
+static uint32_t attemptTick;
+static uint32_t lostTick;
+static bool wasConnected = false;
+
+//module state
+static bool inCommandMode = false;
+static bool configured = false;
+
+//commands of the connection sequence
+static btcmd_t cmdEnter = { "$$$", "CMD", CONN_CMD_TIMEOUT_MS };
+static char connectCmdText[20]; //"C,<type>,<mac>\r"
+static btcmd_t cmdConnect = { connectCmdText, "%CONNECT", CONN_CONNECT_TIMEOUT_MS };
+
+//copter to connect to, from the EEPROM cache or selected by the pilot after a scan
+static exec_job_t scanJob;
+static scan_device_t target;
+static bool haveTarget = false;
+static bool scanRequested = false;
+static uint8_t resetsWithoutLink = 0;
+static btcmd_t cmdLeave = { "---\r", "END", CONN_DATA_TIMEOUT_MS };
+
+//configuration after every power up, submitted at once and sent pipelined
+static bt_line_t versionLine;
+static btcmd_t setupCmds[] = {
+    { "V\r", "RN487", CONN_SETUP_TIMEOUT_MS, &versionLine },  //firmware version, logged
+    { "SGA,0\r", "AOK", CONN_SETUP_TIMEOUT_MS },              //advertising TX power: highest
+    { "SGC,0\r", "AOK", CONN_SETUP_TIMEOUT_MS },              //connected TX power: highest
+};
+#define SETUP_CMD_COUNT (sizeof(setupCmds) / sizeof(setupCmds[0]))
+
+//baud rates of the RN4871 with their "SB" command, highest first
+typedef struct conn_baud_t {
+    uint32_t rate;
+    const char *cmd;
+} conn_baud_t;
+
+static const conn_baud_t bauds[] = {
+    { 921600, "SB,00\r" },
+    { 460800, "SB,01\r" },
+    { 230400, "SB,02\r" },
+    { 115200, "SB,03\r" },
+};
+#define BAUD_COUNT (sizeof(bauds) / sizeof(bauds[0]))
+
+//baud rate upgrade, runs as child job of the connection job
+static exec_job_t baudJob;
+static bool baudNegotiated = false;
+static uint8_t probeIndex = 0;
+static btcmd_t cmdSetBaud = { NULL, "AOK", CONN_SETUP_TIMEOUT_MS };
+static btcmd_t cmdReboot = { "R,1\r", "Rebooting", CONN_SETUP_TIMEOUT_MS };
+static btcmd_t cmdRebooted = { NULL, "%REBOOT%", CONN_REBOOT_TIMEOUT_MS };
+static btcmd_t cmdVerify = { "V\r", "RN487", CONN_SETUP_TIMEOUT_MS };
+
+//true once the current step ran longer than timeoutMs
+static bool step_timed_out(uint32_t timeoutMs)
+{
+    return (Clock_getTicks() - stepTick) > timeoutMs;
+}
+
+//submits all setup commands, the command channel pipelines them
+static void submit_setup(void)
+{
+    uint8_t i;
+    for(i = 0; i < SETUP_CMD_COUNT; i++)
+    {
+        btcmd_submit(&setupCmds[i]);
+    }
+}
+
+//true once all setup commands are answered, failed ones are reported
+static bool setup_done(void)
+{
+    uint8_t i;
+    for(i = 0; i < SETUP_CMD_COUNT; i++)
+    {
+        if(!btcmd_done(&setupCmds[i]))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void report_setup(void)
+{
+    uint8_t i;
+
+    System_printf("Module configured in %u ms: %s\n", Clock_getTicks() - stepTick, versionLine.text);
+    for(i = 0; i < SETUP_CMD_COUNT; i++)
+    {
+        if(setupCmds[i].status != BTCMD_OK)
+        {
+            System_printf("  setup command %u failed (%u)\n", i, setupCmds[i].status);
+        }
+    }
+    System_flush();
+}
+
+//switches UART6 to the next rate of the baud table
+//used when the module does not answer, it may still run at a rate negotiated before
+static void probe_next_baud(void)
+{
+    probeIndex = (probeIndex + 1) % BAUD_COUNT;
+    bt_setBaudRate(link, bauds[probeIndex].rate);
+    System_printf("Probing bluetooth module at %u baud\n", bauds[probeIndex].rate);
+    System_flush();
+}
+
+//remembers the rate the module answers at, the next boot starts with it instead of probing
+static void store_baud(void)
+{
+    uint32_t rate = bt_getBaudRate(link);
+
+    if(rate != config->baudRate && !config_set(CFG_KEY_BAUD_RATE, &rate))
+    {
+        System_printf("Baud rate not stored\n");
+        System_flush();
+    }
+}
+
+//child job: raises the baud rate step by step, starting at CONN_BAUD_MAX
+//the module only switches after a reboot, the new rate is verified with "$$$" and "V"
+//on failure UART6 falls back to the previous rate
+static int baud_job(exec_job_t *job)
+{
+    static uint8_t i;
+    static uint32_t oldRate;
+
+    JOB_BEGIN(job);
+
+    for(i = 0; i < BAUD_COUNT && bauds[i].rate > bt_getBaudRate(link); i++)
+    {
+        if(bauds[i].rate > CONN_BAUD_MAX)
+        {
+            continue;
+        }
+        oldRate = bt_getBaudRate(link);
+
+        cmdSetBaud.cmd = bauds[i].cmd;
+        btcmd_submit(&cmdSetBaud);
+        btcmd_submit(&cmdReboot);
+        JOB_WAIT_UNTIL(job, btcmd_done(&cmdReboot));
+        if(cmdSetBaud.status != BTCMD_OK || cmdReboot.status != BTCMD_OK)
+        {
+            continue;
+        }
+
+        //the module comes up at the new rate
+        bt_setBaudRate(link, bauds[i].rate);
+        btcmd_flush();
+        btcmd_submit(&cmdRebooted);
+        JOB_WAIT_UNTIL(job, btcmd_done(&cmdRebooted));
+        btcmd_submit(&cmdEnter);
+        JOB_WAIT_UNTIL(job, btcmd_done(&cmdEnter));
+        if(cmdEnter.status == BTCMD_OK)
+        {
+            //"V" only after the module confirmed the command mode
+            btcmd_submit(&cmdVerify);
+            JOB_WAIT_UNTIL(job, btcmd_done(&cmdVerify));
+        }
+        if(cmdEnter.status == BTCMD_OK && cmdVerify.status == BTCMD_OK)
+        {
+            probeIndex = i;
+            JOB_WAIT_UNTIL(job, config_ready()); //config_set must not wait inside the executor
+            store_baud();
+            System_printf("UART6 now at %u baud, control frame %u us on the wire\n",
+                          bauds[i].rate, (MSP_RC_FRAME_SIZE * 10 * 1000000) / bauds[i].rate);
+            System_flush();
+            JOB_EXIT(job);
+        }
+
+        //no valid answer at the new rate -> back to the old one, probing finds the module otherwise
+        System_printf("Module did not answer at %u baud, falling back to %u\n", bauds[i].rate, oldRate);
+        System_flush();
+        bt_setBaudRate(link, oldRate);
+        btcmd_flush();
+        inCommandMode = false;
+        JOB_EXIT(job);
+    }
+
+    JOB_END(job);
+}
+
+//connection parameter profiles, requested with "T" after connecting and on conn_requestProfile
+//the supervision timeout must be longer than (1 + latency) * intervalMax * 2
+static const conn_params_t profiles[CONN_PROFILE_COUNT] = {
+    { 6, 12, 0, 50 },       //flight: 7.5-15 ms, no latency, 500 ms timeout
+    { 40, 80, 4, 400 },     //idle: 50-100 ms, 4 events latency, 4 s timeout
+};
+static const char *profileNames[CONN_PROFILE_COUNT] = { "flight", "idle" };
+
+//child job: requests the connection parameters of requestedProfile and waits for the result
+static exec_job_t paramJob;
+static volatile conn_profile_t requestedProfile = CONN_PROFILE_FLIGHT;
+static conn_profile_t activeProfile = CONN_PROFILE_COUNT;
+static conn_params_t negotiated;
+static bool negotiatedValid = false;
+static char paramCmdText[24]; //"T,xxxx,xxxx,xxxx,xxxx\r"
+static bt_line_t paramLine;
+static btcmd_t cmdParam = { paramCmdText, "AOK", CONN_SETUP_TIMEOUT_MS };
+static btcmd_t cmdParamResult = { NULL, "%CONN_PARAM", CONN_PARAM_TIMEOUT_MS, &paramLine };
+
+static char *put_hex16(char *dst, uint16_t value)
+{
+    static const char hex[] = "0123456789ABCDEF";
+    int8_t shift;
+
+    for(shift = 12; shift >= 0; shift -= 4)
+    {
+        *dst++ = hex[(value >> shift) & 0xF];
+    }
+    return dst;
+}
+
+static uint16_t parse_hex16(const char *text)
+{
+    uint16_t value = 0;
+    uint8_t i;
+
+    for(i = 0; i < 4; i++)
+    {
+        char c = text[i];
+        value <<= 4;
+        if(c >= '0' && c <= '9')
+        {
+            value |= c - '0';
+        }
+        else if(c >= 'A' && c <= 'F')
+        {
+            value |= c - 'A' + 10;
+        }
+        else if(c >= 'a' && c <= 'f')
+        {
+            value |= c - 'a' + 10;
+        }
+    }
+    return value;
+}
+
+//"%CONN_PARAM,<interval>,<latency>,<timeout>%" with 4 digit hex values
+static void parse_conn_param(const char *line)
+{
+    if(strlen(line) < 27)
+    {
+        return;
+    }
+    negotiated.intervalMin = parse_hex16(&line[12]);
+    negotiated.intervalMax = negotiated.intervalMin;
+    negotiated.latency = parse_hex16(&line[17]);
+    negotiated.timeout = parse_hex16(&line[22]);
+    negotiatedValid = true;
+}
+
+//unsolicited messages of the module, the copter may change the parameters on its own
+static void conn_event(const char *line)
+{
+    if(scan_onEvent(line))
+    {
+        return;
+    }
+    if(strncmp(line, "%CONN_PARAM", 11) == 0)
+    {
+        parse_conn_param(line);
+    }
+}
+
+static int param_job(exec_job_t *job)
+{
+    static conn_profile_t profile;
+    static bool leaveCommandMode;
+    char *p;
+
+    JOB_BEGIN(job);
+
+    profile = requestedProfile;
+    p = paramCmdText;
+    *p++ = 'T';
+    *p++ = ',';
+    p = put_hex16(p, profiles[profile].intervalMin);
+    *p++ = ',';
+    p = put_hex16(p, profiles[profile].intervalMax);
+    *p++ = ',';
+    p = put_hex16(p, profiles[profile].latency);
+    *p++ = ',';
+    p = put_hex16(p, profiles[profile].timeout);
+    *p++ = '\r';
+    *p = '\0';
+
+    //while connected in data mode: switch to command mode for the request, control frames are dropped meanwhile
+    leaveCommandMode = !inCommandMode;
+    if(leaveCommandMode)
+    {
+        bt_setDataMode(link, false);
+        btcmd_flush();
+        btcmd_submit(&cmdEnter);
+        JOB_WAIT_UNTIL(job, btcmd_done(&cmdEnter));
+        if(cmdEnter.status != BTCMD_OK)
+        {
+            bt_setDataMode(link, true);
+            JOB_EXIT(job);
+        }
+    }
+
+    btcmd_submit(&cmdParam);
+    btcmd_submit(&cmdParamResult);
+    JOB_WAIT_UNTIL(job, btcmd_done(&cmdParamResult));
+    if(cmdParamResult.status == BTCMD_OK)
+    {
+        parse_conn_param(paramLine.text);
+    }
+    activeProfile = profile; //also on failure, the copter keeps its parameters then
+
+    if(negotiatedValid)
+    {
+        System_printf("Connection parameters (%s): interval %u us, latency %u, timeout %u ms\n",
+                      profileNames[profile], negotiated.intervalMax * 1250,
+                      negotiated.latency, negotiated.timeout * 10);
+        if(negotiated.intervalMax < profiles[profile].intervalMin || negotiated.intervalMax > profiles[profile].intervalMax)
+        {
+            System_printf("  copter did not accept the requested interval\n");
+        }
+        System_flush();
+    }
+
+    if(leaveCommandMode)
+    {
+        btcmd_submit(&cmdLeave);
+        JOB_WAIT_UNTIL(job, btcmd_done(&cmdLeave));
+        btcmd_flush();
+        bt_setDataMode(link, true);
+    }
+
+    JOB_END(job);
+}
+
+//requests another connection parameter profile, applied by the connection job while connected
+void conn_requestProfile(conn_profile_t profile)
+{
+    if(profile < CONN_PROFILE_COUNT)
+    {
+        requestedProfile = profile;
+        exec_wake();
+    }
+}
+
+//parameters the copter accepted, returns false if none were reported yet
+bool conn_getParams(conn_params_t *params)
+{
+    if(!negotiatedValid)
+    {
+        return false;
+    }
+    *params = negotiated;
+    return true;
+}
+
+//next backoff: CONN_BACKOFF_MIN_MS doubled on every failure up to CONN_BACKOFF_MAX_MS
+static uint32_t next_backoff(uint32_t backoff)
+{
+    if(backoff == 0)
+    {
+        return CONN_BACKOFF_MIN_MS;
+    }
+    backoff *= 2;
+    return (backoff > CONN_BACKOFF_MAX_MS) ? CONN_BACKOFF_MAX_MS : backoff;
+}
+
+static void link_up(void)
+{
+    uint32_t now = Clock_getTicks();
+
+    stats.connects++;
+    metrics_set(MET_LINK_UP, 1);
+    resetsWithoutLink = 0;
+    stats.lastConnectMs = now - attemptTick;
+    if(wasConnected)
+    {
+        metrics_inc(MET_RECONNECTS);
+        stats.lastOffAirMs = now - lostTick;
+        if(stats.lastOffAirMs > stats.maxOffAirMs)
+        {
+            stats.maxOffAirMs = stats.lastOffAirMs;
+        }
+        System_printf("Reconnected after %u ms off air\n", stats.lastOffAirMs);
+    }
+    else
+    {
+        sysmon_bootMark(BOOT_CONNECTED);
+        System_printf("Bluetooth is ready!\n");
+    }
+    System_flush();
+    wasConnected = true;
+
+    bt_setReady(link, true); //control task starts sending
+}
+
+//builds the connect command for the target copter
+static void set_target(const scan_device_t *device)
+{
+    target = *device;
+    strcpy(connectCmdText, "C,");
+    connectCmdText[2] = '0' + target.addrType;
+    connectCmdText[3] = ',';
+    strcpy(&connectCmdText[4], target.mac);
+    strcat(connectCmdText, "\r");
+    haveTarget = true;
+}
+
+static void link_down(void)
+{
+    lostTick = Clock_getTicks();
+    stats.linkLosses++;
+    metrics_inc(MET_LINK_LOSSES);
+    metrics_set(MET_LINK_UP, 0);
+    bt_setReady(link, false); //control task stops sending unless another link of the route is ready
+    System_printf("Connection to copter lost\n");
+    System_flush();
+}
+
+//executor job: connection state machine, never returns while the system is running
+static int conn_job(exec_job_t *job)
+{
+    static uint32_t backoff;
+    static uint8_t failures;
+    static uint8_t lostPolls;
+
+    JOB_BEGIN(job);
+
+    if(!bt_openUart(link))
+    {
+        System_abort("Error opening the UART");
+    }
+    btcmd_setEventHandler(conn_event);
+    sysmon_bootMark(BOOT_UART_OPEN);
+
+    while(1)
+    {
+        //power up sequence of the bluetooth module, all pins were configured by setup_UART
+        bt_setDataMode(link, false);
+        btcmd_flush();
+        inCommandMode = false;
+        configured = false;
+        //set M7 = WAKE_UP high -> wake up from sleep mode
+        GPIOPinWrite(GPIO_PORTM_BASE, GPIO_PIN_7, GPIO_PIN_7);
+        JOB_SLEEP(job, BT_WAKE_SETTLE_MS);
+        //P4 = RST on module low
+        GPIOPinWrite(GPIO_PORTP_BASE, GPIO_PIN_4, 0);
+        JOB_SLEEP(job, BT_RESET_PULSE_MS);
+        //P4 = RST on module high -> module reset (pulse of at least 63ns)
+        GPIOPinWrite(GPIO_PORTP_BASE, GPIO_PIN_4, GPIO_PIN_4);
+        JOB_SLEEP(job, BT_RESET_SETTLE_MS);
+        //D2 = SW_BTN high -> power ON
+        GPIOPinWrite(GPIO_PORTD_BASE, GPIO_PIN_2, GPIO_PIN_2);
+        JOB_SLEEP(job, BT_POWER_ON_MS);
+
+        //check status pins of the bluetooth module
+        stepTick = Clock_getTicks();
+        JOB_WAIT_UNTIL(job, bt_module_started(link) || step_timed_out(BT_STARTUP_TIMEOUT_MS));
+        if(!bt_module_started(link))
+        {
+            System_printf("Bluetooth module did not start, resetting\n");
+            System_flush();
+            stats.moduleResets++;
+            metrics_inc(MET_MODULE_RESETS);
+            continue;
+        }
+        sysmon_bootMark(BOOT_BLE_POWERED);
+        System_printf("Bluetooth module initialized\n");
+        System_flush();
+
+        failures = 0;
+        backoff = 0;
+        while(failures < CONN_ATTEMPTS_BEFORE_RESET)
+        {
+            JOB_SLEEP(job, backoff);
+            attemptTick = Clock_getTicks();
+            stats.attempts++;
+            metrics_inc(MET_CONN_ATTEMPTS);
+            bt_setDataMode(link, false);
+
+            //enter command mode of bluetooth module, not necessary after a failed attempt
+            if(!inCommandMode)
+            {
+                btcmd_flush();
+                btcmd_submit(&cmdEnter);
+                JOB_WAIT_UNTIL(job, btcmd_done(&cmdEnter));
+                if(cmdEnter.status != BTCMD_OK)
+                {
+                    System_printf("Failed to enter command mode\n");
+                    System_flush();
+                    probe_next_baud();
+                    failures++;
+                    backoff = next_backoff(backoff);
+                    continue;
+                }
+                inCommandMode = true;
+                JOB_WAIT_UNTIL(job, config_ready()); //config_set must not wait inside the executor
+                store_baud();
+            }
+
+            //configure the module once after power up
+            if(!configured)
+            {
+                stepTick = Clock_getTicks();
+                submit_setup();
+                JOB_WAIT_UNTIL(job, setup_done());
+                report_setup();
+                configured = true;
+            }
+
+            //negotiate a higher baud rate once, the module keeps it across resets
+            if(!baudNegotiated)
+            {
+                JOB_SPAWN(job, &baudJob, baud_job);
+                baudNegotiated = true;
+                if(!inCommandMode)
+                {
+                    continue; //fallback after a failed upgrade, start over with command mode
+                }
+            }
+
+            //no copter known yet or the pilot asked for another one: scan and let the pilot select
+            if(!haveTarget || scanRequested)
+            {
+                JOB_SPAWN(job, &scanJob, scan_job);
+                if(!scan_getSelected(&target))
+                {
+                    failures++;
+                    backoff = next_backoff(backoff);
+                    continue;
+                }
+                JOB_WAIT_UNTIL(job, config_ready()); //config_set must not wait inside the executor
+                scan_storeCached(&target);
+                set_target(&target);
+                scanRequested = false;
+            }
+
+            //connect to copter with its MAC-address
+            btcmd_submit(&cmdConnect);
+            JOB_WAIT_UNTIL(job, btcmd_done(&cmdConnect));
+            if(cmdConnect.status != BTCMD_OK)
+            {
+                System_printf("Failed to connect to copter!\n");
+                System_flush();
+                failures++;
+                backoff = next_backoff(backoff);
+                continue;
+            }
+
+            //Check status pins of bluetooth module: wait for correct status
+            stepTick = Clock_getTicks();
+            JOB_WAIT_UNTIL(job, bt_link_connected(link) || step_timed_out(CONN_STATUS_TIMEOUT_MS));
+            if(!bt_link_connected(link))
+            {
+                failures++;
+                backoff = next_backoff(backoff);
+                continue;
+            }
+
+            //request the connection parameters before the first control frame
+            negotiatedValid = false;
+            JOB_SPAWN(job, &paramJob, param_job);
+
+            //leave command mode
+            btcmd_submit(&cmdLeave);
+            JOB_WAIT_UNTIL(job, btcmd_done(&cmdLeave));
+            if(cmdLeave.status != BTCMD_OK)
+            {
+                failures++;
+                backoff = next_backoff(backoff);
+                continue;
+            }
+            inCommandMode = false;
+            btcmd_flush(); //from here on the module forwards copter data
+            bt_setDataMode(link, true);
+            link_up();
+
+            //watch the status pins until the link is lost
+            lostPolls = 0;
+            while(lostPolls < CONN_LOST_POLLS)
+            {
+                JOB_SLEEP(job, CONN_POLL_MS);
+                lostPolls = bt_link_connected(link) ? 0 : lostPolls + 1;
+                if(lostPolls == 0 && requestedProfile != activeProfile)
+                {
+                    JOB_SPAWN(job, &paramJob, param_job);
+                }
+            }
+            link_down();
+
+            //reconnect immediately
+            failures = 0;
+            backoff = 0;
+        }
+
+        System_printf("Connection failed %u times, resetting bluetooth module\n", failures);
+        System_flush();
+        stats.moduleResets++;
+        metrics_inc(MET_MODULE_RESETS);
+        if(++resetsWithoutLink >= CONN_RESETS_BEFORE_SCAN)
+        {
+            System_printf("Copter %s not reachable, scanning again\n", target.mac);
+            System_flush();
+            scanRequested = true;
+            resetsWithoutLink = 0;
+        }
+    }
+
+    JOB_END(job);
+}
+
+//starts the connection manager, setup_UART must have configured the pins
+void conn_start(void)
+{
+    scan_device_t cached;
+    uint8_t i;
+
+    link = bt_getLink(BT_LINK_MODULE);
+
+    //the module keeps its baud rate, start probing at the stored one
+    for(i = 0; i < BAUD_COUNT; i++)
+    {
+        if(bauds[i].rate == bt_getBaudRate(link))
+        {
+            probeIndex = i;
+        }
+    }
+
+    //holding select at power up forces a new scan, e.g. after changing the airframe
+    scanRequested = (GPIO_read(JS_ARM) == 0);
+    if(scan_loadCached(&cached))
+    {
+        set_target(&cached);
+        System_printf("Cached copter %s %s\n", cached.mac, cached.name);
+        System_flush();
+    }
+    exec_add(&connJob, conn_job, "connection");
+}
+
+//copy of the connection statistics
+void conn_getStats(conn_stats_t *out)
+{
+    UInt key = Hwi_disable();
+    *out = stats;
+    Hwi_restore(key);
+}
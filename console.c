@@ -0,0 +1,373 @@
+/*
+ * console.c
+ *
+ *  Created on: 19.10.2026
+ *
+ *  Command console on Board_UART0 (virtual COM port of the debugger) for tuning in the field.
+ *  Parameter edits are staged in a shadow profile, "apply" publishes it with the pointer swap
+ *  of config.c, "save" also stores it in the EEPROM. The control loop never takes a lock and
+ *  never sees a half-written profile.
+ *  Other modules add their commands with console_addCommand before BIOS_start.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <driverlib/gpio.h>
+#include <driverlib/pin_map.h>
+#include <driverlib/sysctl.h>
+#include <inc/hw_memmap.h>
+
+#include <xdc/std.h>
+#include <xdc/runtime/System.h>
+
+#include <ti/drivers/UART.h>
+#include <ti/sysbios/BIOS.h>
+#include <ti/sysbios/knl/Task.h>
+
+#include <Board.h>
+
+#include <config.h>
+#include <console.h>
+#include <sysmon.h>
+#include <tasks.h>
+
+//tunable parameters of the profile with their limits
+typedef struct console_param_t {
+    const char *name;
+    uint16_t offset;
+    uint8_t size;
+    uint32_t min;
+    uint32_t max;
+} console_param_t;
+
+static const console_param_t params[] = {
+    { "throttle_step", offsetof(config_t, throttleStep), sizeof(uint16_t), 1, 500 },
+    { "loop_ms", offsetof(config_t, loopPeriodMs), sizeof(uint16_t), 5, 100 },
+    { "rate_roll", offsetof(config_t, rates[CFG_AXIS_ROLL].rate), sizeof(uint8_t), 10, 200 },
+    { "rate_pitch", offsetof(config_t, rates[CFG_AXIS_PITCH].rate), sizeof(uint8_t), 10, 200 },
+    { "expo_roll", offsetof(config_t, rates[CFG_AXIS_ROLL].expo), sizeof(uint8_t), 0, 100 },
+    { "expo_pitch", offsetof(config_t, rates[CFG_AXIS_PITCH].expo), sizeof(uint8_t), 0, 100 },
+    { "filter", offsetof(config_t, filterShift), sizeof(uint8_t), 0, 4 },
+    { "tx_keepalive", offsetof(config_t, txKeepalive), sizeof(uint8_t), 0, 20 },
+};
+#define PARAM_COUNT (sizeof(params) / sizeof(params[0]))
+
+static UART_Handle console;
+static char outBuffer[128];         //console_printf, only used by the console task
+static config_t shadow;             //staged edits
+static bool shadowDirty = false;
+
+static const console_cmd_t *commands[CONSOLE_MAX_COMMANDS];
+static uint8_t commandCount = 0;
+
+static Task_Struct consoleTaskStruct;
+static Char consoleTaskStack[TASK_STACK_CONSOLE];
+
+static bool open_uart(void);
+
+//writes raw data to the console
+void console_write(const void *data, uint32_t size)
+{
+    if(console != NULL)
+    {
+        UART_write(console, data, size);
+    }
+}
+
+//formatted output to the console, must only be called from the console task
+void console_printf(const char *format, ...)
+{
+    va_list args;
+    int length;
+
+    va_start(args, format);
+    length = System_vsnprintf(outBuffer, sizeof(outBuffer), format, args);
+    va_end(args);
+    if(length > (int)sizeof(outBuffer) - 1)
+    {
+        length = sizeof(outBuffer) - 1;
+    }
+    if(length > 0 && console != NULL)
+    {
+        UART_write(console, outBuffer, length);
+    }
+}
+
+//adds a command of another module, must be called before BIOS_start
+void console_addCommand(const console_cmd_t *cmd)
+{
+    if(commandCount >= CONSOLE_MAX_COMMANDS)
+    {
+        System_printf("console: too many commands, %s not added\n", cmd->name);
+        System_flush();
+        return;
+    }
+    commands[commandCount++] = cmd;
+}
+
+static uint32_t param_get(const config_t *profile, const console_param_t *param)
+{
+    const uint8_t *field = (const uint8_t *)profile + param->offset;
+
+    if(param->size == sizeof(uint16_t))
+    {
+        return *(const uint16_t *)field;
+    }
+    return *field;
+}
+
+static void param_set(config_t *profile, const console_param_t *param, uint32_t value)
+{
+    uint8_t *field = (uint8_t *)profile + param->offset;
+
+    if(param->size == sizeof(uint16_t))
+    {
+        *(uint16_t *)field = value;
+    }
+    else
+    {
+        *field = value;
+    }
+}
+
+//builds the profile to publish: the current one with the tunable parameters of the shadow
+//values other modules changed meanwhile (copter, baud rate, calibration) are kept
+static void merge_shadow(config_t *profile)
+{
+    uint8_t i;
+
+    *profile = *config;
+    for(i = 0; i < PARAM_COUNT; i++)
+    {
+        param_set(profile, &params[i], param_get(&shadow, &params[i]));
+    }
+}
+
+static void cmd_help(uint8_t argc, char *argv[])
+{
+    uint8_t i;
+
+    console_printf("show | set <param> <value> | apply | save | revert\r\n");
+    for(i = 0; i < commandCount; i++)
+    {
+        console_printf("%s - %s\r\n", commands[i]->name, commands[i]->help);
+    }
+}
+
+static void cmd_show(uint8_t argc, char *argv[])
+{
+    const config_t *active = config;
+    uint8_t i;
+
+    console_printf("%-14s %8s %8s\r\n", "param", "active", "staged");
+    for(i = 0; i < PARAM_COUNT; i++)
+    {
+        console_printf("%-14s %8u %8u  (%u-%u)\r\n", params[i].name, param_get(active, &params[i]),
+                       param_get(&shadow, &params[i]), params[i].min, params[i].max);
+    }
+}
+
+static void cmd_set(uint8_t argc, char *argv[])
+{
+    uint32_t value;
+    char *end;
+    uint8_t i;
+
+    if(argc != 3)
+    {
+        console_printf("usage: set <param> <value>\r\n");
+        return;
+    }
+    for(i = 0; i < PARAM_COUNT && strcmp(params[i].name, argv[1]) != 0; i++)
+    {}
+    if(i == PARAM_COUNT)
+    {
+        console_printf("unknown parameter %s\r\n", argv[1]);
+        return;
+    }
+    value = strtoul(argv[2], &end, 0);
+    if(*end != '\0' || value < params[i].min || value > params[i].max)
+    {
+        console_printf("%s must be %u-%u\r\n", params[i].name, params[i].min, params[i].max);
+        return;
+    }
+    param_set(&shadow, &params[i], value);
+    shadowDirty = true;
+}
+
+static void cmd_apply(uint8_t argc, char *argv[])
+{
+    static config_t profile;
+
+    merge_shadow(&profile);
+    if(!config_publish(&profile))
+    {
+        console_printf("profile changed just now, apply again\r\n");
+        return;
+    }
+    shadowDirty = false;
+    console_printf("applied\r\n");
+}
+
+static void cmd_save(uint8_t argc, char *argv[])
+{
+    static config_t profile;
+
+    merge_shadow(&profile);
+    if(!config_commit(&profile))
+    {
+        console_printf("profile changed just now or EEPROM write failed, not applied\r\n");
+        return;
+    }
+    shadowDirty = false;
+    console_printf("saved\r\n");
+}
+
+static void cmd_revert(uint8_t argc, char *argv[])
+{
+    shadow = *config;
+    shadowDirty = false;
+}
+
+static const console_cmd_t builtins[] = {
+    { "help", "list commands", cmd_help },
+    { "show", "active and staged parameters", cmd_show },
+    { "set", "stage a parameter", cmd_set },
+    { "apply", "publish the staged parameters", cmd_apply },
+    { "save", "publish and store the staged parameters", cmd_save },
+    { "revert", "drop the staged parameters", cmd_revert },
+};
+#define BUILTIN_COUNT (sizeof(builtins) / sizeof(builtins[0]))
+
+//splits line at spaces and runs the command
+static void execute(char *line)
+{
+    char *argv[CONSOLE_MAX_ARGS];
+    uint8_t argc = 0;
+    char *token;
+    uint8_t i;
+
+    for(token = strtok(line, " "); token != NULL && argc < CONSOLE_MAX_ARGS; token = strtok(NULL, " "))
+    {
+        argv[argc++] = token;
+    }
+    if(argc == 0)
+    {
+        return;
+    }
+    for(i = 0; i < BUILTIN_COUNT; i++)
+    {
+        if(strcmp(builtins[i].name, argv[0]) == 0)
+        {
+            builtins[i].fnx(argc, argv);
+            return;
+        }
+    }
+    for(i = 0; i < commandCount; i++)
+    {
+        if(strcmp(commands[i]->name, argv[0]) == 0)
+        {
+            commands[i]->fnx(argc, argv);
+            return;
+        }
+    }
+    console_printf("unknown command %s, try help\r\n", argv[0]);
+}
+
+/*
+ *  Console task: reads one line at a time (echoed by the driver) and executes it.
+ */
+void console_fnx(UArg arg0, UArg arg1)
+{
+    static char line[CONSOLE_LINE_SIZE];
+    int length;
+
+    shadow = *config;
+    console_printf("\r\ncopter controller console, try help\r\n");
+
+    while(1)
+    {
+        if(console == NULL && !open_uart())
+        {
+            Task_sleep(1000); //reopening after console_suspend failed, try again
+            continue;
+        }
+        console_printf(shadowDirty ? "*> " : "> ");
+        length = UART_read(console, line, sizeof(line) - 1);
+        if(length == UART_ERROR)
+        {
+            continue;
+        }
+        while(length > 0 && (line[length - 1] == '\r' || line[length - 1] == '\n'))
+        {
+            length--;
+        }
+        line[length] = '\0';
+        execute(line);
+    }
+}
+
+static bool open_uart(void)
+{
+    UART_Params uartParams;
+
+    UART_Params_init(&uartParams);
+    uartParams.writeDataMode = UART_DATA_BINARY;
+    uartParams.readDataMode = UART_DATA_TEXT;
+    uartParams.readReturnMode = UART_RETURN_NEWLINE;
+    uartParams.readEcho = UART_ECHO_ON;
+    uartParams.baudRate = CONSOLE_BAUD;
+    console = UART_open(Board_UART0, &uartParams);
+    if(console == NULL)
+    {
+        System_printf("Error opening the console UART\n");
+        System_flush();
+        return false;
+    }
+    return true;
+}
+
+//closes the driver so a command can use UART0 directly (relay.c), only from the console task
+void console_suspend(void)
+{
+    UART_close(console);
+    console = NULL;
+}
+
+//opens the driver again after console_suspend, returns false if it failed
+bool console_resume(void)
+{
+    return open_uart();
+}
+
+/*
+ *  Opens UART0 and creates the console task. UART_init must have been called (setup_UART).
+ */
+void setUpConsole_Task(void)
+{
+    //A0 and A1 for uart0, connected to the virtual COM port of the debugger
+    SysCtlPeripheralEnable(SYSCTL_PERIPH_GPIOA);
+    SysCtlPeripheralEnable(SYSCTL_PERIPH_UART0);
+    GPIOPinConfigure(GPIO_PA0_U0RX);
+    GPIOPinConfigure(GPIO_PA1_U0TX);
+    GPIOPinTypeUART(GPIO_PORTA_BASE, GPIO_PIN_0 | GPIO_PIN_1);
+
+    if(!open_uart())
+    {
+        return;
+    }
+
+    Task_Params taskParams;
+    Task_Params_init(&taskParams);
+    taskParams.stack = &consoleTaskStack;
+    taskParams.stackSize = sizeof(consoleTaskStack);
+    taskParams.priority = TASK_PRIO_CONSOLE;
+    Task_construct(&consoleTaskStruct, (Task_FuncPtr) console_fnx, &taskParams, NULL);
+
+    sysmon_registerTask(Task_handle(&consoleTaskStruct), "console");
+}
@@ -0,0 +1,111 @@
+/*
+ * control.c
+ *
+ *  Created on: 19.10.2026
+ *
+ *  Control/mixing task: combines the latest joystick sample with the button
+ *  state and hands the resulting frame to the link TX task and the wired RC output (rcout.c).
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include <xdc/std.h>
+#include <xdc/runtime/Error.h>
+#include <xdc/runtime/System.h>
+
+#include <ti/sysbios/BIOS.h>
+#include <ti/sysbios/knl/Event.h>
+#include <ti/sysbios/knl/Task.h>
+
+#include <bluetooth.h>
+#include <config.h>
+#include <control.h>
+#include <deadline.h>
+#include <joystick.h>
+#include <rcout.h>
+#include <sysmon.h>
+#include <tasks.h>
+
+//events for the control task, posted by the sampling task and the links
+static Event_Struct controlEventStruct;
+static Event_Handle controlEvent;
+
+static Task_Struct controlTaskStruct;
+static Char controlTaskStack[TASK_STACK_CONTROL];
+
+/*
+ *  Post one or more CONTROL_EVT_* events to the control task.
+ *  Can be called from Task, Swi and Hwi context.
+ */
+void control_post(UInt events)
+{
+    Event_post(controlEvent, events);
+}
+
+/*
+ *  This is the control RTOS task. It is woken up by the sampling task for every
+ *  new joystick sample and forwards the controls to the copters of the route as long as one of their links is up.
+ *  With txKeepalive (config) unchanged controls are only repeated every n-th sample.
+ */
+void control_fnx(UArg arg0, UArg arg1)
+{
+    js_sample_t sample;
+    js_sample_t lastSent = { 0 };  //throttle 0 never matches, the first sample is always sent
+    uint8_t skipped = 0;
+    bool linkUp = false;
+
+    while (1)
+    {
+        UInt events = Event_pend(controlEvent, Event_Id_NONE,
+                                 CONTROL_EVT_SAMPLE | CONTROL_EVT_LINK_UP | CONTROL_EVT_LINK_DOWN,
+                                 BIOS_WAIT_FOREVER);
+
+        if(events & (CONTROL_EVT_LINK_UP | CONTROL_EVT_LINK_DOWN))
+        {
+            linkUp = bt_routeReady(); //one link going up or down says nothing about the others
+        }
+        if(!(events & CONTROL_EVT_SAMPLE))
+        {
+            continue;
+        }
+        //only samples are periodic, a link event (e.g. during the calibration) must not start the deadline
+        deadline_checkIn(DL_CONTROL);
+
+        joystick_getSample(&sample);
+        rcout_setControls(sample.roll, sample.pitch, sample.throttle, sample.armed); //wired output, independent of the link
+        if(!linkUp)
+        {
+            continue;
+        }
+
+        //transmit policy: with a keepalive only changed controls are sent, unchanged ones every n-th sample
+        if(config->txKeepalive > 0 && sample.roll == lastSent.roll && sample.pitch == lastSent.pitch
+           && sample.throttle == lastSent.throttle && sample.armed == lastSent.armed
+           && ++skipped < config->txKeepalive)
+        {
+            continue;
+        }
+        skipped = 0;
+        lastSent = sample;
+        send_controls(sample.roll, sample.pitch, sample.throttle, sample.armed); //hand frame to link TX task
+    }
+}
+
+/*
+ *  Set up the event object and the control task
+ */
+void setUpControl_Task(void)
+{
+    Event_construct(&controlEventStruct, NULL);
+    controlEvent = Event_handle(&controlEventStruct);
+
+    Task_Params taskParams;
+    Task_Params_init(&taskParams);
+    taskParams.stack = &controlTaskStack;
+    taskParams.stackSize = sizeof(controlTaskStack);
+    taskParams.priority = TASK_PRIO_CONTROL;
+    Task_construct(&controlTaskStruct, (Task_FuncPtr) control_fnx, &taskParams, NULL);
+
+    sysmon_registerTask(Task_handle(&controlTaskStruct), "control");
+}
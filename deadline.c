@@ -0,0 +1,212 @@
+/*
+ * deadline.c
+ *
+ *  Created on: 19.10.2026
+ *
+ *  Deadline monitor for the critical tasks, tied to the hardware watchdog.
+ *  Every monitored task checks in (deadline_checkIn) each time it starts its work. A Clock
+ *  function checks every DEADLINE_CHECK_MS that no task is overdue and only then feeds the
+ *  watchdog. The first miss is counted and timestamped, from then on the monitor sends a
+ *  failsafe frame (throttle minimum, disarmed) on every check and stops feeding the watchdog,
+ *  the controller resets at the second watchdog timeout. A hung Swi/Hwi level stops the monitor
+ *  itself, the watchdog interrupt (first timeout) then sends the failsafe frame.
+ *  Worst case from the hang to the reset: budget + DEADLINE_CHECK_MS + 2 * DEADLINE_WDT_MS.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include <driverlib/sysctl.h>
+
+#include <xdc/std.h>
+#include <xdc/runtime/System.h>
+#include <xdc/runtime/Types.h>
+
+#include <ti/drivers/Watchdog.h>
+#include <ti/sysbios/BIOS.h>
+#include <ti/sysbios/hal/Hwi.h>
+#include <ti/sysbios/knl/Clock.h>
+
+#include <Board.h>
+
+#include <bluetooth.h>
+#include <config.h>
+#include <console.h>
+#include <deadline.h>
+#include <metrics.h>
+#include <tasks.h>
+#include <trace.h>
+
+typedef struct deadline_t {
+    const char *name;
+    bool periodic;          //budget follows the sampling period, else DEADLINE_TX_MS
+    volatile bool active;   //monitored from the first check-in on (periodic) or until deadline_idle
+    volatile uint32_t lastCheckIn;
+    uint32_t worstMs;       //longest period (periodic) or busy time seen
+    uint32_t misses;
+    uint32_t lastMiss;      //Clock tick of the last miss
+} deadline_t;
+
+static deadline_t deadlines[DL_COUNT] = {
+    { "sampling", true },
+    { "control", true },
+    { "link tx", false },
+    { "aux tx", false },
+};
+
+static Clock_Struct monitorClock;
+static Watchdog_Handle watchdog = NULL;
+static volatile bool failed = false;
+static bool resetByWatchdog = false;
+static volatile uint16_t periodMs = CONTROL_PERIOD_MS; //period the sampling clock runs at (deadline_setPeriod)
+
+static uint32_t budget_ms(const deadline_t *dl)
+{
+    return dl->periodic ? periodMs * DEADLINE_PERIOD_FACTOR : DEADLINE_TX_MS;
+}
+
+//period of the sampling clock, called when the clock switches to it
+//a published profile changes the clock only at the next sample, the budget follows the clock, not config
+void deadline_setPeriod(uint16_t ms)
+{
+    periodMs = ms;
+}
+
+//marks the start of a work cycle, called by the monitored task itself
+void deadline_checkIn(deadline_id_t id)
+{
+    deadline_t *dl = &deadlines[id];
+    uint32_t now = Clock_getTicks();
+
+    if(dl->periodic && dl->active && now - dl->lastCheckIn > dl->worstMs)
+    {
+        dl->worstMs = now - dl->lastCheckIn;
+    }
+    dl->lastCheckIn = now;
+    dl->active = true;
+}
+
+//an event driven task waits for work, it can not miss a deadline meanwhile
+void deadline_idle(deadline_id_t id)
+{
+    deadline_t *dl = &deadlines[id];
+    uint32_t busy = Clock_getTicks() - dl->lastCheckIn;
+
+    if(dl->active && busy > dl->worstMs)
+    {
+        dl->worstMs = busy;
+    }
+    dl->active = false;
+}
+
+/*
+ *  Clock function: checks all deadlines and feeds the watchdog while every task is on time
+ */
+static void monitor_tick(UArg arg0)
+{
+    uint32_t now = Clock_getTicks();
+    deadline_t *dl;
+    uint8_t i;
+
+    for(i = 0; i < DL_COUNT; i++)
+    {
+        dl = &deadlines[i];
+        if(!failed && dl->active && now - dl->lastCheckIn > budget_ms(dl))
+        {
+            dl->misses++;
+            dl->lastMiss = now;
+            metrics_inc(MET_DEADLINE_MISSES);
+            trace_event(TRACE_MARK, i);
+            failed = true;
+        }
+    }
+
+    if(failed)
+    {
+        bt_sendFailsafe();  //repeated until the watchdog resets the controller
+        return;
+    }
+    if(watchdog != NULL)
+    {
+        Watchdog_clear(watchdog);
+    }
+}
+
+/*
+ *  Watchdog interrupt (first timeout): the monitor did not feed it, last chance for the failsafe frame.
+ *  The interrupt is not cleared, the watchdog resets the controller at the second timeout.
+ *  It is entered again and again meanwhile, a link that was busy gets the frame on a later entry.
+ */
+static void watchdog_expired(UArg arg0)
+{
+    static bool sent = false;
+
+    if(!sent)
+    {
+        sent = bt_sendFailsafe();
+    }
+}
+
+static void cmd_deadline(uint8_t argc, char *argv[])
+{
+    uint8_t i;
+
+    console_printf("%-10s %6s %6s %6s %10s\r\n", "task", "budget", "worst", "misses", "last miss");
+    for(i = 0; i < DL_COUNT; i++)
+    {
+        console_printf("%-10s %6u %6u %6u %10u\r\n", deadlines[i].name, budget_ms(&deadlines[i]),
+                       deadlines[i].worstMs, deadlines[i].misses, deadlines[i].lastMiss);
+    }
+    console_printf("watchdog %s, last reset %s\r\n", (watchdog != NULL) ? "running" : "off",
+                   resetByWatchdog ? "by watchdog" : "normal");
+}
+
+static const console_cmd_t deadlineCmd = { "deadline", "deadline budgets and misses", cmd_deadline };
+
+/*
+ *  Opens the watchdog and starts the monitor, Board_initWatchdog and config_init must have been called.
+ *  The watchdog runs from here on, BIOS_start has to follow within DEADLINE_WDT_MS.
+ */
+void deadline_start(void)
+{
+    Watchdog_Params wdParams;
+    Clock_Params clockParams;
+    Types_FreqHz freq;
+
+    if(SysCtlResetCauseGet() & SYSCTL_CAUSE_WDOG0)
+    {
+        resetByWatchdog = true;
+        SysCtlResetCauseClear(SYSCTL_CAUSE_WDOG0);
+        System_printf("Last reset by the watchdog (missed deadline)\n");
+        System_flush();
+    }
+
+    Watchdog_Params_init(&wdParams);
+    wdParams.callbackFxn = watchdog_expired;
+    wdParams.resetMode = Watchdog_RESET_ON;
+    wdParams.debugStallMode = Watchdog_DEBUG_STALL_ON;  //no reset while halted in the debugger
+    watchdog = Watchdog_open(Board_WATCHDOG0, &wdParams);
+    if(watchdog == NULL)
+    {
+        System_printf("Error opening the watchdog, deadlines are only counted\n");
+        System_flush();
+    }
+    else
+    {
+        BIOS_getCpuFreq(&freq);
+        Watchdog_setReload(watchdog, freq.lo / 1000 * DEADLINE_WDT_MS);
+    }
+
+    Clock_Params_init(&clockParams);
+    clockParams.period = DEADLINE_CHECK_MS;
+    clockParams.startFlag = TRUE;
+    Clock_construct(&monitorClock, (Clock_FuncPtr) monitor_tick, DEADLINE_CHECK_MS, &clockParams);
+
+    //the sampling clock starts with the loaded profile, apply_config only follows after the calibration
+    if(config->loopPeriodMs > 0)
+    {
+        periodMs = config->loopPeriodMs;
+    }
+    console_addCommand(&deadlineCmd);
+}
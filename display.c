@@ -0,0 +1,719 @@
+/*
+ * display.c
+ *
+ *  Created on: 19.10.2026
+ *
+ *  Telemetry on the 128x128 LCD of the EDUMKII: battery, link quality, arm state and sticks.
+ *  There is no frame buffer. Every period the display task compares the values with the ones on
+ *  the glass and marks the changed regions as dirty rectangles (a moving stick dot only dirties its
+ *  old and new position). A dirty rectangle is rendered in bands of DISPLAY_TILE_PIXELS into one
+ *  of two tile buffers, the uDMA sends a tile to SSI2 while the next one is rendered.
+ *  The task has the lowest priority and sleeps while the uDMA sends, a full redraw (32 tiles) only
+ *  uses CPU time the control loop does not need.
+ *  SSI2 is shared with the SD card of the blackbox, the bus lock is held for one tile at a time.
+ *  Battery and link quality: MSP_ANALOG is requested on the route every DISPLAY_ANALOG_MS, the link
+ *  quality is the share of answered requests of the last DISPLAY_LQ_WINDOW.
+ *  Console: display shows the counters, display redraw repaints the whole screen.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include <driverlib/gpio.h>
+#include <driverlib/ssi.h>
+#include <driverlib/sysctl.h>
+#include <driverlib/udma.h>
+#include <inc/hw_ints.h>
+#include <inc/hw_memmap.h>
+#include <inc/hw_ssi.h>
+
+#include <xdc/std.h>
+#include <xdc/runtime/System.h>
+#include <xdc/runtime/Timestamp.h>
+#include <xdc/runtime/Types.h>
+
+#include <ti/sysbios/BIOS.h>
+#include <ti/sysbios/hal/Hwi.h>
+#include <ti/sysbios/knl/Clock.h>
+#include <ti/sysbios/knl/Semaphore.h>
+#include <ti/sysbios/knl/Task.h>
+
+#include <blackbox.h>
+#include <bluetooth.h>
+#include <console.h>
+#include <display.h>
+#include <joystick.h>
+#include <metrics.h>
+#include <sysmon.h>
+#include <tasks.h>
+
+//ST7735S commands
+#define ST_SLPOUT       0x11
+#define ST_DISPON       0x29
+#define ST_CASET        0x2A
+#define ST_RASET        0x2B
+#define ST_RAMWR        0x2C
+#define ST_MADCTL       0x36
+#define ST_COLMOD       0x3A
+#define ST_MADCTL_UP    0xC8    //MY, MX, BGR: connector at the bottom
+#define ST_COLMOD_565   0x05    //16 bit per pixel
+#define ST_RESET_MS     10
+#define ST_WAKE_MS      120     //after reset and sleep out
+
+#define MSP_ANALOG      110     //response: vbat (0.1 V), mAh drawn, RSSI, current
+#define ANALOG_STALE_MS (4 * DISPLAY_ANALOG_MS)
+
+//RGB565, byte swapped: the uDMA sends the tile byte by byte and the controller expects the high byte first
+#define COLOR(r, g, b)  ((((r) & 0xF8) | ((g) >> 5)) | (((((g) & 0x1C) << 3) | ((b) >> 3)) << 8))
+#define BLACK           COLOR(0, 0, 0)
+#define WHITE           COLOR(255, 255, 255)
+#define GREY            COLOR(128, 128, 128)
+#define DARK_GREY       COLOR(48, 48, 48)
+#define RED             COLOR(224, 0, 0)
+#define GREEN           COLOR(0, 200, 0)
+#define DARK_GREEN      COLOR(0, 112, 0)
+#define YELLOW          COLOR(255, 224, 0)
+#define CYAN            COLOR(0, 192, 224)
+
+//layout, 5x7 font in cells of 6x8 pixels
+#define TEXT_W          6
+#define TEXT_H          8
+#define LINE_SIZE       (DISPLAY_WIDTH / TEXT_W + 1)
+#define ARM_Y           26
+#define ARM_H           20
+#define BOX_X           8       //roll/pitch box with the stick dot
+#define BOX_Y           52
+#define BOX_SIZE        64
+#define DOT_SIZE        6
+#define BAR_X           88      //throttle bar
+#define BAR_W           16
+
+typedef struct disp_rect_t {
+    int16_t x;
+    int16_t y;
+    int16_t w;
+    int16_t h;
+} disp_rect_t;
+
+typedef enum disp_line_id_t {
+    LINE_BATTERY = 0,
+    LINE_LINK,
+    LINE_STICKS,
+    LINE_COUNT
+} disp_line_id_t;
+
+typedef struct disp_line_t {
+    char text[LINE_SIZE];
+    uint16_t color;
+} disp_line_t;
+
+static const int16_t lineY[LINE_COUNT] = { 2, 14, 120 };
+
+//what is on the glass, or will be once the dirty rectangles are sent
+typedef struct disp_view_t {
+    disp_line_t lines[LINE_COUNT];
+    bool armed;
+    int16_t dotX;
+    int16_t dotY;
+    int16_t throttleY;  //top of the throttle bar
+} disp_view_t;
+
+//5x7 font from ' ' to 'Z', one byte per column, bit 0 is the top row
+static const uint8_t font[][5] = {
+    {0x00, 0x00, 0x00, 0x00, 0x00}, {0x00, 0x00, 0x5F, 0x00, 0x00}, {0x00, 0x07, 0x00, 0x07, 0x00},
+    {0x14, 0x7F, 0x14, 0x7F, 0x14}, {0x24, 0x2A, 0x7F, 0x2A, 0x12}, {0x23, 0x13, 0x08, 0x64, 0x62},
+    {0x36, 0x49, 0x55, 0x22, 0x50}, {0x00, 0x05, 0x03, 0x00, 0x00}, {0x00, 0x1C, 0x22, 0x41, 0x00},
+    {0x00, 0x41, 0x22, 0x1C, 0x00}, {0x14, 0x08, 0x3E, 0x08, 0x14}, {0x08, 0x08, 0x3E, 0x08, 0x08},
+    {0x00, 0x50, 0x30, 0x00, 0x00}, {0x08, 0x08, 0x08, 0x08, 0x08}, {0x00, 0x60, 0x60, 0x00, 0x00},
+    {0x20, 0x10, 0x08, 0x04, 0x02}, {0x3E, 0x51, 0x49, 0x45, 0x3E}, {0x00, 0x42, 0x7F, 0x40, 0x00},
+    {0x42, 0x61, 0x51, 0x49, 0x46}, {0x21, 0x41, 0x45, 0x4B, 0x31}, {0x18, 0x14, 0x12, 0x7F, 0x10},
+    {0x27, 0x45, 0x45, 0x45, 0x39}, {0x3C, 0x4A, 0x49, 0x49, 0x30}, {0x01, 0x71, 0x09, 0x05, 0x03},
+    {0x36, 0x49, 0x49, 0x49, 0x36}, {0x06, 0x49, 0x49, 0x29, 0x1E}, {0x00, 0x36, 0x36, 0x00, 0x00},
+    {0x00, 0x56, 0x36, 0x00, 0x00}, {0x08, 0x14, 0x22, 0x41, 0x00}, {0x14, 0x14, 0x14, 0x14, 0x14},
+    {0x00, 0x41, 0x22, 0x14, 0x08}, {0x02, 0x01, 0x51, 0x09, 0x06}, {0x32, 0x49, 0x79, 0x41, 0x3E},
+    {0x7E, 0x11, 0x11, 0x11, 0x7E}, {0x7F, 0x49, 0x49, 0x49, 0x36}, {0x3E, 0x41, 0x41, 0x41, 0x22},
+    {0x7F, 0x41, 0x41, 0x22, 0x1C}, {0x7F, 0x49, 0x49, 0x49, 0x41}, {0x7F, 0x09, 0x09, 0x01, 0x01},
+    {0x3E, 0x41, 0x41, 0x51, 0x32}, {0x7F, 0x08, 0x08, 0x08, 0x7F}, {0x00, 0x41, 0x7F, 0x41, 0x00},
+    {0x20, 0x40, 0x41, 0x3F, 0x01}, {0x7F, 0x08, 0x14, 0x22, 0x41}, {0x7F, 0x40, 0x40, 0x40, 0x40},
+    {0x7F, 0x02, 0x04, 0x02, 0x7F}, {0x7F, 0x04, 0x08, 0x10, 0x7F}, {0x3E, 0x41, 0x41, 0x41, 0x3E},
+    {0x7F, 0x09, 0x09, 0x09, 0x06}, {0x3E, 0x41, 0x51, 0x21, 0x5E}, {0x7F, 0x09, 0x19, 0x29, 0x46},
+    {0x46, 0x49, 0x49, 0x49, 0x31}, {0x01, 0x01, 0x7F, 0x01, 0x01}, {0x3F, 0x40, 0x40, 0x40, 0x3F},
+    {0x1F, 0x20, 0x40, 0x20, 0x1F}, {0x7F, 0x20, 0x18, 0x20, 0x7F}, {0x63, 0x14, 0x08, 0x14, 0x63},
+    {0x03, 0x04, 0x78, 0x04, 0x03}, {0x61, 0x51, 0x49, 0x45, 0x43}
+};
+#define FONT_FIRST  ' '
+#define FONT_LAST   'Z'
+
+static disp_view_t view;
+static disp_rect_t dirty[DISPLAY_MAX_DIRTY];
+static uint8_t dirtyCount = 0;
+static volatile bool redrawRequested = true;
+
+//two tiles: one is rendered while the uDMA sends the other
+static uint16_t tiles[2][DISPLAY_TILE_PIXELS];
+static uint16_t *tile;              //tile that is rendered
+static disp_rect_t tileRect;        //its area on the screen
+
+//MSP_ANALOG, written by the link RX tasks
+static volatile uint8_t vbat;       //0.1 V
+static volatile uint32_t vbatTick;  //Clock tick of the latest answer, 0: none yet
+static volatile bool analogAnswered;
+static bool analogPending = false;  //a request was sent, it is accounted with the next one
+static uint16_t lqHistory;          //one bit per request, set if it was answered
+static uint8_t lqRequests;          //requests in the history, up to DISPLAY_LQ_WINDOW
+
+static uint32_t cpuFreq;
+static uint32_t ticksPerUs;
+static display_stats_t stats;
+
+static Hwi_Struct dmaHwi;
+static Semaphore_Struct dmaDoneSem; //posted when the uDMA moved the whole tile into the SSI FIFO
+static Task_Struct displayTaskStruct;
+static Char displayTaskStack[TASK_STACK_DISPLAY];
+
+/*
+ *  SSI2 "DMA TX done" interrupt: the last byte is in the FIFO, wake up the display task
+ */
+static void dma_hwi(UArg arg0)
+{
+    SSIIntDisable(DISPLAY_SSI_BASE, SSI_DMATX);
+    SSIIntClear(DISPLAY_SSI_BASE, SSI_DMATX);
+    Semaphore_post(Semaphore_handle(&dmaDoneSem));
+}
+
+//takes SSI2 from the SD card and selects the LCD
+//the SD card driver sets up SSI2 on its own, mode and rate are set again whenever the LCD takes the bus
+static void acquire_bus(void)
+{
+    blackbox_lockBus();
+    SSIDisable(DISPLAY_SSI_BASE);
+    SSIConfigSetExpClk(DISPLAY_SSI_BASE, cpuFreq, SSI_FRF_MOTO_MODE_0, SSI_MODE_MASTER, DISPLAY_SPI_BITRATE, 8);
+    SSIEnable(DISPLAY_SSI_BASE);
+    GPIOPinWrite(DISPLAY_CS_PORT, DISPLAY_CS_PIN, 0);
+}
+
+//waits for the last bit, deselects the LCD and empties the receive FIFO, the SD card driver reads it
+static void release_bus(void)
+{
+    uint32_t dummy;
+
+    while(SSIBusy(DISPLAY_SSI_BASE))
+    {}
+    GPIOPinWrite(DISPLAY_CS_PORT, DISPLAY_CS_PIN, DISPLAY_CS_PIN);
+    while(SSIDataGetNonBlocking(DISPLAY_SSI_BASE, &dummy))
+    {}
+    blackbox_unlockBus();
+}
+
+//command with its parameters, polled: a few bytes are not worth a uDMA transfer
+//RS stays high afterwards, so RAMWR can be followed by the pixels
+static void write_command(uint8_t cmd, const uint8_t *data, uint8_t size)
+{
+    uint8_t i;
+
+    GPIOPinWrite(DISPLAY_RS_PORT, DISPLAY_RS_PIN, 0);
+    SSIDataPut(DISPLAY_SSI_BASE, cmd);
+    while(SSIBusy(DISPLAY_SSI_BASE))
+    {}
+    GPIOPinWrite(DISPLAY_RS_PORT, DISPLAY_RS_PIN, DISPLAY_RS_PIN);
+    for(i = 0; i < size; i++)
+    {
+        SSIDataPut(DISPLAY_SSI_BASE, data[i]);
+    }
+    while(SSIBusy(DISPLAY_SSI_BASE))
+    {}
+}
+
+static void set_window(const disp_rect_t *r)
+{
+    uint8_t cols[4] = { 0, r->x + DISPLAY_COL_OFFSET, 0, r->x + r->w - 1 + DISPLAY_COL_OFFSET };
+    uint8_t rows[4] = { 0, r->y + DISPLAY_ROW_OFFSET, 0, r->y + r->h - 1 + DISPLAY_ROW_OFFSET };
+
+    write_command(ST_CASET, cols, sizeof(cols));
+    write_command(ST_RASET, rows, sizeof(rows));
+    write_command(ST_RAMWR, NULL, 0);
+}
+
+//hardware reset, wake up, 16 bit colors
+static void init_lcd(void)
+{
+    static const uint8_t colmod = ST_COLMOD_565;
+    static const uint8_t madctl = ST_MADCTL_UP;
+
+    GPIOPinWrite(DISPLAY_RST_PORT, DISPLAY_RST_PIN, 0);
+    Task_sleep(ST_RESET_MS);
+    GPIOPinWrite(DISPLAY_RST_PORT, DISPLAY_RST_PIN, DISPLAY_RST_PIN);
+    Task_sleep(ST_WAKE_MS);
+
+    acquire_bus();
+    write_command(ST_SLPOUT, NULL, 0);
+    release_bus();
+    Task_sleep(ST_WAKE_MS); //the SD card can use the bus meanwhile
+
+    acquire_bus();
+    write_command(ST_COLMOD, &colmod, 1);
+    write_command(ST_MADCTL, &madctl, 1);
+    write_command(ST_DISPON, NULL, 0);
+    release_bus();
+}
+
+//starts sending the tile, the bus stays with the LCD until finish_tile
+static void start_tile(const disp_rect_t *r, uint16_t *pixels)
+{
+    uint16_t bytes = r->w * r->h * 2;
+
+    acquire_bus();
+    set_window(r);
+    SSIDMAEnable(DISPLAY_SSI_BASE, SSI_DMA_TX);
+    uDMAChannelTransferSet(DISPLAY_DMA_CHANNEL | UDMA_PRI_SELECT, UDMA_MODE_BASIC, pixels,
+                           (void *)(DISPLAY_SSI_BASE + SSI_O_DR), bytes);
+    SSIIntClear(DISPLAY_SSI_BASE, SSI_DMATX);
+    SSIIntEnable(DISPLAY_SSI_BASE, SSI_DMATX);
+    uDMAChannelEnable(DISPLAY_DMA_CHANNEL);
+
+    stats.tiles++;
+    stats.pixels += bytes / 2;
+    metrics_inc(MET_DISPLAY_TILES);
+}
+
+//sleeps until the uDMA is done and hands the bus back
+static void finish_tile(void)
+{
+    Semaphore_pend(Semaphore_handle(&dmaDoneSem), BIOS_WAIT_FOREVER);
+    SSIDMADisable(DISPLAY_SSI_BASE, SSI_DMA_TX);
+    release_bus();
+}
+
+//fills the part of the rectangle that is inside the tile
+static void fill(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color)
+{
+    int16_t x0 = (x > tileRect.x) ? x : tileRect.x;
+    int16_t y0 = (y > tileRect.y) ? y : tileRect.y;
+    int16_t x1 = (x + w < tileRect.x + tileRect.w) ? x + w : tileRect.x + tileRect.w;
+    int16_t y1 = (y + h < tileRect.y + tileRect.h) ? y + h : tileRect.y + tileRect.h;
+    uint16_t *row;
+    int16_t i;
+
+    for(; y0 < y1; y0++)
+    {
+        row = &tile[(y0 - tileRect.y) * tileRect.w];
+        for(i = x0; i < x1; i++)
+        {
+            row[i - tileRect.x] = color;
+        }
+    }
+}
+
+static void frame(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color)
+{
+    fill(x, y, w, 1, color);
+    fill(x, y + h - 1, w, 1, color);
+    fill(x, y + 1, 1, h - 2, color);
+    fill(x + w - 1, y + 1, 1, h - 2, color);
+}
+
+//draws the set pixels of the text, scale 1 or 2; characters outside of the tile are skipped
+static void text(int16_t x, int16_t y, uint8_t scale, const char *s, uint16_t color)
+{
+    const uint8_t *glyph;
+    uint8_t col;
+    uint8_t row;
+    char c;
+
+    if(y >= tileRect.y + tileRect.h || y + TEXT_H * scale <= tileRect.y)
+    {
+        return;
+    }
+    for(; *s != '\0'; s++, x += TEXT_W * scale)
+    {
+        if(x >= tileRect.x + tileRect.w || x + TEXT_W * scale <= tileRect.x)
+        {
+            continue;
+        }
+        c = (*s >= 'a' && *s <= 'z') ? *s - 'a' + 'A' : *s;
+        glyph = font[(c >= FONT_FIRST && c <= FONT_LAST) ? c - FONT_FIRST : 0];
+        for(col = 0; col < 5; col++)
+        {
+            for(row = 0; row < 7; row++)
+            {
+                if(glyph[col] & (1 << row))
+                {
+                    fill(x + col * scale, y + row * scale, scale, scale, color);
+                }
+            }
+        }
+    }
+}
+
+//renders everything that lies inside the tile
+static void draw_scene(void)
+{
+    const char *arm = view.armed ? "ARMED" : "SAFE";
+    uint8_t i;
+
+    fill(0, 0, DISPLAY_WIDTH, DISPLAY_HEIGHT, BLACK);
+    for(i = 0; i < LINE_COUNT; i++)
+    {
+        text(2, lineY[i], 1, view.lines[i].text, view.lines[i].color);
+    }
+
+    fill(0, ARM_Y, DISPLAY_WIDTH, ARM_H, view.armed ? RED : DARK_GREEN);
+    text((DISPLAY_WIDTH - (int16_t)strlen(arm) * TEXT_W * 2) / 2, ARM_Y + 3, 2, arm, WHITE);
+
+    frame(BOX_X, BOX_Y, BOX_SIZE, BOX_SIZE, GREY);
+    fill(BOX_X + BOX_SIZE / 2, BOX_Y + 1, 1, BOX_SIZE - 2, DARK_GREY);
+    fill(BOX_X + 1, BOX_Y + BOX_SIZE / 2, BOX_SIZE - 2, 1, DARK_GREY);
+    fill(view.dotX, view.dotY, DOT_SIZE, DOT_SIZE, YELLOW);
+
+    frame(BAR_X, BOX_Y, BAR_W, BOX_SIZE, GREY);
+    fill(BAR_X + 1, view.throttleY, BAR_W - 2, BOX_Y + BOX_SIZE - 1 - view.throttleY, CYAN);
+}
+
+//rectangles that touch are merged, a full list merges into the last one
+static void mark_dirty(int16_t x, int16_t y, int16_t w, int16_t h)
+{
+    disp_rect_t *d;
+    int16_t x1;
+    int16_t y1;
+    uint8_t i;
+
+    if(w <= 0 || h <= 0)
+    {
+        return;
+    }
+    for(i = 0; i < dirtyCount; i++)
+    {
+        d = &dirty[i];
+        if(x <= d->x + d->w && d->x <= x + w && y <= d->y + d->h && d->y <= y + h)
+        {
+            break;
+        }
+    }
+    if(i == dirtyCount && dirtyCount < DISPLAY_MAX_DIRTY)
+    {
+        d = &dirty[dirtyCount++];
+        d->x = x;
+        d->y = y;
+        d->w = w;
+        d->h = h;
+        return;
+    }
+    d = &dirty[(i < dirtyCount) ? i : dirtyCount - 1];
+    x1 = (x + w > d->x + d->w) ? x + w : d->x + d->w;
+    y1 = (y + h > d->y + d->h) ? y + h : d->y + d->h;
+    d->x = (x < d->x) ? x : d->x;
+    d->y = (y < d->y) ? y : d->y;
+    d->w = x1 - d->x;
+    d->h = y1 - d->y;
+}
+
+static void set_line(disp_line_id_t id, const char *s, uint16_t color)
+{
+    disp_line_t *line = &view.lines[id];
+
+    if(strcmp(line->text, s) != 0 || line->color != color)
+    {
+        strncpy(line->text, s, LINE_SIZE - 1);
+        line->color = color;
+        mark_dirty(0, lineY[id], DISPLAY_WIDTH, TEXT_H);
+    }
+}
+
+static uint8_t link_quality(void)
+{
+    uint16_t bits = lqHistory;
+    uint8_t answered = 0;
+
+    while(bits != 0)
+    {
+        answered += bits & 1;
+        bits >>= 1;
+    }
+    return answered * 100 / lqRequests;
+}
+
+//takes the latest values, everything that changed on the screen is marked dirty
+static void update_view(void)
+{
+    char s[LINE_SIZE];
+    js_sample_t sample;
+    uint8_t route;
+    uint8_t lq;
+    int16_t pos;
+
+    if(vbatTick != 0 && Clock_getTicks() - vbatTick < ANALOG_STALE_MS)
+    {
+        System_snprintf(s, sizeof(s), "BAT %u.%uV", vbat / 10, vbat % 10);
+        set_line(LINE_BATTERY, s, (vbat < DISPLAY_VBAT_LOW) ? RED : GREEN);
+    }
+    else
+    {
+        set_line(LINE_BATTERY, "BAT --.-V", GREY);
+    }
+
+    if(!bt_routeReady())
+    {
+        set_line(LINE_LINK, "LINK DOWN", RED);
+    }
+    else
+    {
+        route = bt_getRoute();
+        System_snprintf(s, sizeof(s), "LINK %s", (route == BT_ROUTE_ALL) ? "all" : bt_linkName(bt_getLink(route)));
+        if(lqRequests == 0)
+        {
+            set_line(LINE_LINK, s, WHITE);
+        }
+        else
+        {
+            lq = link_quality();
+            System_snprintf(s + strlen(s), sizeof(s) - strlen(s), " %u%%", lq);
+            set_line(LINE_LINK, s, (lq >= 80) ? GREEN : (lq >= 50) ? YELLOW : RED);
+        }
+    }
+
+    joystick_getSample(&sample);
+    System_snprintf(s, sizeof(s), "R%u P%u T%u", sample.roll, sample.pitch, sample.throttle);
+    set_line(LINE_STICKS, s, WHITE);
+
+    if(sample.armed != view.armed)
+    {
+        view.armed = sample.armed;
+        mark_dirty(0, ARM_Y, DISPLAY_WIDTH, ARM_H);
+    }
+
+    //the dot only dirties its old and its new place
+    pos = BOX_X + 1 + ((int32_t)sample.roll - 1000) * (BOX_SIZE - 2 - DOT_SIZE) / 1000;
+    if(pos != view.dotX)
+    {
+        mark_dirty(view.dotX, view.dotY, DOT_SIZE, DOT_SIZE);
+        view.dotX = pos;
+        mark_dirty(view.dotX, view.dotY, DOT_SIZE, DOT_SIZE);
+    }
+    pos = BOX_Y + 1 + (2000 - (int32_t)sample.pitch) * (BOX_SIZE - 2 - DOT_SIZE) / 1000;
+    if(pos != view.dotY)
+    {
+        mark_dirty(view.dotX, view.dotY, DOT_SIZE, DOT_SIZE);
+        view.dotY = pos;
+        mark_dirty(view.dotX, view.dotY, DOT_SIZE, DOT_SIZE);
+    }
+
+    //the throttle bar only dirties the band between the old and the new level
+    pos = BOX_Y + BOX_SIZE - 1 - ((int32_t)sample.throttle - 1000) * (BOX_SIZE - 2) / 1000;
+    if(pos != view.throttleY)
+    {
+        mark_dirty(BAR_X + 1, (pos < view.throttleY) ? pos : view.throttleY, BAR_W - 2,
+                   (pos < view.throttleY) ? view.throttleY - pos : pos - view.throttleY);
+        view.throttleY = pos;
+    }
+}
+
+//renders the dirty rectangles in bands of one tile, a band is rendered while the previous one is sent
+static void flush_dirty(void)
+{
+    disp_rect_t band;
+    bool sending = false;
+    uint8_t next = 0;
+    int16_t rows;
+    uint8_t i;
+
+    for(i = 0; i < dirtyCount; i++)
+    {
+        rows = DISPLAY_TILE_PIXELS / dirty[i].w;
+        band = dirty[i];
+        for(band.y = dirty[i].y; band.y < dirty[i].y + dirty[i].h; band.y += rows)
+        {
+            band.h = (dirty[i].y + dirty[i].h - band.y < rows) ? dirty[i].y + dirty[i].h - band.y : rows;
+            tile = tiles[next];
+            tileRect = band;
+            draw_scene();
+            if(sending)
+            {
+                finish_tile();
+            }
+            start_tile(&band, tile);
+            sending = true;
+            next ^= 1;
+        }
+    }
+    if(sending)
+    {
+        finish_tile();
+    }
+    dirtyCount = 0;
+}
+
+//accounts the previous request and asks the copters of the route for MSP_ANALOG
+static void request_analog(void)
+{
+    static const char request[6] = { '$', 'M', '<', 0, MSP_ANALOG, MSP_ANALOG };
+
+    if(!bt_routeReady())
+    {
+        lqHistory = 0;
+        lqRequests = 0;
+        analogPending = false;
+        return;
+    }
+    if(analogPending)
+    {
+        lqHistory = ((lqHistory << 1) | analogAnswered) & ((1 << DISPLAY_LQ_WINDOW) - 1);
+        if(lqRequests < DISPLAY_LQ_WINDOW)
+        {
+            lqRequests++;
+        }
+    }
+    analogAnswered = false;
+    analogPending = bt_queueFrame(request, sizeof(request));
+}
+
+//MSP_ANALOG response of the copter, called with every telemetry record by the link RX tasks
+void display_telemetry(const char *data, uint8_t size)
+{
+    uint8_t checksum = 0;
+    uint8_t i;
+
+    if(size < 7 || data[0] != '$' || data[1] != 'M' || data[2] != '>' || (uint8_t)data[4] != MSP_ANALOG
+       || size != (uint8_t)data[3] + 6)
+    {
+        return;
+    }
+    for(i = 3; i < size - 1; i++)
+    {
+        checksum ^= data[i];
+    }
+    if(checksum != (uint8_t)data[size - 1])
+    {
+        return;
+    }
+    vbat = data[5];
+    vbatTick = Clock_getTicks();
+    analogAnswered = true;
+}
+
+void display_redraw(void)
+{
+    redrawRequested = true;
+}
+
+void display_getStats(display_stats_t *copy)
+{
+    UInt key = Hwi_disable();
+    *copy = stats;
+    Hwi_restore(key);
+}
+
+/*
+ *  Display task: wakes up every DISPLAY_PERIOD_MS and sends the changed regions
+ */
+void display_fnx(UArg arg0, UArg arg1)
+{
+    uint32_t lastRequest = Clock_getTicks();
+    uint32_t start;
+    uint32_t us;
+
+    init_lcd();
+
+    while(1)
+    {
+        if(Clock_getTicks() - lastRequest >= DISPLAY_ANALOG_MS)
+        {
+            lastRequest = Clock_getTicks();
+            request_analog();
+        }
+        if(redrawRequested)
+        {
+            redrawRequested = false;
+            dirtyCount = 0;
+            mark_dirty(0, 0, DISPLAY_WIDTH, DISPLAY_HEIGHT);
+        }
+        update_view();
+
+        if(dirtyCount > 0)
+        {
+            start = Timestamp_get32();
+            flush_dirty();
+            us = (Timestamp_get32() - start) / ticksPerUs;
+
+            UInt key = Hwi_disable();
+            stats.frames++;
+            if(us > stats.maxFrameUs)
+            {
+                stats.maxFrameUs = us;
+            }
+            Hwi_restore(key);
+        }
+        Task_sleep(DISPLAY_PERIOD_MS);
+    }
+}
+
+static void cmd_display(uint8_t argc, char *argv[])
+{
+    display_stats_t copy;
+
+    if(argc == 2 && strcmp(argv[1], "redraw") == 0)
+    {
+        display_redraw();
+        return;
+    }
+    if(argc != 1)
+    {
+        console_printf("usage: display [redraw]\r\n");
+        return;
+    }
+    display_getStats(&copy);
+    console_printf("%u frames, %u tiles, %u pixels, longest frame %u us\r\n",
+                   copy.frames, copy.tiles, copy.pixels, copy.maxFrameUs);
+}
+
+static const console_cmd_t displayCmd = { "display", "LCD counters, repaint: redraw", cmd_display };
+
+/*
+ *  Sets up the LCD pins and the uDMA channel of SSI2 and creates the display task
+ *  Board_initSDSPI (SSI2 pins), Board_initDMA and setUpBlackbox_Task (bus lock) must have been called
+ */
+void setUpDisplay_Task(void)
+{
+    Types_FreqHz freq;
+
+    BIOS_getCpuFreq(&freq);
+    cpuFreq = freq.lo;
+    Timestamp_getFreq(&freq);
+    ticksPerUs = freq.lo / 1000000;
+
+    //N2 = CS, L3 = RS, H3 = RST, all idle high
+    SysCtlPeripheralEnable(SYSCTL_PERIPH_GPION);
+    SysCtlPeripheralEnable(SYSCTL_PERIPH_GPIOL);
+    SysCtlPeripheralEnable(SYSCTL_PERIPH_GPIOH);
+    GPIOPinTypeGPIOOutput(DISPLAY_CS_PORT, DISPLAY_CS_PIN);
+    GPIOPinTypeGPIOOutput(DISPLAY_RS_PORT, DISPLAY_RS_PIN);
+    GPIOPinTypeGPIOOutput(DISPLAY_RST_PORT, DISPLAY_RST_PIN);
+    GPIOPinWrite(DISPLAY_CS_PORT, DISPLAY_CS_PIN, DISPLAY_CS_PIN);
+    GPIOPinWrite(DISPLAY_RS_PORT, DISPLAY_RS_PIN, DISPLAY_RS_PIN);
+    GPIOPinWrite(DISPLAY_RST_PORT, DISPLAY_RST_PIN, DISPLAY_RST_PIN);
+
+    uDMAChannelAssign(UDMA_CH13_SSI2TX);
+    uDMAChannelAttributeDisable(DISPLAY_DMA_CHANNEL, UDMA_ATTR_ALL);
+    uDMAChannelControlSet(DISPLAY_DMA_CHANNEL | UDMA_PRI_SELECT,
+                          UDMA_SIZE_8 | UDMA_SRC_INC_8 | UDMA_DST_INC_NONE | UDMA_ARB_4);
+
+    Semaphore_Params semParams;
+    Semaphore_Params_init(&semParams);
+    semParams.mode = Semaphore_Mode_BINARY;
+    Semaphore_construct(&dmaDoneSem, 0, &semParams);
+
+    Hwi_Params hwiParams;
+    Hwi_Params_init(&hwiParams);
+    hwiParams.priority = DISPLAY_HWI_PRIORITY;
+    Hwi_construct(&dmaHwi, DISPLAY_SSI_INT, dma_hwi, &hwiParams, NULL);
+
+    Task_Params taskParams;
+    Task_Params_init(&taskParams);
+    taskParams.stack = &displayTaskStack;
+    taskParams.stackSize = sizeof(displayTaskStack);
+    taskParams.priority = TASK_PRIO_DISPLAY;
+    Task_construct(&displayTaskStruct, (Task_FuncPtr) display_fnx, &taskParams, NULL);
+
+    sysmon_registerTask(Task_handle(&displayTaskStruct), "display");
+    console_addCommand(&displayCmd);
+}
@@ -0,0 +1,131 @@
+/*
+ * executor.c
+ *
+ *  Created on: 19.10.2026
+ *
+ *  Cooperative run loop for low-rate jobs, hosted in the housekeeping task.
+ *  The task sleeps on a semaphore until the next job is due, so an idle executor
+ *  costs no CPU time. See executor.h for how to write a job.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include <xdc/std.h>
+#include <xdc/runtime/System.h>
+
+#include <ti/sysbios/BIOS.h>
+#include <ti/sysbios/hal/Hwi.h>
+#include <ti/sysbios/knl/Clock.h>
+#include <ti/sysbios/knl/Semaphore.h>
+#include <ti/sysbios/knl/Task.h>
+
+#include <executor.h>
+#include <sysmon.h>
+#include <tasks.h>
+#include <trace.h>
+
+//single linked list of all active jobs
+static exec_job_t *jobs = NULL;
+
+//set by exec_wake, makes all waiting jobs re-check their condition
+static volatile bool wakeRequested = false;
+static Semaphore_Struct execSem;
+
+static Task_Struct housekeepingTaskStruct;
+static Char housekeepingTaskStack[TASK_STACK_HOUSEKEEPING];
+
+//adds a job, it runs for the first time on the next pass of the executor
+//can be called before BIOS_start and from any task
+void exec_add(exec_job_t *job, exec_fnx_t fnx, const char *name)
+{
+    job->fnx = fnx;
+    job->name = name;
+    job->lc = 0;
+    job->waiting = false;
+    job->wakeTick = Clock_getTicks();
+
+    UInt key = Hwi_disable();
+    job->next = jobs;
+    jobs = job;
+    Hwi_restore(key);
+
+    exec_wake();
+}
+
+//wakes up the executor, can be called from Task, Swi and Hwi context
+void exec_wake(void)
+{
+    wakeRequested = true;
+    trace_event(TRACE_SEM_POST, TRACE_SEM_EXEC_WAKE);
+    Semaphore_post(Semaphore_handle(&execSem));
+}
+
+/*
+ *  Low priority housekeeping task: runs every due job once per pass and sleeps
+ *  until the next job is due or exec_wake() was called.
+ */
+void housekeeping_fnx(UArg arg0, UArg arg1)
+{
+    while (1)
+    {
+        exec_job_t **link = &jobs;
+        int32_t timeout = EXEC_IDLE_MS;
+        bool wakeAll;
+
+        UInt key = Hwi_disable();
+        wakeAll = wakeRequested;
+        wakeRequested = false;
+        Hwi_restore(key);
+
+        while(*link != NULL)
+        {
+            exec_job_t *job = *link;
+            uint32_t now = Clock_getTicks();
+
+            if((job->waiting && wakeAll) || (int32_t)(job->wakeTick - now) <= 0)
+            {
+                if(job->fnx(job) == JOB_ENDED)
+                {
+                    key = Hwi_disable();
+                    *link = job->next;
+                    Hwi_restore(key);
+                    continue;
+                }
+                if(job->waiting)
+                {
+                    job->wakeTick = Clock_getTicks() + EXEC_POLL_MS;
+                }
+            }
+
+            int32_t remaining = (int32_t)(job->wakeTick - Clock_getTicks());
+            if(remaining < timeout)
+            {
+                timeout = remaining;
+            }
+            link = &job->next;
+        }
+
+        Semaphore_pend(Semaphore_handle(&execSem), (timeout > 0) ? (UInt32)timeout : BIOS_NO_WAIT);
+    }
+}
+
+/*
+ *  Set up the executor and the housekeeping task hosting it
+ */
+void setUpHousekeeping_Task(void)
+{
+    Semaphore_Params semParams;
+    Semaphore_Params_init(&semParams);
+    semParams.mode = Semaphore_Mode_BINARY;
+    Semaphore_construct(&execSem, 0, &semParams);
+
+    Task_Params taskParams;
+    Task_Params_init(&taskParams);
+    taskParams.stack = &housekeepingTaskStack;
+    taskParams.stackSize = sizeof(housekeepingTaskStack);
+    taskParams.priority = TASK_PRIO_HOUSEKEEPING;
+    Task_construct(&housekeepingTaskStruct, (Task_FuncPtr) housekeeping_fnx, &taskParams, NULL);
+
+    sysmon_registerTask(Task_handle(&housekeepingTaskStruct), "housekeeping");
+}
@@ -6,59 +6,245 @@
  */
 
 #include <joystick.h>
-#include <bluetooth.h>
+#include <blackbox.h>
+#include <config.h>
+#include <console.h>
+#include <control.h>
+#include <deadline.h>
+#include <executor.h>
+#include <metrics.h>
+#include <ramfunc.h>
+#include <replay.h>
+#include <sysmon.h>
+#include <tasks.h>
+#include <trace.h>
+#include <udpbridge.h>
+#include <usbcdc.h>
 
+#include <string.h>
+
+#include "inc/hw_ints.h"
 #include "driverlib/sysctl.h"
 #include "driverlib/adc.h"
+#include <ti/sysbios/BIOS.h>
+#include <ti/sysbios/hal/Hwi.h>
+#include <ti/sysbios/knl/Clock.h>
+#include <ti/sysbios/knl/Semaphore.h>
 #include <ti/sysbios/knl/Task.h>
 #include <xdc/runtime/System.h>
+#include <xdc/runtime/Timestamp.h>
+#include <xdc/runtime/Types.h>
 #include <ti/drivers/GPIO.h>
 #include <Board.h>
 
 static Bool isArmed = false;
 static uint16_t throttle = 1000;
-extern uint8_t bluetooth_ready;
+
+//latest sample, written by the sampling task and read by the control task
+static js_sample_t latestSample;
+
+//menu mode: button presses are collected for joystick_takeButtons instead of controlling the copter
+static volatile bool menuMode = false;
+static volatile uint8_t menuButtons = 0;
+
+static Clock_Struct sampleClock;        //starts a new sample every loopPeriodMs (config)
+static Semaphore_Struct sampleTickSem;  //posted by sampleClock
+static Semaphore_Struct adcDoneSem;     //posted by the ADC sequence interrupt
+static Hwi_Struct adcHwi;
+static uint32_t adcSamples[2];          //filled by the ADC interrupt: [0] pitch, [1] roll
+static volatile bool samplePending = false; //set by sampleClock, cleared by the sampling task
+
+//map per axis (calibration, rate and expo), computed once so a sample needs no division
+typedef struct js_axis_map_t {
+    uint32_t center;
+    uint32_t scaleLow;
+    uint32_t scaleHigh;
+    uint32_t expo;      //share of the cubic curve, 256 = 100%
+} js_axis_map_t;
+static js_axis_map_t axisMap[CFG_AXIS_COUNT];
+
+//input record and replay (replay.c): the ring holds what the sampling task got from the hardware
+static volatile js_input_mode_t inputMode = JS_INPUT_LIVE;
+static uint8_t inputBuffer[REPLAY_RING_SIZE];
+static replay_ring_t inputRing;
+static bool replayLoop = false;
+static bool replayStarted = false;    //the state of the first keyframe was applied
+static replay_event_t replayEvent;    //next event of the replay, not due yet if replayHeld
+static bool replayHeld = false;
+static uint32_t replayOffset;         //Clock tick of the replay minus the recorded time
+
+//remote input (udpbridge.c): sticks, throttle and arming of the ground station
+static js_remote_t remoteInput;
+static uint32_t remoteTick;           //Clock tick of the latest remote input
+static volatile bool remoteRevoked = false; //a button ended the remote input, only "remote on" allows it again
+
+static Task_Struct joystickTaskStruct;
+static Char joystickTaskStack[TASK_STACK_SAMPLING];
 
 void joystick_fnx(UArg arg0);
 
 /*
- *  Interrupt for arming and disarming
+ *  Arming toggle and throttle steps (+-throttleStep, default 25, limited to 1000-2000).
+ *  Called by the button interrupts and by the replay.
  */
-void setArm(unsigned int index)
+static void apply_button(uint8_t button)
 {
-        if(isArmed == false)
+    if(button & JS_BTN_SELECT)
+    {
+        isArmed = !isArmed;
+    }
+    if(button & JS_BTN_UP)
+    {
+        throttle = throttle + config->throttleStep;
+        if(throttle > 2000)
         {
-            isArmed = true;
+            throttle = 2000;
+        }
+    }
+    if(button & JS_BTN_DOWN)
+    {
+        if(throttle < 1000 + config->throttleStep)
+        {
+            throttle = 1000;
         }
         else
         {
-            isArmed = false;
+            throttle = throttle - config->throttleStep;
         }
+    }
+}
+
+//adds an input event to the recording, can be called from Task and Hwi context
+static void record_event(replay_event_t *event)
+{
+    UInt key = Hwi_disable();
+
+    if(inputMode == JS_INPUT_RECORD)
+    {
+        event->time = Clock_getTicks();
+        event->state = throttle | ((uint32_t)isArmed << 16);
+        replay_put(&inputRing, event);
+    }
+    Hwi_restore(key);
 }
 
 /*
- *  Interrupt for adjusting the throttle up (+25 steps). Limit at 2000.
+ *  Back to the sticks. After a replay or the ground station they take over disarmed at minimum
+ *  throttle, the throttle and arming of the replay or the remote input must not keep the copter flying.
  */
-void throttleUp(unsigned int index)
+static void return_to_live(void)
 {
-    throttle = throttle + 25;
-    if(throttle > 2000)
+    UInt key = Hwi_disable();
+    if(inputMode == JS_INPUT_REPLAY || inputMode == JS_INPUT_REMOTE)
+    {
+        throttle = 1000;
+        isArmed = false;
+    }
+    inputMode = JS_INPUT_LIVE;
+    Hwi_restore(key);
+}
+
+//common part of the button interrupts: menu, live or recorded input (ignored during a replay)
+static void button_pressed(uint8_t button)
+{
+    replay_event_t event;
+
+    if(menuMode)
+    {
+        menuButtons |= button;
+        exec_wake();
+        return;
+    }
+    if(inputMode == JS_INPUT_REPLAY)
+    {
+        return;
+    }
+    if(inputMode == JS_INPUT_REMOTE)
+    {
+        //the pilot at the handset takes over disarmed, the station stays out until "remote on"
+        remoteRevoked = true;
+        return_to_live();
+        return;
+    }
+    apply_button(button);
+    if(inputMode == JS_INPUT_RECORD)
     {
-        throttle = 2000;
+        event.type = REPLAY_BUTTON;
+        event.buttons = button;
+        record_event(&event);
     }
 }
 
 /*
- *  Interrupt for adjusting the throttle down (-25 steps). Limit at 1000.
+ *  Interrupt for arming and disarming
+ */
+void setArm(unsigned int index)
+{
+    button_pressed(JS_BTN_SELECT);
+}
+
+/*
+ *  Interrupt for adjusting the throttle up
+ */
+void throttleUp(unsigned int index)
+{
+    button_pressed(JS_BTN_UP);
+}
+
+/*
+ *  Interrupt for adjusting the throttle down
  */
 void throttleDown(unsigned int index)
 {
+    button_pressed(JS_BTN_DOWN);
+}
 
-    throttle = throttle - 25;
-    if(throttle < 1000)
+/*
+ *  Switches the buttons to menu mode for one owner at a time (scan, stick calibration).
+ *  Returns false while another owner holds the menu, the presses belong to it.
+ */
+bool joystick_enterMenu(void)
+{
+    UInt key = Hwi_disable();
+    bool entered = !menuMode;
+
+    if(entered)
     {
-        throttle = 1000;
+        menuButtons = 0;
+        menuMode = true;
     }
+    Hwi_restore(key);
+    return entered;
+}
+
+/*
+ *  Ends the menu mode of the owner, the buttons arm and change the throttle again.
+ *  Always disarms: a select meant for the menu must never leave the copter armed.
+ */
+void joystick_leaveMenu(void)
+{
+    UInt key = Hwi_disable();
+    menuButtons = 0;
+    menuMode = false;
+    isArmed = false;
+    Hwi_restore(key);
+}
+
+bool joystick_buttonsPending(void)
+{
+    return menuButtons != 0;
+}
+
+/*
+ *  Returns the buttons pressed in menu mode since the last call (JS_BTN_x).
+ */
+uint8_t joystick_takeButtons(void)
+{
+    UInt key = Hwi_disable();
+    uint8_t buttons = menuButtons;
+    menuButtons = 0;
+    Hwi_restore(key);
+    return buttons;
 }
 
 /*
@@ -95,90 +281,603 @@ void setup_ADC_edumkII(void)
     ADCSequenceStepConfigure(JS_ADC_BASE, 1, 1, JS_CH_ROLL | ADC_CTL_IE | ADC_CTL_END);
 
     ADCSequenceEnable(JS_ADC_BASE, 1); //allows sample capture when triggered
+    ADCIntClear(JS_ADC_BASE, 1);
+    ADCIntEnable(JS_ADC_BASE, 1); //sequence end raises INT_ADC0SS1 instead of being polled
 }
 
 /*
- *  Set up task for the Joystick controller with the highest task priority for fast reading of the ADC values
+ *  ADC sample sequence 1 interrupt: fetch both samples and wake up the sampling task
  */
-void setUpJoyStick_Task(void)
+static RAMFUNC void adc_hwi(UArg arg0)
 {
+    ADCIntClear(JS_ADC_BASE, 1);
+    ADCSequenceDataGet(JS_ADC_BASE, 1, adcSamples);
+    trace_event(TRACE_SEM_POST, TRACE_SEM_ADC_DONE);
+    Semaphore_post(Semaphore_handle(&adcDoneSem));
+}
+
+/*
+ *  Clock function: release the sampling task once per loop period
+ */
+static RAMFUNC void sample_tick(UArg arg0)
+{
+    //the task did not take the previous tick yet, that sample is lost
+    if(samplePending)
+    {
+        metrics_inc(MET_ADC_OVERRUNS);
+    }
+    samplePending = true;
+    trace_event(TRACE_SEM_POST, TRACE_SEM_SAMPLE_TICK);
+    Semaphore_post(Semaphore_handle(&sampleTickSem));
+}
 
-    Task_Params old_taskParams;
-    Task_Handle old_taskHandle;
-    Error_Block eb;
-    Error_init(&eb);
+/*
+ *  Trigger the ADC and block until the sequence interrupt delivered both samples
+ */
+static void read_adc(void)
+{
+    ADCProcessorTrigger(JS_ADC_BASE, 1);
+    Semaphore_pend(Semaphore_handle(&adcDoneSem), BIOS_WAIT_FOREVER);
+}
 
-    Task_Params_init(&old_taskParams);
-    old_taskParams.stackSize = 2024; //Stacksize in bytes
-    old_taskParams.priority = 15; //0-15, 15 being highest priority
-    old_taskParams.arg0 = (UArg) 1;
-    old_taskHandle = Task_create((Task_FuncPtr) joystick_fnx, &old_taskParams, &eb);
+/*
+ *  Applies every event of the replay that is due by its recorded time: the replay runs at the
+ *  speed of the recording whatever the current sampling period. The latest due sample replaces
+ *  the ADC pair, without a due sample the previous one is kept.
+ *  Returns false at the end of the recording.
+ */
+static bool replay_input(void)
+{
+    uint32_t now = Clock_getTicks();
 
-    if (old_taskHandle == NULL)
+    while(1)
     {
-        System_abort("Create Joystick_task_setup failed");
+        if(!replayHeld)
+        {
+            if(!replay_next(&inputRing, &replayEvent))
+            {
+                return false;
+            }
+            replayHeld = true;
+        }
+        if(!replayStarted)
+        {
+            throttle = replayEvent.state & 0xFFFF;
+            isArmed = (replayEvent.state >> 16) != 0;
+            replayOffset = now - replayEvent.time;
+            replayStarted = true;
+        }
+        if((int32_t)(replayEvent.time + replayOffset - now) > 0)
+        {
+            return true;
+        }
+        replayHeld = false;
+        if(replayEvent.type == REPLAY_BUTTON)
+        {
+            apply_button(replayEvent.buttons);
+        }
+        else
+        {
+            adcSamples[1] = replayEvent.roll;
+            adcSamples[0] = replayEvent.pitch;
+        }
     }
 }
 
 /*
- *  This is the joystick RTOS task, also used
- *  for processing joystick and button data. Scale and limit ADC values to range of 1000-2000.
- *  Send copter control data (roll,pitch,throttle,isArmed) to bluetooth.c to be packaged and sent to the copter.
+ *  Raw input of one sample: from the ADC (recorded in record mode) or from the replay
  */
-void joystick_fnx(UArg arg0)
+static void read_input(void)
 {
-    throttle = 1000;
-    uint32_t adcSamples[2];
-    static int16_t offsetRoll = 0;
-    static int16_t offsetPitch = 0;
-    static uint16_t roll = 1500;
-    static uint16_t pitch = 1500;
+    replay_event_t event;
+
+    if(inputMode == JS_INPUT_REPLAY)
+    {
+        if(replay_input())
+        {
+            return;
+        }
+        if(replayLoop)
+        {
+            replay_rewind(&inputRing);
+            replayStarted = false;
+            if(replay_input())
+            {
+                return;
+            }
+        }
+        return_to_live(); //end of the recording, back to the stick
+    }
+    if(inputMode == JS_INPUT_REMOTE)
+    {
+        if(Clock_getTicks() - remoteTick < JS_REMOTE_TIMEOUT_MS)
+        {
+            return;
+        }
+        return_to_live(); //the ground station went silent, disarmed back to the stick
+    }
 
-    ADCIntClear(ADC0_BASE, 1);
-    ADCProcessorTrigger(ADC0_BASE, 1);
-    while (!ADCIntStatus(ADC0_BASE, 1, false))
+    read_adc();
+    if(inputMode == JS_INPUT_RECORD)
     {
+        event.type = REPLAY_SAMPLE;
+        event.roll = adcSamples[1];
+        event.pitch = adcSamples[0];
+        record_event(&event);
     }
-    ADCSequenceDataGet(ADC0_BASE, 1, adcSamples);
+}
 
-    //calculate offset, while not touching joystick at the start
-    offsetRoll = 2000 - adcSamples[0];
-    offsetPitch = 2000 - adcSamples[1];
+/*
+ *  Latest input of the ground station, replaces the sticks and buttons until JS_REMOTE_TIMEOUT_MS
+ *  pass without a new one (disarmed at minimum throttle then) or a button is pressed.
+ *  The station takes over the sticks only while they are disarmed, with a disarmed first input and
+ *  not after a button revoked it. Refused while recording or replaying.
+ */
+bool joystick_setRemote(const js_remote_t *input)
+{
+    bool accepted;
+    UInt key = Hwi_disable();
 
-    while (1)
+    accepted = inputMode == JS_INPUT_REMOTE
+               || (inputMode == JS_INPUT_LIVE && !remoteRevoked && !isArmed && !input->armed);
+    if(accepted)
     {
-        Task_sleep(50);
-        if(bluetooth_ready == 0)
+        remoteInput = *input;
+        remoteTick = Clock_getTicks();
+        inputMode = JS_INPUT_REMOTE;
+    }
+    Hwi_restore(key);
+    return accepted;
+}
+
+/*
+ *  Copy the latest sample. Used by the control task.
+ */
+void joystick_getSample(js_sample_t *sample)
+{
+    UInt key = Hwi_disable();
+    *sample = latestSample;
+    Hwi_restore(key);
+}
+
+//prints the ring for tools/replay_dump.c: "RP,<seg size>,<segments>,<oldest>,<head>,<used>,<pos>"
+//followed by the whole buffer in lines of "RD,<hex>" and "RE"
+static void dump_input(void)
+{
+    static const char hex[] = "0123456789ABCDEF";
+    static char line[3 + 2 * 64 + 2];
+    uint32_t i;
+    uint8_t n;
+
+    console_printf("RP,%u,%u,%u,%u,%u,%u\r\n", REPLAY_SEG_SIZE, inputRing.segCount, inputRing.oldest,
+                   inputRing.head, inputRing.used, inputRing.pos);
+    for(i = 0; i < sizeof(inputBuffer); i += 64)
+    {
+        memcpy(line, "RD,", 3);
+        for(n = 0; n < 64; n++)
         {
-            continue;
+            line[3 + 2 * n] = hex[inputBuffer[i + n] >> 4];
+            line[4 + 2 * n] = hex[inputBuffer[i + n] & 0xF];
+        }
+        line[sizeof(line) - 2] = '\r';
+        line[sizeof(line) - 1] = '\n';
+        console_write(line, sizeof(line));
+    }
+    console_printf("RE\r\n");
+}
+
+static void cmd_replay(uint8_t argc, char *argv[])
+{
+    static const char *modes[] = { "live", "recording", "replaying", "remote" };
+    UInt key;
+
+    if(argc == 1)
+    {
+        console_printf("%s, %u events in %u bytes, %u segments overwritten\r\n", modes[inputMode],
+                       inputRing.events, replay_bytes(&inputRing), inputRing.overwritten);
+    }
+    else if(strcmp(argv[1], "record") == 0)
+    {
+        key = Hwi_disable();
+        replay_clear(&inputRing);
+        inputMode = JS_INPUT_RECORD;
+        Hwi_restore(key);
+    }
+    else if(strcmp(argv[1], "play") == 0)
+    {
+        key = Hwi_disable();
+        replay_rewind(&inputRing);
+        replayStarted = false;
+        replayHeld = false;
+        replayLoop = (argc == 3 && strcmp(argv[2], "loop") == 0);
+        inputMode = JS_INPUT_REPLAY;
+        Hwi_restore(key);
+    }
+    else if(strcmp(argv[1], "stop") == 0)
+    {
+        return_to_live();
+    }
+    else if(strcmp(argv[1], "dump") == 0)
+    {
+        return_to_live();
+        dump_input();
+    }
+    else
+    {
+        console_printf("usage: replay [record|play [loop]|stop|dump]\r\n");
+    }
+}
+
+static const console_cmd_t replayCmd = { "replay", "input record/replay: record|play [loop]|stop|dump", cmd_replay };
+
+static void cmd_remote(uint8_t argc, char *argv[])
+{
+    if(argc == 1)
+    {
+        console_printf("ground station input %s%s\r\n", remoteRevoked ? "off" : "on",
+                       inputMode == JS_INPUT_REMOTE ? ", flying" : "");
+    }
+    else if(strcmp(argv[1], "on") == 0)
+    {
+        remoteRevoked = false;
+    }
+    else if(strcmp(argv[1], "off") == 0)
+    {
+        remoteRevoked = true;
+        if(inputMode == JS_INPUT_REMOTE)
+        {
+            return_to_live();
         }
-        ADCIntClear(ADC0_BASE, 1);
-        ADCProcessorTrigger(ADC0_BASE, 1);
-        while (!ADCIntStatus(ADC0_BASE, 1, false))
+    }
+    else
+    {
+        console_printf("usage: remote [on|off]\r\n");
+    }
+}
+
+static const console_cmd_t remoteCmd = { "remote", "ground station input: on|off", cmd_remote };
+
+/*
+ *  Set up the sampling clock, the ADC interrupt and the task for the Joystick controller.
+ *  Sampling has the shortest period and therefore the highest task priority.
+ */
+void setUpJoyStick_Task(void)
+{
+    Semaphore_Params semParams;
+    Semaphore_Params_init(&semParams);
+    semParams.mode = Semaphore_Mode_BINARY;
+    Semaphore_construct(&sampleTickSem, 0, &semParams);
+    Semaphore_construct(&adcDoneSem, 0, &semParams);
+
+    Hwi_Params hwiParams;
+    Hwi_Params_init(&hwiParams);
+    Hwi_construct(&adcHwi, INT_ADC0SS1, adc_hwi, &hwiParams, NULL);
+
+    Clock_Params clockParams;
+    Clock_Params_init(&clockParams);
+    clockParams.period = config->loopPeriodMs;
+    clockParams.startFlag = TRUE;
+    Clock_construct(&sampleClock, sample_tick, config->loopPeriodMs, &clockParams);
+
+    Task_Params taskParams;
+    Task_Params_init(&taskParams);
+    taskParams.stack = &joystickTaskStack;
+    taskParams.stackSize = sizeof(joystickTaskStack);
+    taskParams.priority = TASK_PRIO_SAMPLING;
+    taskParams.arg0 = (UArg) 1;
+    Task_construct(&joystickTaskStruct, (Task_FuncPtr) joystick_fnx, &taskParams, NULL);
+
+    sysmon_registerTask(Task_handle(&joystickTaskStruct), "sampling");
+
+    replay_init(&inputRing, inputBuffer, sizeof(inputBuffer));
+    console_addCommand(&replayCmd);
+    console_addCommand(&remoteCmd);
+}
+
+/*
+ *  Average of JS_CAL_CENTER_SAMPLES readings with the stick released.
+ */
+static void calibrate_center(cfg_stick_cal_t *cal)
+{
+    uint32_t sum[CFG_AXIS_COUNT] = { 0, 0 };
+    uint8_t i;
+
+    for(i = 0; i < JS_CAL_CENTER_SAMPLES; i++)
+    {
+        read_adc();
+        sum[CFG_AXIS_ROLL] += adcSamples[1];
+        sum[CFG_AXIS_PITCH] += adcSamples[0];
+        Task_sleep(JS_CAL_SAMPLE_MS);
+    }
+    for(i = 0; i < CFG_AXIS_COUNT; i++)
+    {
+        cal->axis[i].center = sum[i] / JS_CAL_CENTER_SAMPLES;
+        cal->axis[i].min = cal->axis[i].center;
+        cal->axis[i].max = cal->axis[i].center;
+    }
+}
+
+/*
+ *  Track min/max of both axes until the pilot presses select or JS_CAL_RANGE_TIMEOUT_MS passed.
+ */
+static void calibrate_range(cfg_stick_cal_t *cal)
+{
+    uint32_t start;
+    uint16_t raw[CFG_AXIS_COUNT];
+    uint8_t i;
+
+    while(!joystick_enterMenu())
+    {
+        Task_sleep(JS_CAL_SAMPLE_MS); //the copter selection of the scan comes first
+    }
+    start = Clock_getTicks();
+    while(!(joystick_takeButtons() & JS_BTN_SELECT) && (Clock_getTicks() - start) < JS_CAL_RANGE_TIMEOUT_MS)
+    {
+        read_adc();
+        raw[CFG_AXIS_ROLL] = adcSamples[1];
+        raw[CFG_AXIS_PITCH] = adcSamples[0];
+        for(i = 0; i < CFG_AXIS_COUNT; i++)
         {
+            if(raw[i] < cal->axis[i].min)
+            {
+                cal->axis[i].min = raw[i];
+            }
+            if(raw[i] > cal->axis[i].max)
+            {
+                cal->axis[i].max = raw[i];
+            }
         }
-        ADCSequenceDataGet(ADC0_BASE, 1, adcSamples);
+        Task_sleep(JS_CAL_SAMPLE_MS);
+    }
+    joystick_leaveMenu();
+}
 
-        roll = (adcSamples[1] + offsetRoll) / 4  + 1000; //scale and limit adc roll value
-        if(roll < 1000)
+/*
+ *  Calibration mode: center, then endpoints. The scale factors are computed once here and stored.
+ *  A range that is too small (stick not moved) keeps the uncalibrated scale for this boot only.
+ */
+static void calibrate(cfg_stick_cal_t *cal)
+{
+    uint8_t i;
+
+    System_printf("Stick calibration: release the stick\n");
+    System_flush();
+    calibrate_center(cal);
+
+    System_printf("Stick calibration: move the stick to all ends, then press select\n");
+    System_flush();
+    calibrate_range(cal);
+
+    cal->valid = 1;
+    for(i = 0; i < CFG_AXIS_COUNT; i++)
+    {
+        cfg_axis_cal_t *axis = &cal->axis[i];
+        if(axis->max - axis->center < JS_CAL_MIN_SPAN || axis->center - axis->min < JS_CAL_MIN_SPAN)
         {
-            roll = 1000;
+            axis->scaleLow = JS_SCALE_UNCALIBRATED;
+            axis->scaleHigh = JS_SCALE_UNCALIBRATED;
+            cal->valid = 0;
+            continue;
         }
-        if(roll > 2000)
+        axis->scaleLow = ((uint32_t)JS_HALF_RANGE << JS_SCALE_SHIFT) / (axis->center - axis->min);
+        axis->scaleHigh = ((uint32_t)JS_HALF_RANGE << JS_SCALE_SHIFT) / (axis->max - axis->center);
+    }
+
+    System_printf("Stick calibration %s: roll %u/%u/%u, pitch %u/%u/%u\n", cal->valid ? "done" : "incomplete, not stored",
+                  cal->axis[CFG_AXIS_ROLL].min, cal->axis[CFG_AXIS_ROLL].center, cal->axis[CFG_AXIS_ROLL].max,
+                  cal->axis[CFG_AXIS_PITCH].min, cal->axis[CFG_AXIS_PITCH].center, cal->axis[CFG_AXIS_PITCH].max);
+    System_flush();
+    while(!config_ready())
+    {
+        Task_sleep(JS_CAL_SAMPLE_MS);
+    }
+    if(cal->valid && !config_set(CFG_KEY_STICK_CAL, cal))
+    {
+        System_printf("Stick calibration not stored\n");
+        System_flush();
+    }
+}
+
+/*
+ *  Combine calibration, rate and expo of every axis into the map used per sample.
+ */
+static void update_map(const cfg_stick_cal_t *cal, const config_t *c)
+{
+    uint8_t i;
+
+    for(i = 0; i < CFG_AXIS_COUNT; i++)
+    {
+        axisMap[i].center = cal->axis[i].center;
+        axisMap[i].scaleLow = cal->axis[i].scaleLow * c->rates[i].rate / 100;
+        axisMap[i].scaleHigh = cal->axis[i].scaleHigh * c->rates[i].rate / 100;
+        axisMap[i].expo = ((uint32_t)c->rates[i].expo << 8) / 100;
+    }
+}
+
+/*
+ *  Expo: blend of the linear and the cubic curve, softer around the center.
+ *  cubic = delta^3 / 500^2, the factor 268 / 2^26 replaces the division.
+ */
+static RAMFUNC uint32_t apply_expo(uint32_t delta, uint32_t expo)
+{
+    uint32_t cubic = ((((delta * delta) >> 8) * delta) * 268) >> 18;
+
+    if(cubic > delta)
+    {
+        cubic = delta;
+    }
+    return delta - (((delta - cubic) * expo) >> 8);
+}
+
+/*
+ *  Map one raw value to 1000-2000, only multiplications and shifts per sample.
+ */
+static RAMFUNC uint16_t map_axis(const js_axis_map_t *map, uint32_t raw)
+{
+    uint32_t delta;
+    bool low = raw < map->center;
+
+    if(low)
+    {
+        delta = ((map->center - raw) * map->scaleLow) >> JS_SCALE_SHIFT;
+    }
+    else
+    {
+        delta = ((raw - map->center) * map->scaleHigh) >> JS_SCALE_SHIFT;
+    }
+    if(delta > JS_HALF_RANGE)
+    {
+        delta = JS_HALF_RANGE;
+    }
+    delta = apply_expo(delta, map->expo);
+    return low ? 1500 - delta : 1500 + delta;
+}
+
+/*
+ *  Roll mapping of one raw value for the ramfunc benchmark (ramfunc.c), the hot path itself.
+ */
+RAMFUNC uint16_t joystick_benchMap(uint32_t raw)
+{
+    return map_axis(&axisMap[CFG_AXIS_ROLL], raw);
+}
+
+/*
+ *  Low pass of one axis, the new value is weighted with 1/2^shift.
+ */
+static RAMFUNC uint16_t filter_axis(int32_t *state, uint16_t value, uint8_t shift)
+{
+    *state += ((int32_t)value - *state) >> shift;
+    return *state;
+}
+
+/*
+ *  A new profile was published: rebuild the map and adjust the sampling period.
+ */
+static void apply_config(cfg_stick_cal_t *cal, const config_t *c)
+{
+    if(c->stickCal.valid)
+    {
+        *cal = c->stickCal;
+    }
+    update_map(cal, c);
+    if(Clock_getPeriod(Clock_handle(&sampleClock)) != c->loopPeriodMs)
+    {
+        Clock_stop(Clock_handle(&sampleClock));
+        Clock_setPeriod(Clock_handle(&sampleClock), c->loopPeriodMs);
+        Clock_setTimeout(Clock_handle(&sampleClock), c->loopPeriodMs);
+        Clock_start(Clock_handle(&sampleClock));
+    }
+    deadline_setPeriod(c->loopPeriodMs);
+}
+
+/*
+ *  Deviation of the sample start from the loop period in us.
+ */
+static void observe_jitter(uint16_t periodMs)
+{
+    static uint32_t last = 0;
+    Types_FreqHz freq;
+    uint32_t now = Timestamp_get32();
+    uint32_t elapsedUs;
+    uint32_t periodUs = periodMs * 1000;
+
+    Timestamp_getFreq(&freq);
+    elapsedUs = (now - last) / (freq.lo / 1000000);
+    if(last != 0)
+    {
+        metrics_observe(MET_HIST_JITTER_US, (elapsedUs > periodUs) ? elapsedUs - periodUs : periodUs - elapsedUs);
+    }
+    metrics_inc(MET_SAMPLES);
+    last = now;
+}
+
+/*
+ *  This is the joystick (sampling) RTOS task, used for processing joystick and button data.
+ *  Map the ADC values to the range of 1000-2000 and publish them together with
+ *  throttle and arming state to the control task.
+ */
+void joystick_fnx(UArg arg0)
+{
+    static cfg_stick_cal_t cal;
+    static int32_t filterState[CFG_AXIS_COUNT] = { 1500, 1500 };
+    const config_t *active;
+    bb_sticks_t sticks;
+    uint16_t roll;
+    uint16_t pitch;
+
+    throttle = 1000;
+
+    //highest priority task -> runs first after BIOS_start
+    sysmon_bootMark(BOOT_BIOS_START);
+
+    //normal boots use the stored calibration and skip the calibration mode
+    cal = config->stickCal;
+    if(!cal.valid || GPIO_read(JS_UP) == 0)
+    {
+        calibrate(&cal);
+    }
+    active = config;
+    apply_config(&cal, active);
+    sysmon_bootMark(BOOT_ADC_CALIBRATED);
+
+    while (1)
+    {
+        Semaphore_pend(Semaphore_handle(&sampleTickSem), BIOS_WAIT_FOREVER);
+        deadline_checkIn(DL_SAMPLING);
+        samplePending = false;
+        observe_jitter(active->loopPeriodMs);
+        if(config != active)
         {
-            roll = 2000;
+            active = config;
+            apply_config(&cal, active);
         }
+        read_input();
 
-        pitch = (adcSamples[0] + offsetPitch) / 4  + 1000; //scale and limit adc pitch value
-        if(pitch < 1000)
+        if(inputMode == JS_INPUT_REMOTE)
+        {
+            //already mapped by the ground station, checked again as a button may just have ended it
+            UInt key = Hwi_disable();
+            if(inputMode == JS_INPUT_REMOTE)
+            {
+                roll = remoteInput.roll;
+                pitch = remoteInput.pitch;
+                throttle = remoteInput.throttle;
+                isArmed = remoteInput.armed;
+            }
+            Hwi_restore(key);
+        }
+        else
         {
-            pitch = 1000;
+            roll = map_axis(&axisMap[CFG_AXIS_ROLL], adcSamples[1]);
+            pitch = map_axis(&axisMap[CFG_AXIS_PITCH], adcSamples[0]);
         }
-        if(pitch > 2000)
+        if(active->filterShift > 0)
         {
-            pitch = 2000;
+            roll = filter_axis(&filterState[CFG_AXIS_ROLL], roll, active->filterShift);
+            pitch = filter_axis(&filterState[CFG_AXIS_PITCH], pitch, active->filterShift);
         }
 
-        send_controls(roll,pitch,throttle,isArmed); //send adc and button data to bluetooth.c
+        UInt key = Hwi_disable();
+        latestSample.rawPitch = adcSamples[0];
+        latestSample.rawRoll = adcSamples[1];
+        latestSample.roll = roll;
+        latestSample.pitch = pitch;
+        latestSample.throttle = throttle;
+        latestSample.armed = isArmed;
+        latestSample.timestamp = Clock_getTicks();
+        Hwi_restore(key);
+
+        sticks.rawRoll = adcSamples[1];
+        sticks.rawPitch = adcSamples[0];
+        sticks.roll = roll;
+        sticks.pitch = pitch;
+        sticks.throttle = throttle;
+        sticks.armed = isArmed;
+        sticks.reserved = 0;
+        blackbox_log(BB_STICKS, &sticks, sizeof(sticks));
+        usbcdc_send(BB_STICKS, &sticks, sizeof(sticks));
+        udp_publish(BB_STICKS, &sticks, sizeof(sticks));
+
+        control_post(CONTROL_EVT_SAMPLE); //wake up the control task
     }
 }
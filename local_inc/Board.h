@@ -39,6 +39,7 @@ extern "C" {
 
 #include "EK_TM4C1294XL.h"
 
+#define Board_initDMA               EK_TM4C1294XL_initDMA
 #define Board_initEMAC              EK_TM4C1294XL_initEMAC
 #define Board_initGeneral           EK_TM4C1294XL_initGeneral
 #define Board_initGPIO              EK_TM4C1294XL_initGPIO
@@ -72,7 +73,6 @@ extern "C" {
 #define Board_I2C_TPL0401           EK_TM4C1294XL_I2C7
 
 #define Board_SDSPI0                EK_TM4C1294XL_SDSPI0
-#define Board_SDSPI1                EK_TM4C1294XL_SDSPI1
 
 #define Board_SPI0                  EK_TM4C1294XL_SPI2
 #define Board_SPI1                  EK_TM4C1294XL_SPI3
@@ -87,6 +87,7 @@ extern "C" {
 #define Board_UART1                 EK_TM4C1294XL_UART1
 #define Board_UART2                 EK_TM4C1294XL_UART2
 #define Board_UART6                 EK_TM4C1294XL_UART6
+#define Board_UART7                 EK_TM4C1294XL_UART7
 #define Board_UART3                 EK_TM4C1294XL_UART7
 
 #define Board_WATCHDOG0             EK_TM4C1294XL_WATCHDOG0
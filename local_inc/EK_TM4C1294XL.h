@@ -58,6 +58,7 @@ extern "C" {
 #define I2CM_8 1
 
 /*spi configguration*/
+//SSI2 is driven by SDSPI0 (blackbox) and the LCD (display.c), both without the SPI driver
 //#define SSIM_2 1
 //#define SSIM_3 1
 
@@ -131,8 +132,7 @@ typedef enum EK_TM4C1294XL_PWMName {
  *  @brief  Enum of SDSPI names on the EK_TM4C1294XL dev board
  */
 typedef enum EK_TM4C1294XL_SDSPIName {
-    EK_TM4C1294XL_SDSPI0 = 0,
-    EK_TM4C1294XL_SDSPI1,
+    EK_TM4C1294XL_SDSPI0 = 0,   //blackbox, SDSPI1 (SSI3) is left out: its pins belong to the bluetooth module
 
     EK_TM4C1294XL_SDSPICOUNT
 } EK_TM4C1294XL_SDSPIName;
@@ -159,6 +159,7 @@ typedef enum EK_TM4C1294XL_SPIName {
 typedef enum EK_TM4C1294XL_UARTName {
     EK_TM4C1294XL_UART0 = 0,
     EK_TM4C1294XL_UART6,
+    EK_TM4C1294XL_UART7,
     EK_TM4C1294XL_UARTCOUNT
 } EK_TM4C1294XL_UARTName;
 
@@ -278,6 +279,14 @@ extern void EK_TM4C1294XL_initSDSPI(void);
  */
 extern void EK_TM4C1294XL_initSPI(void);
 
+/*!
+ *  @brief  Initialize the uDMA controller and its control table
+ *
+ *  The drivers that use DMA call this function themselves, modules that
+ *  program uDMA channels directly must call it before.
+ */
+extern void EK_TM4C1294XL_initDMA(void);
+
 /*!
  *  @brief  Initialize board specific UART settings
  *
@@ -0,0 +1,83 @@
+/*
+ * blackbox.h
+ *
+ *  Created on: 19.10.2026
+ */
+
+#ifndef LOCAL_INC_BLACKBOX_H_
+#define LOCAL_INC_BLACKBOX_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include <Board.h>
+
+#define BB_SDSPI            Board_SDSPI0    //SSI2 on BoosterPack 1, CS on PH2, shared with the LCD
+#define BB_DRIVE            0               //FatFS drive number
+#define BB_BLOCK_SIZE       4096            //RAM block, written to the card in one piece (8 sectors)
+#define BB_MAX_PAYLOAD      64
+#define BB_LINK_PERIOD_MS   1000            //link metrics record
+#define BB_TELEMETRY_MAX    32              //received bytes collected per record
+#define BB_VERSION          1
+
+//record types, every record starts with bb_header_t
+typedef enum bb_type_t {
+    BB_PAD = 0,         //rest of the block is unused
+    BB_START,           //bb_start_t, first record of a file
+    BB_SYNC,            //bb_sync_t, first record of every further block
+    BB_STICKS,          //bb_sticks_t, every sample
+    BB_FRAME,           //packet as sent to the module
+    BB_TELEMETRY,       //bytes received from the copter in data mode
+    BB_LINK             //bb_link_t, every BB_LINK_PERIOD_MS
+} bb_type_t;
+
+//all values little endian, no padding between records
+typedef struct bb_header_t {
+    uint8_t type;
+    uint8_t size;       //payload bytes behind the header
+    uint16_t time;      //Clock ticks (ms), low 16 bits, the full tick is in BB_START/BB_SYNC
+} bb_header_t;
+
+typedef struct bb_start_t {
+    uint32_t magic;     //BB_MAGIC
+    uint16_t version;
+    uint16_t blockSize;
+    uint32_t tick;
+    uint16_t loopPeriodMs;
+    uint16_t reserved;
+} bb_start_t;
+#define BB_MAGIC    0x31584242  //"BBX1"
+
+typedef struct bb_sync_t {
+    uint32_t tick;
+    uint32_t dropped;   //records dropped so far because both blocks were full
+} bb_sync_t;
+
+typedef struct bb_sticks_t {
+    uint16_t rawRoll;
+    uint16_t rawPitch;
+    uint16_t roll;
+    uint16_t pitch;
+    uint16_t throttle;
+    uint8_t armed;
+    uint8_t reserved;
+} bb_sticks_t;
+
+typedef struct bb_link_t {
+    uint32_t linkUp;
+    uint32_t framesSent;
+    uint32_t txDropped;
+    uint32_t rtsStalls;
+    uint32_t rxBytes;
+    uint32_t reconnects;
+    uint32_t deadlineMisses;
+    uint32_t cpuLoad;
+} bb_link_t;
+
+extern void blackbox_log(bb_type_t type, const void *data, uint8_t size);
+extern void blackbox_linkRecord(bb_link_t *link);
+extern void blackbox_lockBus(void);
+extern void blackbox_unlockBus(void);
+extern void setUpBlackbox_Task(void);
+
+#endif /* LOCAL_INC_BLACKBOX_H_ */
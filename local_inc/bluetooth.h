@@ -8,7 +8,98 @@
 #ifndef BLUETOOTH_H_
 #define BLUETOOTH_H_
 
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#define MSP_RC_FRAME_SIZE   16  //MSP_SET_RAW_RC frame with 5 channels
+
+//power up sequence of the RN4871 in ms
+#define BT_WAKE_SETTLE_MS       500 //as the original init sequence, no shorter value is specified
+#define BT_RESET_PULSE_MS       1   //module needs at least 63ns
+#define BT_RESET_SETTLE_MS      100
+#define BT_POWER_ON_MS          500
+#define BT_STARTUP_TIMEOUT_MS   2000 //max. time for the status pins after power on
+
+#define BT_BAUD_DEFAULT         115200  //factory setting of the RN4871
+
+//link layer packing: the transparent UART service forwards the byte stream in notifications
+//of (ATT MTU - 3) bytes, a frame crossing a notification boundary needs one more connection event
+#define BT_PAYLOAD_DEFAULT      20      //default ATT MTU of 23
+#define BT_PAYLOAD_MAX          64      //largest packet the TX task builds
+#define BT_FLUSH_GAP_MS         1       //UART idle time after which the module sends a partial notification
+#define BT_TX_QUEUE_SIZE        4       //additional MSP frames waiting for the next packet
+#define BT_EVENT_HIST_SIZE      4       //frames per radio event: 1, 2, 3, more
+#define BT_TX_TIMEOUT_MS        20      //longest wait for RTS or the FIFO, the packet is given up after it
+
+typedef struct bt_tx_stats_t {
+    uint32_t packets;       //notifications sent
+    uint32_t frames;        //MSP frames sent
+    uint32_t splitFrames;   //frames larger than one notification
+    uint32_t dropped;       //queued frames dropped because the queue was full
+    uint32_t framesPerEvent[BT_EVENT_HIST_SIZE];    //estimated from the connection interval
+} bt_tx_stats_t;
+
+//copter links: every link is a session of its own (UART, TX task, RX task, queues, statistics)
+#define BT_LINK_COUNT       2
+#define BT_LINK_MODULE      0       //RN4871 on UART6, powered up and connected by connection.c
+#define BT_LINK_AUX         1       //transparent module on UART7 without flow control, in data mode once open
+#define BT_ROUTE_ALL        0xFF    //controls and MSP frames go to every ready link
+#define BT_AUX_BAUD         115200
+#define BT_AUX_PROBE_MS     500     //aux link: MSP_STATUS is requested after this long without a byte
+#define BT_AUX_SILENT_MS    2000    //aux link: down after this long without a byte of the copter
+
+typedef struct bt_link_t bt_link_t;
+
+typedef struct bt_link_stats_t {
+    bt_tx_stats_t tx;
+    uint32_t txErrors;      //failed UART writes
+    uint32_t rtsStalls;     //packets that waited for RTS of the module
+    uint32_t txTimeouts;    //packets given up after BT_TX_TIMEOUT_MS of RTS or a full FIFO
+    uint32_t rxBytes;
+    uint32_t rxErrors;      //failed UART reads
+} bt_link_stats_t;
+
+//responses of the module in command mode
+#define BT_LINE_SIZE    96  //longest line incl. '\0' (scan result with a 128-bit UUID), longer lines are split
+#define BT_LINE_COUNT   4   //lines buffered for the reader
+
+typedef struct bt_line_t {
+    char text[BT_LINE_SIZE];
+} bt_line_t;
+
+bt_link_t *bt_getLink(uint8_t index);
+const char *bt_linkName(const bt_link_t *link);
+void bt_setReady(bt_link_t *link, bool ready);
+bool bt_isReady(const bt_link_t *link);
+void bt_setRoute(uint8_t route);
+uint8_t bt_getRoute(void);
+bool bt_routeReady(void);
+
 void send_controls(uint16_t roll, uint16_t pitch, uint16_t throttle, bool armed);
+void send_data(bt_link_t *link, char *data, size_t size);
+bool bt_queueFrame(const char *frame, uint8_t size);
+bool bt_sendFailsafe(void);
+bool bt_linkFailsafe(bt_link_t *link);
+void bt_benchFrame(char *payload, uint16_t roll, uint16_t pitch);
+void bt_setRelay(bt_link_t *link, bool on);
+bool bt_isDataMode(const bt_link_t *link);
+bool bt_txReady(const bt_link_t *link);
+uint32_t bt_uartBase(const bt_link_t *link);
+void bt_setPayloadSize(bt_link_t *link, uint8_t size);
+void bt_getStats(bt_link_t *link, bt_link_stats_t *stats);
+void bt_reportTx(void);
+
+void bt_sendCommand(bt_link_t *link, const char *cmd);
+bool bt_openUart(bt_link_t *link);
+void bt_setDataMode(bt_link_t *link, bool dataMode);
+void bt_setBaudRate(bt_link_t *link, uint32_t newBaudRate);
+uint32_t bt_getBaudRate(const bt_link_t *link);
+bool bt_readLine(bt_link_t *link, bt_line_t *line);
+bool bt_lineAvailable(const bt_link_t *link);
+void bt_flushLines(bt_link_t *link);
+bool bt_module_started(const bt_link_t *link);
+bool bt_link_connected(const bt_link_t *link);
 
 int setup_UART();
 
@@ -0,0 +1,60 @@
+/*
+ * btcmd.h
+ *
+ *  Created on: 19.10.2026
+ *
+ *  Command channel to the RN4871 in command mode.
+ *  Commands are queued and up to BTCMD_PIPELINE_DEPTH of them are sent back to back,
+ *  the module answers them in order. Every response line is matched against the oldest
+ *  outstanding command:
+ *    - starts with cmd->expect     -> BTCMD_OK
+ *    - starts with "ERR" / "%ERR"  -> BTCMD_FAIL (also "%DISCONNECT" while a command waits for it)
+ *    - anything else               -> unsolicited, handed to the event handler (e.g. "Trying", "%STREAM_OPEN%")
+ *  The timeout of a command starts when it becomes the oldest outstanding command.
+ *
+ *  The channel runs as a job of the housekeeping executor, btcmd_* must only be called from
+ *  executor jobs. btcmd_t objects are owned by the caller and must stay valid until done.
+ */
+
+#ifndef LOCAL_INC_BTCMD_H_
+#define LOCAL_INC_BTCMD_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include <bluetooth.h>
+
+#define BTCMD_PIPELINE_DEPTH    4
+
+//status of a command
+#define BTCMD_IDLE      0   //not submitted yet
+#define BTCMD_QUEUED    1   //waits for a free pipeline slot
+#define BTCMD_SENT      2   //waits for the response
+#define BTCMD_OK        3
+#define BTCMD_FAIL      4   //module answered with an error
+#define BTCMD_TIMEOUT   5   //no response within timeoutMs
+#define BTCMD_ABORTED   6   //flushed, e.g. because an earlier command timed out
+
+typedef struct btcmd_t btcmd_t;
+
+struct btcmd_t {
+    const char *cmd;        //complete command incl. '\r', NULL only waits for the response'
+    const char *expect;     //prefix of the success response, e.g. "AOK"
+    uint16_t timeoutMs;
+    bt_line_t *response;    //optional, receives the matching response line
+    volatile uint8_t status;
+    uint32_t deadline;      //internal
+    btcmd_t *next;          //internal
+};
+
+//handler for lines that do not answer a command
+typedef void (*btcmd_event_fnx_t)(const char *line);
+
+extern bool btcmd_submit(btcmd_t *cmd);
+extern bool btcmd_done(const btcmd_t *cmd);
+extern bool btcmd_idle(void);
+extern void btcmd_flush(void);
+extern void btcmd_setEventHandler(btcmd_event_fnx_t fnx);
+extern void btcmd_start(void);
+
+#endif /* LOCAL_INC_BTCMD_H_ */
@@ -0,0 +1,96 @@
+/*
+ * config.h
+ *
+ *  Created on: 19.10.2026
+ */
+
+#ifndef LOCAL_INC_CONFIG_H_
+#define LOCAL_INC_CONFIG_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+//EEPROM layout: CFG_SLOT_COUNT slots, every commit writes the whole profile into the next slot
+#define CFG_EEPROM_BASE     0x0000  //byte address, word aligned
+#define CFG_SLOT_SIZE       128     //bytes, multiple of 4
+#define CFG_SLOT_COUNT      16      //rotation spreads the wear over all slots
+#define CFG_MAGIC           0x31474643  //"CFG1"
+#define CFG_VERSION         1       //increment when the meaning of an existing key changes
+
+//a replaced profile may still be read for this time, its buffer is reused afterwards at the earliest
+#define CFG_SWAP_GRACE_MS   200
+
+#define CFG_MAC_LEN         12
+#define CFG_NAME_LEN        12
+
+//keys of the stored values, never reuse a removed key
+typedef enum cfg_key_t {
+    CFG_KEY_COPTER = 1,         //cfg_copter_t
+    CFG_KEY_THROTTLE_STEP,      //uint16_t
+    CFG_KEY_STICK_CAL,          //cfg_stick_cal_t
+    CFG_KEY_RATES,              //cfg_rate_t[CFG_AXIS_COUNT]
+    CFG_KEY_BAUD_RATE,          //uint32_t
+    CFG_KEY_LOOP_PERIOD,        //uint16_t
+    CFG_KEY_FILTER,             //uint8_t
+    CFG_KEY_TX_KEEPALIVE,       //uint8_t
+    CFG_KEY_COUNT
+} cfg_key_t;
+
+typedef enum cfg_axis_t {
+    CFG_AXIS_ROLL = 0,
+    CFG_AXIS_PITCH,
+    CFG_AXIS_COUNT
+} cfg_axis_t;
+
+//copter selected by the pilot (scan.c)
+typedef struct cfg_copter_t {
+    char mac[CFG_MAC_LEN + 1];  //empty if none is cached
+    uint8_t addrType;
+    char name[CFG_NAME_LEN + 1];
+} cfg_copter_t;
+
+//raw ADC values of one stick axis and the scale factors derived from them
+typedef struct cfg_axis_cal_t {
+    uint16_t min;
+    uint16_t center;
+    uint16_t max;
+    uint32_t scaleLow;      //output per raw count below the center, fixed point (JS_SCALE_SHIFT)
+    uint32_t scaleHigh;     //output per raw count above the center
+} cfg_axis_cal_t;
+
+typedef struct cfg_stick_cal_t {
+    cfg_axis_cal_t axis[CFG_AXIS_COUNT];
+    uint8_t valid;
+} cfg_stick_cal_t;
+
+//rate curve of one axis in percent: rate scales the full deflection, expo softens the center
+typedef struct cfg_rate_t {
+    uint8_t rate;
+    uint8_t expo;
+} cfg_rate_t;
+
+//complete profile, the RAM cache holds one of it
+typedef struct config_t {
+    cfg_copter_t copter;
+    uint16_t throttleStep;
+    cfg_stick_cal_t stickCal;
+    cfg_rate_t rates[CFG_AXIS_COUNT];
+    uint32_t baudRate;
+    uint16_t loopPeriodMs;      //sampling period
+    uint8_t filterShift;        //stick low pass: 0 = off, n = new value weighted 1/2^n
+    uint8_t txKeepalive;        //0 = send every sample, n = send changes and every n-th sample
+} config_t;
+
+//current profile, double buffered: publishing fills the other buffer and swaps the pointer
+//reader contract: take the pointer once per cycle (const config_t *c = config;), use it only within
+//that cycle and never keep it across a blocking call or longer than CFG_SWAP_GRACE_MS
+extern const config_t * volatile config;
+
+extern void config_init(void);
+extern void config_defaults(config_t *profile);
+extern bool config_ready(void);
+extern bool config_publish(const config_t *profile);
+extern bool config_commit(const config_t *profile);
+extern bool config_set(cfg_key_t key, const void *value);
+
+#endif /* LOCAL_INC_CONFIG_H_ */
@@ -0,0 +1,66 @@
+/*
+ * connection.h
+ *
+ *  Created on: 19.10.2026
+ */
+
+#ifndef LOCAL_INC_CONNECTION_H_
+#define LOCAL_INC_CONNECTION_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+//timeouts of the single connection steps in ms
+#define CONN_CMD_TIMEOUT_MS         500     //"$$$" -> "CMD>"
+#define CONN_CONNECT_TIMEOUT_MS     5000    //"C,<type>,<mac>" -> "%CONNECT..."
+#define CONN_STATUS_TIMEOUT_MS      1000    //status pins show the connection
+#define CONN_DATA_TIMEOUT_MS        500     //"---" -> "END"
+#define CONN_SETUP_TIMEOUT_MS       200     //configuration commands -> "AOK"
+
+//UART6 baud rate upgrade in command mode, the module keeps its rate ("SB") across power cycles
+#define CONN_BAUD_MAX               460800  //highest rate that is negotiated
+#define CONN_REBOOT_TIMEOUT_MS      2000    //"R,1" -> "%REBOOT%"
+
+//reconnect with exponential backoff, the first attempt after a link loss starts immediately
+#define CONN_BACKOFF_MIN_MS         20
+#define CONN_BACKOFF_MAX_MS         2000
+#define CONN_ATTEMPTS_BEFORE_RESET  5       //the module is reset after this many failed attempts in a row
+#define CONN_RESETS_BEFORE_SCAN     2       //the cached copter is given up after this many module resets
+
+//link loss detection via the status pins
+#define CONN_POLL_MS                10
+#define CONN_LOST_POLLS             3       //debounce: consecutive polls without connection
+
+//BLE connection parameters in the units of the RN4871 "T" command
+typedef struct conn_params_t {
+    uint16_t intervalMin;   //1.25 ms units
+    uint16_t intervalMax;   //1.25 ms units, the negotiated interval is reported here
+    uint16_t latency;       //connection events the copter may skip
+    uint16_t timeout;       //supervision timeout, 10 ms units
+} conn_params_t;
+
+//connection parameter profiles
+typedef enum conn_profile_t {
+    CONN_PROFILE_FLIGHT = 0,    //shortest interval, no latency, fast link loss detection
+    CONN_PROFILE_IDLE,          //long interval with slave latency, saves power on the ground
+    CONN_PROFILE_COUNT
+} conn_profile_t;
+
+#define CONN_PARAM_TIMEOUT_MS       2000    //"T,..." -> "%CONN_PARAM,...%"
+
+typedef struct conn_stats_t {
+    uint32_t attempts;      //connection attempts
+    uint32_t connects;      //successful attempts
+    uint32_t linkLosses;
+    uint32_t moduleResets;
+    uint32_t lastConnectMs; //duration of the last successful attempt ("$$$" until data mode)
+    uint32_t lastOffAirMs;  //link loss until link up again, last reconnect
+    uint32_t maxOffAirMs;   //worst reconnect since boot
+} conn_stats_t;
+
+extern void conn_start(void);
+extern void conn_getStats(conn_stats_t *stats);
+extern void conn_requestProfile(conn_profile_t profile);
+extern bool conn_getParams(conn_params_t *params);
+
+#endif /* LOCAL_INC_CONNECTION_H_ */
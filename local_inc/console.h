@@ -0,0 +1,31 @@
+/*
+ * console.h
+ *
+ *  Created on: 19.10.2026
+ */
+
+#ifndef LOCAL_INC_CONSOLE_H_
+#define LOCAL_INC_CONSOLE_H_
+
+#include <stdint.h>
+
+#define CONSOLE_BAUD        115200
+#define CONSOLE_LINE_SIZE   64
+#define CONSOLE_MAX_ARGS    4
+#define CONSOLE_MAX_COMMANDS 12 //commands other modules add with console_addCommand
+
+//command of the console, fnx runs in the console task
+typedef struct console_cmd_t {
+    const char *name;
+    const char *help;
+    void (*fnx)(uint8_t argc, char *argv[]);
+} console_cmd_t;
+
+extern void console_addCommand(const console_cmd_t *cmd);
+extern void console_printf(const char *format, ...);
+extern void console_write(const void *data, uint32_t size);
+extern void console_suspend(void);
+extern bool console_resume(void);
+extern void setUpConsole_Task(void);
+
+#endif /* LOCAL_INC_CONSOLE_H_ */
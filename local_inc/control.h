@@ -0,0 +1,21 @@
+/*
+ * control.h
+ *
+ *  Created on: 19.10.2026
+ */
+
+#ifndef LOCAL_INC_CONTROL_H_
+#define LOCAL_INC_CONTROL_H_
+
+#include <xdc/std.h>
+#include <ti/sysbios/knl/Event.h>
+
+//events the control task is waiting for
+#define CONTROL_EVT_SAMPLE      Event_Id_00 //new joystick sample available
+#define CONTROL_EVT_LINK_UP     Event_Id_01 //a copter is connected and ready for controls, or the route changed
+#define CONTROL_EVT_LINK_DOWN   Event_Id_02 //connection to a copter is lost
+
+extern void control_post(UInt events);
+extern void setUpControl_Task(void);
+
+#endif /* LOCAL_INC_CONTROL_H_ */
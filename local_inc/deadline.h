@@ -0,0 +1,31 @@
+/*
+ * deadline.h
+ *
+ *  Created on: 19.10.2026
+ */
+
+#ifndef LOCAL_INC_DEADLINE_H_
+#define LOCAL_INC_DEADLINE_H_
+
+#include <stdint.h>
+
+#define DEADLINE_CHECK_MS       10      //period of the monitor (Clock function)
+#define DEADLINE_PERIOD_FACTOR  3       //periodic tasks: missed after this many sampling periods without check-in
+#define DEADLINE_TX_MS          200     //link TX: longest time for one packet incl. RTS stalls
+#define DEADLINE_WDT_MS         500     //watchdog period, it resets after the second timeout
+
+//monitored tasks, all of them are critical: one miss stops feeding the watchdog
+typedef enum deadline_id_t {
+    DL_SAMPLING = 0,    //periodic, every sampling period (deadline_setPeriod)
+    DL_CONTROL,         //periodic, woken by every sample
+    DL_LINK_TX,         //event driven, monitored between deadline_checkIn and deadline_idle
+    DL_LINK_AUX_TX,     //TX task of the second link (BT_LINK_AUX), event driven as well
+    DL_COUNT
+} deadline_id_t;
+
+extern void deadline_checkIn(deadline_id_t id);
+extern void deadline_idle(deadline_id_t id);
+extern void deadline_setPeriod(uint16_t ms);
+extern void deadline_start(void);
+
+#endif /* LOCAL_INC_DEADLINE_H_ */
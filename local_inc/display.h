@@ -0,0 +1,54 @@
+/*
+ * display.h
+ *
+ *  Created on: 19.10.2026
+ */
+
+#ifndef LOCAL_INC_DISPLAY_H_
+#define LOCAL_INC_DISPLAY_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+//Crystalfontz CFAF128128B-0145T (ST7735S) of the EDUMKII on BoosterPack 1
+//SSI2: SCK PD3, MOSI PD1 (pins set up by Board_initSDSPI), shared with the SD card of the blackbox
+#define DISPLAY_SSI_BASE    SSI2_BASE
+#define DISPLAY_SSI_INT     INT_SSI2
+#define DISPLAY_SPI_BITRATE 12500000    //same as the SD card after its init, the ST7735S allows 15 MHz
+#define DISPLAY_DMA_CHANNEL 13          //SSI2 TX
+#define DISPLAY_CS_PORT     GPIO_PORTN_BASE
+#define DISPLAY_CS_PIN      GPIO_PIN_2
+#define DISPLAY_RS_PORT     GPIO_PORTL_BASE     //low: command, high: data
+#define DISPLAY_RS_PIN      GPIO_PIN_3
+#define DISPLAY_RST_PORT    GPIO_PORTH_BASE
+#define DISPLAY_RST_PIN     GPIO_PIN_3
+#define DISPLAY_HWI_PRIORITY 0xE0       //lowest, it only wakes up the display task
+
+#define DISPLAY_WIDTH       128
+#define DISPLAY_HEIGHT      128
+#define DISPLAY_COL_OFFSET  2           //the 128x128 glass sits inside the 132x162 RAM of the controller
+#define DISPLAY_ROW_OFFSET  3
+
+//only changed regions are rendered, into one tile while the other one is sent by the uDMA
+#define DISPLAY_TILE_PIXELS 512         //1 KB, one uDMA transfer (at most 1024 items)
+#define DISPLAY_MAX_DIRTY   8           //dirty rectangles per frame, more are merged
+#define DISPLAY_PERIOD_MS   100
+
+//battery and link quality come from MSP_ANALOG, requested on the route
+#define DISPLAY_ANALOG_MS   500
+#define DISPLAY_LQ_WINDOW   10          //requests the link quality is calculated from
+#define DISPLAY_VBAT_LOW    105         //0.1 V, 3S pack at 3.5 V per cell
+
+typedef struct display_stats_t {
+    uint32_t frames;        //frames with at least one dirty rectangle
+    uint32_t tiles;         //uDMA transfers
+    uint32_t pixels;
+    uint32_t maxFrameUs;    //longest frame, rendering and transfers
+} display_stats_t;
+
+extern void display_telemetry(const char *data, uint8_t size);
+extern void display_redraw(void);
+extern void display_getStats(display_stats_t *stats);
+extern void setUpDisplay_Task(void);
+
+#endif /* LOCAL_INC_DISPLAY_H_ */
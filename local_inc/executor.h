@@ -0,0 +1,100 @@
+/*
+ * executor.h
+ *
+ *  Created on: 19.10.2026
+ *
+ *  Stackless cooperative executor for low-rate jobs (protothread style).
+ *  All jobs run one after another inside the housekeeping task, a job only costs
+ *  its exec_job_t (a few dozen bytes) instead of a task with its own stack.
+ *
+ *  Rules for job functions:
+ *   - the body is enclosed by JOB_BEGIN / JOB_END
+ *   - local variables are NOT preserved across JOB_SLEEP / JOB_YIELD / JOB_WAIT_UNTIL,
+ *     keep state in static variables or in a struct that embeds the exec_job_t
+ *   - no switch statement may contain one of the JOB_* macros
+ *   - at most one JOB_* macro per source line (the line number is the resume point)
+ *   - never block for long (no BIOS_WAIT_FOREVER), every other job waits meanwhile
+ */
+
+#ifndef LOCAL_INC_EXECUTOR_H_
+#define LOCAL_INC_EXECUTOR_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <ti/sysbios/knl/Clock.h>
+
+#define EXEC_POLL_MS    10      //JOB_WAIT_UNTIL conditions are re-checked at least this often
+#define EXEC_IDLE_MS    1000    //longest time the executor sleeps without any due job
+
+//return values of a job function
+#define JOB_WAITING     0
+#define JOB_ENDED       1
+
+typedef struct exec_job_t exec_job_t;
+typedef int (*exec_fnx_t)(exec_job_t *job);
+
+struct exec_job_t {
+    exec_fnx_t fnx;
+    exec_job_t *next;
+    const char *name;
+    uint32_t wakeTick;  //job is due when Clock_getTicks() reached this tick
+    uint16_t lc;        //resume point (source line) inside the job function
+    bool waiting;       //job waits for a condition (JOB_WAIT_UNTIL)
+};
+
+#define JOB_BEGIN(job)      switch((job)->lc) { case 0:
+
+#define JOB_END(job)        } (job)->lc = 0; return JOB_ENDED
+
+//suspend the job for ms milliseconds
+#define JOB_SLEEP(job, ms) \
+    do { \
+        (job)->wakeTick = Clock_getTicks() + (ms); \
+        (job)->waiting = false; \
+        (job)->lc = __LINE__; \
+        return JOB_WAITING; \
+        case __LINE__: ; \
+    } while(0)
+
+//give the other jobs a chance to run, continue on the next pass
+#define JOB_YIELD(job)      JOB_SLEEP(job, 0)
+
+//suspend the job until cond is true, cond is evaluated every EXEC_POLL_MS and on exec_wake()
+#define JOB_WAIT_UNTIL(job, cond) \
+    do { \
+        (job)->waiting = true; \
+        (job)->lc = __LINE__; \
+        case __LINE__: \
+        if(!(cond)) \
+        { \
+            return JOB_WAITING; \
+        } \
+        (job)->waiting = false; \
+    } while(0)
+
+//true if a job is due: it waits for a condition or its sleep is over
+#define JOB_DUE(job)        ((job)->waiting || (int32_t)((job)->wakeTick - Clock_getTicks()) <= 0)
+
+//run a child job inline until it ended, the parent polls every EXEC_POLL_MS and on exec_wake(),
+//a sleeping child is only resumed once its wake tick passed
+//(sleeps inside the child never end early but may end up to EXEC_POLL_MS late)
+#define JOB_SPAWN(job, child, fnx) \
+    do { \
+        (child)->lc = 0; \
+        (child)->waiting = false; \
+        (child)->wakeTick = Clock_getTicks(); \
+        JOB_WAIT_UNTIL(job, JOB_DUE(child) && (fnx)(child) == JOB_ENDED); \
+    } while(0)
+
+//end the job early, it is removed from the executor
+#define JOB_EXIT(job) \
+    do { \
+        (job)->lc = 0; \
+        return JOB_ENDED; \
+    } while(0)
+
+extern void exec_add(exec_job_t *job, exec_fnx_t fnx, const char *name);
+extern void exec_wake(void);
+extern void setUpHousekeeping_Task(void);
+
+#endif /* LOCAL_INC_EXECUTOR_H_ */
@@ -29,8 +29,61 @@
 #define JS_DOWN         EDUMKII_BUTTON2
 #define JS_ARM          EDUMKII_SELECT
 
+//stick calibration: the center is averaged, min/max are captured while the pilot moves the stick
+//calibration runs without a stored calibration or when JS_UP is held at power up
+#define JS_CAL_CENTER_SAMPLES   64
+#define JS_CAL_SAMPLE_MS        5
+#define JS_CAL_RANGE_TIMEOUT_MS 15000   //the range capture ends with select or after this time
+#define JS_CAL_MIN_SPAN         400     //raw counts from the center to each end, less is rejected
+
+//stick values are mapped with fixed point scale factors, no division per sample
+#define JS_SCALE_SHIFT          16
+#define JS_SCALE_UNCALIBRATED   ((1 << JS_SCALE_SHIFT) / 4)     //raw / 4 around the center
+#define JS_HALF_RANGE           500     //output from the center (1500) to each end
+
+//buttons in menu mode (joystick_enterMenu), they do not arm or change the throttle then
+#define JS_BTN_UP       0x01
+#define JS_BTN_DOWN     0x02
+#define JS_BTN_SELECT   0x04
+
+//source of the raw input (console command replay)
+typedef enum js_input_mode_t {
+    JS_INPUT_LIVE = 0,  //ADC and buttons
+    JS_INPUT_RECORD,    //ADC and buttons, recorded into the input ring
+    JS_INPUT_REPLAY,    //input ring instead of the hardware
+    JS_INPUT_REMOTE     //ground station over UDP (joystick_setRemote)
+} js_input_mode_t;
+
+#define JS_REMOTE_TIMEOUT_MS    500     //back to the sticks, disarmed, without a new remote input
+
+//input of the ground station, values already mapped
+typedef struct js_remote_t {
+    uint16_t roll;      //1000-2000
+    uint16_t pitch;     //1000-2000
+    uint16_t throttle;  //1000-2000
+    bool armed;
+} js_remote_t;
+
+//one joystick sample as handed from the sampling task to the control task
+typedef struct js_sample_t {
+    uint32_t rawPitch;  //raw ADC value
+    uint32_t rawRoll;   //raw ADC value
+    uint16_t roll;      //1000-2000
+    uint16_t pitch;     //1000-2000
+    uint16_t throttle;  //1000-2000
+    bool armed;
+    uint32_t timestamp; //Clock ticks
+} js_sample_t;
+
 extern void setup_ADC_edumkII(void);
 extern void setUpJoyStick_Task();
+extern void joystick_getSample(js_sample_t *sample);
+extern bool joystick_setRemote(const js_remote_t *input);
+extern bool joystick_enterMenu(void);
+extern void joystick_leaveMenu(void);
+extern bool joystick_buttonsPending(void);
+extern uint8_t joystick_takeButtons(void);
+extern uint16_t joystick_benchMap(uint32_t raw);
 
 #endif /* LOCAL_INC_JOYSTICK_H_ */
 
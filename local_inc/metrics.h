@@ -0,0 +1,72 @@
+/*
+ * metrics.h
+ *
+ *  Created on: 19.10.2026
+ */
+
+#ifndef LOCAL_INC_METRICS_H_
+#define LOCAL_INC_METRICS_H_
+
+#include <stdint.h>
+
+//registry of all metrics, a module adds its metrics here: X(id, name)
+//counters only increase, gauges hold the latest value
+#define METRICS_COUNTERS(X) \
+    X(MET_FRAMES_SENT,      "frames_sent") \
+    X(MET_PACKETS_SENT,     "packets_sent") \
+    X(MET_TX_DROPPED,       "tx_dropped") \
+    X(MET_UART_TX_ERRORS,   "uart_tx_errors") \
+    X(MET_UART_RX_ERRORS,   "uart_rx_errors") \
+    X(MET_RX_BYTES,         "rx_bytes") \
+    X(MET_RTS_STALLS,       "rts_stalls") \
+    X(MET_TX_TIMEOUTS,      "tx_timeouts") \
+    X(MET_CONN_ATTEMPTS,    "conn_attempts") \
+    X(MET_RECONNECTS,       "reconnects") \
+    X(MET_LINK_LOSSES,      "link_losses") \
+    X(MET_MODULE_RESETS,    "module_resets") \
+    X(MET_ADC_OVERRUNS,     "adc_overruns") \
+    X(MET_SAMPLES,          "samples") \
+    X(MET_DEADLINE_MISSES,  "deadline_misses") \
+    X(MET_RELAY_FRAMES,     "relay_frames") \
+    X(MET_RELAY_ERRORS,     "relay_errors") \
+    X(MET_RCOUT_FRAMES,     "rcout_frames") \
+    X(MET_RCOUT_OVERRUNS,   "rcout_overruns") \
+    X(MET_DISPLAY_TILES,    "display_tiles")
+
+#define METRICS_GAUGES(X) \
+    X(MET_CPU_LOAD,         "cpu_load") \
+    X(MET_LINK_UP,          "link_up")
+
+//histograms: X(id, name, shift), bucket 0 counts values < 2^shift, every further bucket doubles the bound
+#define METRICS_HISTOGRAMS(X) \
+    X(MET_HIST_TX_US,       "tx_us", 6) \
+    X(MET_HIST_JITTER_US,   "jitter_us", 6) \
+    X(MET_HIST_RELAY_US,    "relay_us", 3)
+
+#define METRIC_HIST_BUCKETS 8   //the last bucket counts everything above
+
+#define METRIC_ENUM(id, name) id,
+#define METRIC_HIST_ENUM(id, name, shift) id,
+
+typedef enum metric_scalar_t {
+    METRICS_COUNTERS(METRIC_ENUM)
+    METRICS_GAUGES(METRIC_ENUM)
+    MET_SCALAR_COUNT
+} metric_scalar_t;
+
+typedef enum metric_hist_t {
+    METRICS_HISTOGRAMS(METRIC_HIST_ENUM)
+    MET_HIST_COUNT
+} metric_hist_t;
+
+#define METRIC_COUNT(id, name) + 1
+#define MET_COUNTER_COUNT   (0 METRICS_COUNTERS(METRIC_COUNT))  //counters come first
+
+extern void metrics_inc(metric_scalar_t id);
+extern void metrics_add(metric_scalar_t id, uint32_t n);
+extern void metrics_set(metric_scalar_t id, uint32_t value);
+extern void metrics_observe(metric_hist_t id, uint32_t value);
+extern uint32_t metrics_get(metric_scalar_t id);
+extern void metrics_start(void);
+
+#endif /* LOCAL_INC_METRICS_H_ */
@@ -0,0 +1,20 @@
+/*
+ * ramfunc.h
+ *
+ *  Created on: 19.10.2026
+ */
+
+#ifndef LOCAL_INC_RAMFUNC_H_
+#define LOCAL_INC_RAMFUNC_H_
+
+//functions of the control hot path that run from SRAM, without the flash wait states (5 at 120 MHz)
+//.ramfunc is loaded into FLASH and linked for SRAM (EK_TM4C1294XL.cmd), ramfunc_copy moves it at the start of main
+//none of them must run before the copy
+#define RAMFUNC __attribute__((section(".ramfunc")))
+
+#define RAMFUNC_BENCH_RUNS  100     //control steps per measurement, interrupts are off for one step at a time
+
+extern void ramfunc_copy(void);
+extern void setUpRamFunc(void);
+
+#endif /* LOCAL_INC_RAMFUNC_H_ */
@@ -0,0 +1,47 @@
+/*
+ * rcout.h
+ *
+ *  Created on: 19.10.2026
+ */
+
+#ifndef LOCAL_INC_RCOUT_H_
+#define LOCAL_INC_RCOUT_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define RCOUT_CHANNELS      16      //SBUS and CRSF both carry 16 channels of 11 bits
+#define RCOUT_CHANNEL_BITS  11
+#define RCOUT_FRAME_MAX     26      //CRSF RC channels frame, SBUS is 25 bytes
+#define RCOUT_STALE_MS      200     //without new controls the failsafe frame is sent
+
+//channel values of both protocols: 172 = 988 us, 992 = 1500 us, 1811 = 2012 us
+#define RCOUT_VALUE_MIN     172
+#define RCOUT_VALUE_CENTER  992
+#define RCOUT_VALUE_MAX     1811
+
+//output on UART3: PA5 = TX to the RC transmitter module, sent by uDMA channel 17
+//SBUS needs an inverter (e.g. 74LVC1G04) between PA5 and the module, the UART can not invert its output
+#define RCOUT_UART_BASE     UART3_BASE
+#define RCOUT_DMA_CHANNEL   17
+
+typedef enum rcout_mode_t {
+    RCOUT_OFF = 0,
+    RCOUT_SBUS,         //inverted, 100000 baud 8E2, every 7 ms (high speed mode)
+    RCOUT_CRSF,         //420000 baud 8N1, every 4 ms (250 Hz)
+    RCOUT_MODE_COUNT
+} rcout_mode_t;
+
+typedef struct rcout_stats_t {
+    uint32_t frames;        //started DMA transfers
+    uint32_t failsafes;     //frames sent with the failsafe values, the controls were stale
+    uint32_t overruns;      //frame period reached while the previous frame was still being sent
+} rcout_stats_t;
+
+extern void rcout_setControls(uint16_t roll, uint16_t pitch, uint16_t throttle, bool armed);
+extern void rcout_setMode(rcout_mode_t mode);
+extern rcout_mode_t rcout_getMode(void);
+extern void rcout_getStats(rcout_stats_t *stats);
+extern void setUpRcOut(void);
+
+#endif /* LOCAL_INC_RCOUT_H_ */
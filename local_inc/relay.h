@@ -0,0 +1,31 @@
+/*
+ * relay.h
+ *
+ *  Created on: 19.10.2026
+ */
+
+#ifndef LOCAL_INC_RELAY_H_
+#define LOCAL_INC_RELAY_H_
+
+#include <stdint.h>
+
+#define RELAY_BAUD          115200  //UART0, same as the console
+#define RELAY_HWI_PRIORITY  0x20    //above all driver interrupts, 0 would be a zero latency interrupt
+#define RELAY_MAX_SIZE      58      //MSP payload bytes, the whole frame fits into BT_PAYLOAD_MAX
+#define RELAY_TIMEOUT_MS    500     //without a complete frame the copter gets the failsafe frame
+#define RELAY_EXIT_CHAR     '+'     //three of them between frames end the relay
+
+typedef struct relay_stats_t {
+    uint32_t frames;        //forwarded with a valid checksum
+    uint32_t bytes;         //forwarded
+    uint32_t rejected;      //bad header or size, not forwarded
+    uint32_t badChecksum;   //forwarded already, the copter drops them too
+    uint32_t stalls;        //RTS of the module set, TX FIFO not empty at the header or full, frame dropped
+    uint32_t failsafes;     //sent after RELAY_TIMEOUT_MS without a frame
+    uint32_t maxUs;         //longest RX interrupt to TX start
+} relay_stats_t;
+
+extern void relay_getStats(relay_stats_t *stats);
+extern void setUpRelay(void);
+
+#endif /* LOCAL_INC_RELAY_H_ */
@@ -0,0 +1,57 @@
+/*
+ * replay.h
+ *
+ *  Created on: 19.10.2026
+ *
+ *  Record and replay of the joystick input stream (raw ADC pairs and button events).
+ *  Portable C without SYS/BIOS, also builds on the host (tools/replay_dump.c).
+ *  The caller serializes all calls on one ring.
+ */
+
+#ifndef LOCAL_INC_REPLAY_H_
+#define LOCAL_INC_REPLAY_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define REPLAY_SEG_SIZE     256     //bytes per segment, every segment starts with a keyframe
+#define REPLAY_RING_SIZE    (64 * REPLAY_SEG_SIZE)  //buffer of the target, about 5000 samples
+
+//event types
+#define REPLAY_SAMPLE   0   //raw ADC pair of one sample
+#define REPLAY_BUTTON   1   //button press (JS_BTN_x)
+
+typedef struct replay_event_t {
+    uint8_t type;
+    uint8_t buttons;    //REPLAY_BUTTON
+    uint16_t roll;      //raw ADC, REPLAY_SAMPLE
+    uint16_t pitch;
+    uint32_t time;      //ms
+    uint32_t state;     //state of the caller, stored with every keyframe (replay_next returns the last one)
+} replay_event_t;
+
+//ring of segments, the oldest segment is reused when the ring is full
+typedef struct replay_ring_t {
+    uint8_t *buffer;
+    uint16_t segCount;
+    uint16_t oldest;    //first segment in the ring
+    uint16_t head;      //segment that is written
+    uint16_t used;      //segments in use
+    uint16_t pos;       //write position in head
+    replay_event_t last;    //base of the next delta
+    uint32_t events;
+    uint32_t overwritten;   //segments dropped to make room
+    //playback cursor
+    uint16_t readSeg;
+    uint16_t readPos;
+    replay_event_t readLast;
+} replay_ring_t;
+
+extern void replay_init(replay_ring_t *ring, uint8_t *buffer, uint32_t size);
+extern void replay_clear(replay_ring_t *ring);
+extern void replay_put(replay_ring_t *ring, const replay_event_t *event);
+extern void replay_rewind(replay_ring_t *ring);
+extern bool replay_next(replay_ring_t *ring, replay_event_t *event);
+extern uint32_t replay_bytes(const replay_ring_t *ring);
+
+#endif /* LOCAL_INC_REPLAY_H_ */
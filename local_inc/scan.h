@@ -0,0 +1,35 @@
+/*
+ * scan.h
+ *
+ *  Created on: 19.10.2026
+ */
+
+#ifndef LOCAL_INC_SCAN_H_
+#define LOCAL_INC_SCAN_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include <config.h>
+#include <executor.h>
+
+#define BT_MAC_LEN              CFG_MAC_LEN     //address as 12 hex characters
+#define SCAN_NAME_LEN           CFG_NAME_LEN    //advertised name, longer names are cut
+#define SCAN_MAX_DEVICES        8       //strongest copters kept during a scan
+#define SCAN_DURATION_MS        3000
+#define SCAN_SELECT_TIMEOUT_MS  15000   //the strongest copter is taken if the pilot does not select one
+
+typedef struct scan_device_t {
+    char mac[BT_MAC_LEN + 1];
+    uint8_t addrType;           //0 = public, 1 = random
+    int8_t rssi;                //dBm
+    char name[SCAN_NAME_LEN + 1];
+} scan_device_t;
+
+extern int scan_job(exec_job_t *job);
+extern bool scan_onEvent(const char *line);
+extern bool scan_getSelected(scan_device_t *device);
+extern bool scan_loadCached(scan_device_t *device);
+extern void scan_storeCached(const scan_device_t *device);
+
+#endif /* LOCAL_INC_SCAN_H_ */
@@ -0,0 +1,37 @@
+/*
+ * sysmon.h
+ *
+ *  Created on: 19.10.2026
+ */
+
+#ifndef LOCAL_INC_SYSMON_H_
+#define LOCAL_INC_SYSMON_H_
+
+#include <xdc/std.h>
+#include <ti/sysbios/knl/Task.h>
+
+#define SYSMON_MAX_TASKS    12
+#define SYSMON_MAX_REPORTS  4   //additional reports of other modules
+#define SYSMON_STACK_WARN_PERCENT   80  //mark stacks with a higher peak usage in the report
+
+//boot milestones, measured from the start of main
+typedef enum sysmon_boot_t {
+    BOOT_BIOS_START = 0,
+    BOOT_ADC_CALIBRATED,
+    BOOT_UART_OPEN,
+    BOOT_BLE_POWERED,
+    BOOT_CONNECTED,
+    BOOT_FIRST_FRAME,   //armed-ready: first control frame is on the wire
+    BOOT_MARK_COUNT
+} sysmon_boot_t;
+
+extern void sysmon_bootStart(void);
+extern void sysmon_bootMark(sysmon_boot_t mark);
+extern void sysmon_registerTask(Task_Handle handle, const char *name);
+extern const char *sysmon_taskName(Task_Handle handle);
+extern void sysmon_report(void);
+extern void sysmon_reportMemory(void);
+extern void sysmon_addReport(void (*report)(void));
+extern void sysmon_start(void);
+
+#endif /* LOCAL_INC_SYSMON_H_ */
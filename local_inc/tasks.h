@@ -0,0 +1,45 @@
+/*
+ * tasks.h
+ *
+ *  Created on: 19.10.2026
+ *
+ *  Central place for task priorities and periods.
+ *  Priorities are assigned rate-monotonic: the shorter the period of a task,
+ *  the higher its priority. Event driven tasks inherit the priority of the
+ *  task that triggers them, one step lower.
+ */
+
+#ifndef LOCAL_INC_TASKS_H_
+#define LOCAL_INC_TASKS_H_
+
+//task priorities (0-15, 15 is highest, 0 is the idle task)
+#define TASK_PRIO_SAMPLING      14  //periodic, CONTROL_PERIOD_MS
+#define TASK_PRIO_CONTROL       13  //triggered by every new sample
+#define TASK_PRIO_LINK_TX       12  //triggered by every new control frame, one task per link
+#define TASK_PRIO_LINK_RX       11  //triggered by incoming bytes on the UART, one task per link
+#define TASK_PRIO_NET           5   //UDP bridge, below the NDK stack thread (application.cfg)
+#define TASK_PRIO_USB           4   //USB telemetry stream and commands of the PC
+#define TASK_PRIO_CONSOLE       3   //operator commands on UART0, above the reports
+#define TASK_PRIO_HOUSEKEEPING  2   //executor for low-rate jobs, see executor.h
+#define TASK_PRIO_BLACKBOX      1   //SD card writes, only the idle task is lower
+#define TASK_PRIO_DISPLAY       1   //LCD, shares SSI2 with the SD card
+
+//task stack sizes in bytes
+//estimates from the call depth and locals of each task, not measured yet: check the peak usage in the
+//watermark report of the housekeeping task (sysmon) on the target and keep ~30% margin
+#define TASK_STACK_SAMPLING     512
+#define TASK_STACK_CONTROL      512
+#define TASK_STACK_LINK_TX      512
+#define TASK_STACK_LINK_RX      512 //no System_printf since the connection sequence moved into the executor
+#define TASK_STACK_HOUSEKEEPING 1024 //hosts the executor jobs, System_printf in the reports
+#define TASK_STACK_CONSOLE      1024 //formatted output of the commands
+#define TASK_STACK_BLACKBOX     1536 //FatFS and the SD card driver
+#define TASK_STACK_USB          768
+#define TASK_STACK_NET          1024 //NDK socket calls
+#define TASK_STACK_DISPLAY      768
+
+//task periods in ms (Clock ticks are 1 ms)
+#define CONTROL_PERIOD_MS       50  //default, tunable as loopPeriodMs (config.h)
+#define HOUSEKEEPING_PERIOD_MS  1000
+
+#endif /* LOCAL_INC_TASKS_H_ */
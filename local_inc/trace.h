@@ -0,0 +1,57 @@
+/*
+ * trace.h
+ *
+ *  Created on: 19.10.2026
+ */
+
+#ifndef LOCAL_INC_TRACE_H_
+#define LOCAL_INC_TRACE_H_
+
+#include <stdint.h>
+
+#include <xdc/std.h>
+#include <xdc/runtime/Error.h>
+#include <ti/sysbios/BIOS.h>
+#include <ti/sysbios/hal/Hwi.h>
+#include <ti/sysbios/knl/Task.h>
+
+#define TRACE_RING_SIZE         1024    //records, power of two
+#define TRACE_DUMP_PER_LINE     16      //records per "TR" line of the dump
+#define TRACE_STREAM_PERIOD_MS  100
+
+//record types
+typedef enum trace_type_t {
+    TRACE_TASK_SWITCH = 1,  //arg: task index of the next task (trace_taskCreate)
+    TRACE_HWI_BEGIN,        //arg: exception number (16 + interrupt number, see hw_ints.h)
+    TRACE_HWI_END,
+    TRACE_SEM_POST,         //arg: trace_sem_t
+    TRACE_MARK              //arg: free for debugging
+} trace_type_t;
+
+//semaphores that are traced where they are posted
+typedef enum trace_sem_t {
+    TRACE_SEM_SAMPLE_TICK = 0,
+    TRACE_SEM_ADC_DONE,
+    TRACE_SEM_TX_FRAME,
+    TRACE_SEM_EXEC_WAKE
+} trace_sem_t;
+
+//one record, 8 bytes
+typedef struct trace_rec_t {
+    uint32_t time;  //Timestamp_get32
+    uint16_t arg;
+    uint8_t type;
+    uint8_t reserved;
+} trace_rec_t;
+
+extern void trace_event(trace_type_t type, uint16_t arg);
+extern void trace_start(void);
+
+//hooks, configured in application.cfg
+extern void trace_taskRegister(Int hookId);
+extern void trace_taskCreate(Task_Handle task, Error_Block *eb);
+extern void trace_taskSwitch(Task_Handle prev, Task_Handle next);
+extern void trace_hwiBegin(Hwi_Handle hwi);
+extern void trace_hwiEnd(Hwi_Handle hwi);
+
+#endif /* LOCAL_INC_TRACE_H_ */
@@ -0,0 +1,79 @@
+/*
+ * udpbridge.h
+ *
+ *  Created on: 19.10.2026
+ */
+
+#ifndef LOCAL_INC_UDPBRIDGE_H_
+#define LOCAL_INC_UDPBRIDGE_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define NET_PORT            5760    //UDP port of the controller
+#define NET_BLOCK_SIZE      1024    //one datagram, below the Ethernet MTU
+#define NET_PERIOD_MS       20      //a datagram with the collected records at least this often
+#define NET_LINK_PERIOD_MS  100     //link metrics record
+#define NET_MAX_PAYLOAD     64
+#define NET_MAGIC           0x4243  //"CB"
+#define NET_VERSION         1
+#define NET_PEER_TIMEOUT_MS 2000    //another station is only accepted after the current one was silent this long
+#define NET_VALUE_MIN       1000    //range of roll, pitch and throttle in net_input_t
+#define NET_VALUE_MAX       2000
+
+//every datagram starts with net_header_t, all values little endian
+typedef enum net_kind_t {
+    NET_TELEMETRY = 1,  //controller: records as in the blackbox (bb_header_t + payload, blackbox.h)
+    NET_INPUT,          //station: net_input_t, replaces the sticks (joystick_setRemote)
+    NET_MSP,            //station: MSP frame, sent to the copter with the next packet
+    NET_HELLO           //station: no payload, only makes the sender the receiver of the telemetry
+} net_kind_t;
+
+typedef struct net_header_t {
+    uint16_t magic;     //NET_MAGIC
+    uint8_t version;
+    uint8_t kind;       //net_kind_t
+    uint32_t seq;       //per sender, gaps are lost datagrams, a seq not above the last one is dropped
+    uint32_t time;      //sender clock in ms: Clock ticks on the controller
+} net_header_t;
+
+typedef struct net_input_t {
+    uint16_t roll;      //1000-2000
+    uint16_t pitch;     //1000-2000
+    uint16_t throttle;  //1000-2000
+    uint8_t armed;
+    uint8_t reserved;
+} net_input_t;
+
+//record type behind every BB_FRAME record in the telemetry, next to the blackbox types
+#define NET_REC_FRAME_INFO  0x10
+
+//per packet sent to the copter: which remote input it carries and how long it took
+typedef struct net_frame_t {
+    uint32_t packet;        //number of the packet
+    uint32_t inputSeq;      //seq of the latest NET_INPUT datagram
+    uint32_t inputTime;     //its time field, the station computes the round trip from it
+    uint16_t inputAgeMs;    //from receiving the input to sending the packet
+    uint16_t sendUs;        //UART write of the packet
+    uint8_t size;
+    uint8_t frames;
+    uint16_t reserved;
+} net_frame_t;
+
+typedef struct udp_stats_t {
+    uint32_t txDatagrams;
+    uint32_t txDropped;     //records dropped, both datagrams full
+    uint32_t rxDatagrams;
+    uint32_t rxErrors;      //bad header, size or values, MSP frames the link did not take
+    uint32_t rxStale;       //seq not above the last one of the station (reordered or repeated)
+    uint32_t rxRejected;    //from another host while the station is active
+    uint32_t rxRefused;     //NET_INPUT the handset did not take (armed, revoked by the pilot, recording)
+} udp_stats_t;
+
+extern void udp_publish(uint8_t type, const void *data, uint8_t size);
+extern void udp_frameSent(const char *packet, uint8_t size, uint8_t frames, uint32_t sendUs);
+extern void udp_getStats(udp_stats_t *stats);
+extern void udp_ipAddrHook(unsigned int ipAddr, unsigned int ifIdx, unsigned int fAdd);
+extern void setUpUdpBridge(void);
+
+#endif /* LOCAL_INC_UDPBRIDGE_H_ */
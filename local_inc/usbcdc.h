@@ -0,0 +1,39 @@
+/*
+ * usbcdc.h
+ *
+ *  Created on: 19.10.2026
+ */
+
+#ifndef LOCAL_INC_USBCDC_H_
+#define LOCAL_INC_USBCDC_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define USB_PACKET_SIZE     64      //bulk endpoint, full speed
+#define USB_TX_BLOCK_SIZE   1024    //one block is sent while the other is filled
+#define USB_MAX_PAYLOAD     64
+#define USB_LINK_PERIOD_MS  100     //link metrics frame
+
+//frame: USB_SYNC, type, payload length, sequence number, payload, CRC-8 (poly 0x07) over type to payload
+#define USB_SYNC            0xA5
+#define USB_FRAME_OVERHEAD  5
+
+//frame types from the controller are the record types of the blackbox (bb_type_t, blackbox.h)
+//with the same payloads, frame types from the PC:
+#define USB_CMD_MSP         0x80    //payload: MSP frame, sent to the copter with the next packet
+#define USB_CMD_STREAM      0x81    //payload: uint8_t mask of the streamed types (bit = 1 << bb_type_t)
+
+typedef struct usbcdc_stats_t {
+    uint32_t txFrames;
+    uint32_t txDropped;     //both blocks full or the PC was not reading
+    uint32_t txRetries;     //packets the endpoint did not take, sent again by the USB task
+    uint32_t rxFrames;
+    uint32_t rxErrors;      //CRC errors, unknown commands and frames the link did not take
+} usbcdc_stats_t;
+
+extern void usbcdc_send(uint8_t type, const void *data, uint8_t size);
+extern void usbcdc_getStats(usbcdc_stats_t *stats);
+extern void setUpUsbCdc_Task(void);
+
+#endif /* LOCAL_INC_USBCDC_H_ */
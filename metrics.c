@@ -0,0 +1,188 @@
+/*
+ * metrics.c
+ *
+ *  Created on: 19.10.2026
+ *
+ *  Static metrics registry (metrics.h), no allocation and no locks.
+ *  Counters and histogram buckets are incremented with LDREX/STREX, safe from Hwi, Swi and Task
+ *  context. Gauges are single word stores.
+ *  Snapshot on the console:
+ *    metrics        table for humans
+ *    metrics names  "N,<name>,..." in the order of the raw snapshot
+ *    metrics raw    "M,<tick>,<value>,..." counters, gauges, then all histogram buckets
+ *  tools/metrics_plot.py polls the raw snapshot and plots it.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include <xdc/std.h>
+#include <xdc/runtime/System.h>
+
+#include <ti/sysbios/knl/Clock.h>
+
+#include <console.h>
+#include <metrics.h>
+#include <ramfunc.h>
+
+#define METRIC_NAME(id, name) name,
+#define METRIC_HIST_NAME(id, name, shift) name,
+#define METRIC_HIST_SHIFT(id, name, shift) shift,
+
+static const char * const scalarNames[MET_SCALAR_COUNT] = {
+    METRICS_COUNTERS(METRIC_NAME)
+    METRICS_GAUGES(METRIC_NAME)
+};
+static const char * const histNames[MET_HIST_COUNT] = {
+    METRICS_HISTOGRAMS(METRIC_HIST_NAME)
+};
+static const uint8_t histShifts[MET_HIST_COUNT] = {
+    METRICS_HISTOGRAMS(METRIC_HIST_SHIFT)
+};
+
+static volatile uint32_t scalars[MET_SCALAR_COUNT];
+static volatile uint32_t buckets[MET_HIST_COUNT][METRIC_HIST_BUCKETS];
+
+//read-modify-write that is repeated if anything else wrote the word in between
+static inline void atomic_add(volatile uint32_t *value, uint32_t n)
+{
+#if defined(__TI_COMPILER_VERSION__)
+    uint32_t sum;
+    do
+    {
+        sum = __ldrex((void *)value) + n;
+    } while(__strex(sum, (void *)value) != 0);
+#else
+    __atomic_fetch_add(value, n, __ATOMIC_RELAXED);
+#endif
+}
+
+RAMFUNC void metrics_inc(metric_scalar_t id)
+{
+    atomic_add(&scalars[id], 1);
+}
+
+void metrics_add(metric_scalar_t id, uint32_t n)
+{
+    atomic_add(&scalars[id], n);
+}
+
+void metrics_set(metric_scalar_t id, uint32_t value)
+{
+    scalars[id] = value;
+}
+
+uint32_t metrics_get(metric_scalar_t id)
+{
+    return scalars[id];
+}
+
+//counts value into its power of two bucket
+RAMFUNC void metrics_observe(metric_hist_t id, uint32_t value)
+{
+    uint8_t bucket = 0;
+
+    value >>= histShifts[id];
+    while(value != 0 && bucket < METRIC_HIST_BUCKETS - 1)
+    {
+        value >>= 1;
+        bucket++;
+    }
+    atomic_add(&buckets[id][bucket], 1);
+}
+
+static void print_table(void)
+{
+    uint8_t i;
+    uint8_t b;
+
+    for(i = 0; i < MET_SCALAR_COUNT; i++)
+    {
+        console_printf("%-16s %10u%s\r\n", scalarNames[i], scalars[i], (i < MET_COUNTER_COUNT) ? "" : " (gauge)");
+    }
+    for(i = 0; i < MET_HIST_COUNT; i++)
+    {
+        console_printf("%-16s", histNames[i]);
+        for(b = 0; b < METRIC_HIST_BUCKETS; b++)
+        {
+            if(b < METRIC_HIST_BUCKETS - 1)
+            {
+                console_printf(" <%u:%u", 1 << (histShifts[i] + b), buckets[i][b]);
+            }
+            else
+            {
+                console_printf(" more:%u", buckets[i][b]);
+            }
+        }
+        console_printf("\r\n");
+    }
+}
+
+static void print_names(void)
+{
+    uint8_t i;
+    uint8_t b;
+
+    console_printf("N");
+    for(i = 0; i < MET_SCALAR_COUNT; i++)
+    {
+        console_printf(",%s", scalarNames[i]);
+    }
+    for(i = 0; i < MET_HIST_COUNT; i++)
+    {
+        for(b = 0; b < METRIC_HIST_BUCKETS; b++)
+        {
+            console_printf(",%s[%u]", histNames[i], b);
+        }
+    }
+    console_printf("\r\n");
+}
+
+static void print_raw(void)
+{
+    uint8_t i;
+    uint8_t b;
+
+    console_printf("M,%u", Clock_getTicks());
+    for(i = 0; i < MET_SCALAR_COUNT; i++)
+    {
+        console_printf(",%u", scalars[i]);
+    }
+    for(i = 0; i < MET_HIST_COUNT; i++)
+    {
+        for(b = 0; b < METRIC_HIST_BUCKETS; b++)
+        {
+            console_printf(",%u", buckets[i][b]);
+        }
+    }
+    console_printf("\r\n");
+}
+
+static void cmd_metrics(uint8_t argc, char *argv[])
+{
+    if(argc == 1)
+    {
+        print_table();
+    }
+    else if(strcmp(argv[1], "raw") == 0)
+    {
+        print_raw();
+    }
+    else if(strcmp(argv[1], "names") == 0)
+    {
+        print_names();
+    }
+    else
+    {
+        console_printf("usage: metrics [raw|names]\r\n");
+    }
+}
+
+static const console_cmd_t metricsCmd = { "metrics", "snapshot: metrics [raw|names]", cmd_metrics };
+
+//adds the snapshot command to the console, must be called before BIOS_start
+void metrics_start(void)
+{
+    console_addCommand(&metricsCmd);
+}
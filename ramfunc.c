@@ -0,0 +1,129 @@
+/*
+ * ramfunc.c
+ *
+ *  Created on: 19.10.2026
+ *
+ *  Control hot path in SRAM: the functions marked RAMFUNC (ramfunc.h) are collected in .ramfunc,
+ *  the linker loads the section into FLASH and links it for SRAM. ramfunc_copy moves it before
+ *  the first of them can run. At 120 MHz every flash access costs 5 wait states, the prefetch
+ *  buffer hides them for straight code but not for the branches and table lookups of the ISRs,
+ *  the filter and the frame building. SRAM runs them at zero wait states.
+ *  Calls between SRAM and FLASH are out of range of BL, the linker inserts trampolines.
+ *  The vector table is in SRAM already (.vtable), the BIOS dispatcher stays in the library.
+ *  Console: ramfunc measures one control step of the real hot path (map_axis for both axes and
+ *  build_rc_frame) from SRAM and from the load image in FLASH.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include <inc/hw_sysctl.h>
+#include <inc/hw_types.h>
+
+#include <xdc/std.h>
+#include <xdc/runtime/Timestamp.h>
+#include <xdc/runtime/Types.h>
+
+#include <ti/sysbios/BIOS.h>
+#include <ti/sysbios/hal/Hwi.h>
+
+#include <bluetooth.h>
+#include <console.h>
+#include <joystick.h>
+#include <ramfunc.h>
+
+//defined by the linker (EK_TM4C1294XL.cmd), only the addresses are used
+extern uint8_t ramfuncLoadStart;
+extern uint8_t ramfuncRunStart;
+extern uint8_t ramfuncSize;
+
+typedef uint16_t (*bench_map_t)(uint32_t raw);
+typedef void (*bench_frame_t)(char *payload, uint16_t roll, uint16_t pitch);
+
+static char benchFrame[MSP_RC_FRAME_SIZE];
+
+void ramfunc_copy(void)
+{
+    memcpy(&ramfuncRunStart, &ramfuncLoadStart, (uint32_t)&ramfuncSize);
+}
+
+//address of the load image in FLASH of a function in .ramfunc
+//calls inside the section are PC relative and stay in the image, the bench entries only call into .ramfunc
+static uintptr_t load_image(uintptr_t fnx)
+{
+    return fnx - (uintptr_t)&ramfuncRunStart + (uintptr_t)&ramfuncLoadStart;
+}
+
+//CPU cycles of one control step: both axes mapped and the frame built
+//interrupts are only off for a single step (a few us), the fastest of RAMFUNC_BENCH_RUNS counts
+//as it is the one without a cache or prefetch disturbance, the cost of the timestamps is subtracted
+static uint32_t measure(bench_map_t map, bench_frame_t frame)
+{
+    Types_FreqHz cpuFreq;
+    Types_FreqHz tsFreq;
+    uint32_t start;
+    uint32_t ticks;
+    uint32_t best = UINT32_MAX;
+    uint32_t overhead = UINT32_MAX;
+    uint16_t roll;
+    uint16_t pitch;
+    uint16_t i;
+    UInt key;
+
+    BIOS_getCpuFreq(&cpuFreq);
+    Timestamp_getFreq(&tsFreq);
+
+    for(i = 0; i < RAMFUNC_BENCH_RUNS; i++)
+    {
+        key = Hwi_disable();
+        start = Timestamp_get32();
+        ticks = Timestamp_get32() - start;
+        Hwi_restore(key);
+        if(ticks < overhead)
+        {
+            overhead = ticks;
+        }
+
+        key = Hwi_disable();
+        start = Timestamp_get32();
+        roll = map((i * 41) & 0xFFF);
+        pitch = map(0xFFF - ((i * 41) & 0xFFF));
+        frame(benchFrame, roll, pitch);
+        ticks = Timestamp_get32() - start;
+        Hwi_restore(key);
+        if(ticks < best)
+        {
+            best = ticks;
+        }
+    }
+
+    return (uint64_t)(best - overhead) * cpuFreq.lo / tsFreq.lo;
+}
+
+static void cmd_ramfunc(uint8_t argc, char *argv[])
+{
+    uint32_t sramCycles;
+    uint32_t flashCycles;
+
+    console_printf(".ramfunc: %u bytes, run 0x%08x, load 0x%08x, flash wait states %u\r\n",
+                   (uint32_t)&ramfuncSize, (uint32_t)&ramfuncRunStart, (uint32_t)&ramfuncLoadStart,
+                   (HWREG(SYSCTL_MEMTIM0) & SYSCTL_MEMTIM0_FWS_M) >> SYSCTL_MEMTIM0_FWS_S);
+
+    flashCycles = measure((bench_map_t)load_image((uintptr_t)joystick_benchMap),
+                          (bench_frame_t)load_image((uintptr_t)bt_benchFrame));
+    sramCycles = measure(joystick_benchMap, bt_benchFrame);
+    console_printf("control step (map_axis x2, build_rc_frame), best of %u: SRAM %u cycles, FLASH %u cycles\r\n",
+                   RAMFUNC_BENCH_RUNS, sramCycles, flashCycles);
+    if(sramCycles > 0)
+    {
+        console_printf("FLASH takes %u%% of the SRAM time\r\n", flashCycles * 100 / sramCycles);
+    }
+}
+
+static const console_cmd_t ramfuncCmd = { "ramfunc", "cycles of the hot path from SRAM and from FLASH", cmd_ramfunc };
+
+void setUpRamFunc(void)
+{
+    console_addCommand(&ramfuncCmd);
+}
@@ -0,0 +1,323 @@
+/*
+ * rcout.c
+ *
+ *  Created on: 19.10.2026
+ *
+ *  Wired output of the controls to a conventional RC transmitter module, next to the BLE link.
+ *  The control task hands every sample to rcout_setControls, the same values send_controls gets.
+ *  A Clock function runs at the frame period of the selected protocol, encodes the latest controls
+ *  and starts one uDMA transfer of the frame into the UART, the CPU never writes a byte itself.
+ *  The encoder is one function for both protocols, driven by the protocol table (header, CRC,
+ *  SBUS flags) and the channel table (which control goes to which channel); the CRSF CRC8 uses a
+ *  lookup table. Controls older than RCOUT_STALE_MS are replaced by the failsafe values, the SBUS
+ *  frame additionally carries the failsafe flag.
+ *  Console: rcout [off|sbus|crsf] selects the protocol at runtime, rcout shows the counters.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include <driverlib/gpio.h>
+#include <driverlib/pin_map.h>
+#include <driverlib/sysctl.h>
+#include <driverlib/uart.h>
+#include <driverlib/udma.h>
+#include <inc/hw_memmap.h>
+#include <inc/hw_uart.h>
+
+#include <xdc/std.h>
+#include <xdc/runtime/Types.h>
+
+#include <ti/sysbios/BIOS.h>
+#include <ti/sysbios/hal/Hwi.h>
+#include <ti/sysbios/knl/Clock.h>
+#include <ti/sysbios/knl/Task.h>
+
+#include <console.h>
+#include <metrics.h>
+#include <ramfunc.h>
+#include <rcout.h>
+
+#define SBUS_START          0x0F
+#define SBUS_END            0x00
+#define SBUS_FLAG_LOST      0x04
+#define SBUS_FLAG_FAILSAFE  0x08
+
+#define CRSF_ADDR_MODULE    0xEE    //frames from the handset to the transmitter module
+#define CRSF_TYPE_RC        0x16    //RC_CHANNELS_PACKED
+#define CRSF_RC_LENGTH      24      //type, 22 bytes of channels, CRC
+
+//one entry per protocol, the encoder does nothing else than what is listed here
+typedef struct rcout_proto_t {
+    const char *name;
+    uint32_t baudRate;
+    uint32_t uartConfig;    //UART_CONFIG_* word length, parity, stop bits
+    uint8_t periodMs;
+    uint8_t header[3];      //bytes before the channel data
+    uint8_t headerSize;
+    uint8_t crcFrom;        //CRC8 (DVB-S2) from this byte to the end of the channel data, 0: no CRC
+    bool sbusTrailer;       //flags byte and end byte behind the channel data
+} rcout_proto_t;
+
+static const rcout_proto_t protos[RCOUT_MODE_COUNT] = {
+    { "off" },
+    { "sbus", 100000, UART_CONFIG_WLEN_8 | UART_CONFIG_PAR_EVEN | UART_CONFIG_STOP_TWO, 7,
+      { SBUS_START }, 1, 0, true },
+    { "crsf", 420000, UART_CONFIG_WLEN_8 | UART_CONFIG_PAR_NONE | UART_CONFIG_STOP_ONE, 4,
+      { CRSF_ADDR_MODULE, CRSF_RC_LENGTH, CRSF_TYPE_RC }, 3, 2, false },
+};
+
+//sources of the channels in us
+typedef enum rcout_src_t {
+    SRC_CENTER = 0,     //1500 us
+    SRC_LOW,            //1000 us, unused switches
+    SRC_ROLL,
+    SRC_PITCH,
+    SRC_THROTTLE,
+    SRC_ARM,            //1000 us disarmed, 2000 us armed
+    SRC_COUNT
+} rcout_src_t;
+
+//AETR and the arm switch on AUX1, yaw stays centered (the copter can not be turned)
+static const uint8_t channelMap[RCOUT_CHANNELS] = {
+    SRC_ROLL, SRC_PITCH, SRC_THROTTLE, SRC_CENTER, SRC_ARM, SRC_LOW, SRC_LOW, SRC_LOW,
+    SRC_LOW, SRC_LOW, SRC_LOW, SRC_LOW, SRC_LOW, SRC_LOW, SRC_LOW, SRC_LOW
+};
+
+//CRC8 with the polynomial 0xD5 (DVB-S2) as used by CRSF
+static const uint8_t crc8Table[256] = {
+    0x00, 0xD5, 0x7F, 0xAA, 0xFE, 0x2B, 0x81, 0x54, 0x29, 0xFC, 0x56, 0x83, 0xD7, 0x02, 0xA8, 0x7D,
+    0x52, 0x87, 0x2D, 0xF8, 0xAC, 0x79, 0xD3, 0x06, 0x7B, 0xAE, 0x04, 0xD1, 0x85, 0x50, 0xFA, 0x2F,
+    0xA4, 0x71, 0xDB, 0x0E, 0x5A, 0x8F, 0x25, 0xF0, 0x8D, 0x58, 0xF2, 0x27, 0x73, 0xA6, 0x0C, 0xD9,
+    0xF6, 0x23, 0x89, 0x5C, 0x08, 0xDD, 0x77, 0xA2, 0xDF, 0x0A, 0xA0, 0x75, 0x21, 0xF4, 0x5E, 0x8B,
+    0x9D, 0x48, 0xE2, 0x37, 0x63, 0xB6, 0x1C, 0xC9, 0xB4, 0x61, 0xCB, 0x1E, 0x4A, 0x9F, 0x35, 0xE0,
+    0xCF, 0x1A, 0xB0, 0x65, 0x31, 0xE4, 0x4E, 0x9B, 0xE6, 0x33, 0x99, 0x4C, 0x18, 0xCD, 0x67, 0xB2,
+    0x39, 0xEC, 0x46, 0x93, 0xC7, 0x12, 0xB8, 0x6D, 0x10, 0xC5, 0x6F, 0xBA, 0xEE, 0x3B, 0x91, 0x44,
+    0x6B, 0xBE, 0x14, 0xC1, 0x95, 0x40, 0xEA, 0x3F, 0x42, 0x97, 0x3D, 0xE8, 0xBC, 0x69, 0xC3, 0x16,
+    0xEF, 0x3A, 0x90, 0x45, 0x11, 0xC4, 0x6E, 0xBB, 0xC6, 0x13, 0xB9, 0x6C, 0x38, 0xED, 0x47, 0x92,
+    0xBD, 0x68, 0xC2, 0x17, 0x43, 0x96, 0x3C, 0xE9, 0x94, 0x41, 0xEB, 0x3E, 0x6A, 0xBF, 0x15, 0xC0,
+    0x4B, 0x9E, 0x34, 0xE1, 0xB5, 0x60, 0xCA, 0x1F, 0x62, 0xB7, 0x1D, 0xC8, 0x9C, 0x49, 0xE3, 0x36,
+    0x19, 0xCC, 0x66, 0xB3, 0xE7, 0x32, 0x98, 0x4D, 0x30, 0xE5, 0x4F, 0x9A, 0xCE, 0x1B, 0xB1, 0x64,
+    0x72, 0xA7, 0x0D, 0xD8, 0x8C, 0x59, 0xF3, 0x26, 0x5B, 0x8E, 0x24, 0xF1, 0xA5, 0x70, 0xDA, 0x0F,
+    0x20, 0xF5, 0x5F, 0x8A, 0xDE, 0x0B, 0xA1, 0x74, 0x09, 0xDC, 0x76, 0xA3, 0xF7, 0x22, 0x88, 0x5D,
+    0xD6, 0x03, 0xA9, 0x7C, 0x28, 0xFD, 0x57, 0x82, 0xFF, 0x2A, 0x80, 0x55, 0x01, 0xD4, 0x7E, 0xAB,
+    0x84, 0x51, 0xFB, 0x2E, 0x7A, 0xAF, 0x05, 0xD0, 0xAD, 0x78, 0xD2, 0x07, 0x53, 0x86, 0x2C, 0xF9,
+};
+
+//latest controls of the control task in us, read by the Clock function
+static uint16_t controls[SRC_COUNT] = { 1500, 1000, 1500, 1500, 1000, 1000 };
+static uint32_t controlsTick = 0;
+
+static const uint16_t failsafeControls[SRC_COUNT] = { 1500, 1000, 1500, 1500, 1000, 1000 };
+
+//frame the uDMA is reading, only written while no transfer runs
+static uint8_t frame[RCOUT_FRAME_MAX];
+
+static volatile rcout_mode_t mode = RCOUT_OFF;
+static rcout_stats_t stats;
+static Clock_Struct frameClock;
+
+//hands the controls of one sample to the output, called by the control task for every sample
+void rcout_setControls(uint16_t roll, uint16_t pitch, uint16_t throttle, bool armed)
+{
+    UInt key = Hwi_disable();
+    controls[SRC_ROLL] = roll;
+    controls[SRC_PITCH] = pitch;
+    controls[SRC_THROTTLE] = throttle;
+    controls[SRC_ARM] = armed ? 2000 : 1000;
+    controlsTick = Clock_getTicks();
+    Hwi_restore(key);
+}
+
+//us to the 11 bit channel value, 1000-2000 us map to 192-1792
+static RAMFUNC uint16_t channel_value(uint16_t us)
+{
+    int32_t value = RCOUT_VALUE_CENTER + ((int32_t)us - 1500) * 8 / 5;
+
+    if(value < RCOUT_VALUE_MIN)
+    {
+        return RCOUT_VALUE_MIN;
+    }
+    if(value > RCOUT_VALUE_MAX)
+    {
+        return RCOUT_VALUE_MAX;
+    }
+    return value;
+}
+
+//builds the frame of the protocol from the sources, returns its size
+static RAMFUNC uint8_t encode(const rcout_proto_t *proto, const uint16_t *sources, bool failsafe)
+{
+    uint32_t bits = 0;
+    uint8_t bitCount = 0;
+    uint8_t size = proto->headerSize;
+    uint8_t crc = 0;
+    uint8_t i;
+
+    memcpy(frame, proto->header, proto->headerSize);
+
+    //channels as one little endian bit stream, 11 bits each
+    for(i = 0; i < RCOUT_CHANNELS; i++)
+    {
+        bits |= (uint32_t)channel_value(sources[channelMap[i]]) << bitCount;
+        bitCount += RCOUT_CHANNEL_BITS;
+        while(bitCount >= 8)
+        {
+            frame[size++] = bits;
+            bits >>= 8;
+            bitCount -= 8;
+        }
+    }
+
+    if(proto->crcFrom != 0)
+    {
+        for(i = proto->crcFrom; i < size; i++)
+        {
+            crc = crc8Table[crc ^ frame[i]];
+        }
+        frame[size++] = crc;
+    }
+    if(proto->sbusTrailer)
+    {
+        frame[size++] = failsafe ? (SBUS_FLAG_LOST | SBUS_FLAG_FAILSAFE) : 0;
+        frame[size++] = SBUS_END;
+    }
+    return size;
+}
+
+/*
+ *  Clock function, every frame period of the protocol: encodes the latest controls and starts the uDMA
+ */
+static RAMFUNC void frame_tick(UArg arg0)
+{
+    uint16_t sources[SRC_COUNT];
+    bool failsafe;
+    uint8_t size;
+    UInt key;
+
+    if(mode == RCOUT_OFF)
+    {
+        return;
+    }
+    if(uDMAChannelIsEnabled(RCOUT_DMA_CHANNEL))
+    {
+        stats.overruns++; //the module gets the next frame one period later
+        metrics_inc(MET_RCOUT_OVERRUNS);
+        return;
+    }
+
+    key = Hwi_disable();
+    failsafe = Clock_getTicks() - controlsTick > RCOUT_STALE_MS;
+    memcpy(sources, failsafe ? failsafeControls : controls, sizeof(sources));
+    Hwi_restore(key);
+
+    size = encode(&protos[mode], sources, failsafe);
+    uDMAChannelTransferSet(RCOUT_DMA_CHANNEL | UDMA_PRI_SELECT, UDMA_MODE_BASIC, frame,
+                           (void *)(RCOUT_UART_BASE + UART_O_DR), size);
+    uDMAChannelEnable(RCOUT_DMA_CHANNEL);
+
+    stats.frames++;
+    metrics_inc(MET_RCOUT_FRAMES);
+    if(failsafe)
+    {
+        stats.failsafes++;
+    }
+}
+
+//switches the protocol, RCOUT_OFF stops the output; a frame that is being sent is finished first
+//must be called from Task context
+void rcout_setMode(rcout_mode_t newMode)
+{
+    const rcout_proto_t *proto = &protos[newMode];
+    Clock_Handle clock = Clock_handle(&frameClock);
+    Types_FreqHz freq;
+
+    Clock_stop(clock);
+    mode = RCOUT_OFF;
+    while(uDMAChannelIsEnabled(RCOUT_DMA_CHANNEL) || UARTBusy(RCOUT_UART_BASE))
+    {
+        Task_sleep(1);
+    }
+    if(newMode == RCOUT_OFF)
+    {
+        UARTDisable(RCOUT_UART_BASE);
+        return;
+    }
+
+    BIOS_getCpuFreq(&freq);
+    UARTConfigSetExpClk(RCOUT_UART_BASE, freq.lo, proto->baudRate, proto->uartConfig);
+    UARTFIFOLevelSet(RCOUT_UART_BASE, UART_FIFO_TX4_8, UART_FIFO_RX4_8); //DMA bursts of 4 into at least 8 free entries
+    UARTDMAEnable(RCOUT_UART_BASE, UART_DMA_TX);
+
+    Clock_setPeriod(clock, proto->periodMs);
+    Clock_setTimeout(clock, proto->periodMs);
+    mode = newMode;
+    Clock_start(clock);
+}
+
+rcout_mode_t rcout_getMode(void)
+{
+    return mode;
+}
+
+void rcout_getStats(rcout_stats_t *copy)
+{
+    UInt key = Hwi_disable();
+    *copy = stats;
+    Hwi_restore(key);
+}
+
+static void cmd_rcout(uint8_t argc, char *argv[])
+{
+    rcout_stats_t copy;
+    uint8_t i;
+
+    if(argc == 2)
+    {
+        for(i = 0; i < RCOUT_MODE_COUNT && strcmp(argv[1], protos[i].name) != 0; i++)
+        {}
+        if(i == RCOUT_MODE_COUNT)
+        {
+            console_printf("usage: rcout [off|sbus|crsf]\r\n");
+            return;
+        }
+        rcout_setMode((rcout_mode_t)i);
+    }
+
+    rcout_getStats(&copy);
+    console_printf("%s", protos[mode].name);
+    if(mode != RCOUT_OFF)
+    {
+        console_printf(" at %u baud every %u ms", protos[mode].baudRate, protos[mode].periodMs);
+    }
+    console_printf(", %u frames (%u failsafe), %u overruns\r\n", copy.frames, copy.failsafes, copy.overruns);
+}
+
+static const console_cmd_t rcoutCmd = { "rcout", "wired RC output: off|sbus|crsf", cmd_rcout };
+
+/*
+ *  Sets up UART3 (TX only) and its uDMA channel, the output stays off until a protocol is selected
+ *  Board_initDMA must have been called
+ */
+void setUpRcOut(void)
+{
+    //A5 = U3TX to the transmitter module, nothing is received
+    SysCtlPeripheralEnable(SYSCTL_PERIPH_GPIOA);
+    SysCtlPeripheralEnable(SYSCTL_PERIPH_UART3);
+    GPIOPinConfigure(GPIO_PA5_U3TX);
+    GPIOPinTypeUART(GPIO_PORTA_BASE, GPIO_PIN_5);
+
+    uDMAChannelAssign(UDMA_CH17_UART3TX);
+    uDMAChannelAttributeDisable(RCOUT_DMA_CHANNEL, UDMA_ATTR_ALL);
+    uDMAChannelControlSet(RCOUT_DMA_CHANNEL | UDMA_PRI_SELECT,
+                          UDMA_SIZE_8 | UDMA_SRC_INC_8 | UDMA_DST_INC_NONE | UDMA_ARB_4);
+
+    Clock_Params clockParams;
+    Clock_Params_init(&clockParams);
+    clockParams.period = protos[RCOUT_CRSF].periodMs;
+    clockParams.startFlag = FALSE;
+    Clock_construct(&frameClock, (Clock_FuncPtr) frame_tick, protos[RCOUT_CRSF].periodMs, &clockParams);
+
+    console_addCommand(&rcoutCmd);
+}
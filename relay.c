@@ -0,0 +1,334 @@
+/*
+ * relay.c
+ *
+ *  Created on: 19.10.2026
+ *
+ *  Relay mode: a PC script or simulator sends MSP frames on Board_UART0 (virtual COM port) and the
+ *  handset forwards them to the copter on UART6, the sticks of the handset are ignored meanwhile.
+ *  Cut-through forwarding in the UART0 receive interrupt: once the header of a frame is checked
+ *  ("$M<", size), the header and then every further byte is written into the UART6 FIFO as soon as
+ *  it arrives. No buffering of the whole frame, no re-encoding, no task in between. The checksum is
+ *  checked when the last byte passed, a bad frame is counted (the copter drops it as well).
+ *  Added latency per frame: from entering the interrupt that completed the header to the first byte
+ *  in the UART6 FIFO, observed in the relay_us histogram of the metrics.
+ *  Console: relay on (UART0 leaves the console until "+++" arrives between frames), relay shows the counters.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include <driverlib/uart.h>
+#include <inc/hw_ints.h>
+#include <inc/hw_memmap.h>
+
+#include <xdc/std.h>
+#include <xdc/runtime/Timestamp.h>
+#include <xdc/runtime/Types.h>
+
+#include <ti/sysbios/BIOS.h>
+#include <ti/sysbios/hal/Hwi.h>
+#include <ti/sysbios/knl/Clock.h>
+#include <ti/sysbios/knl/Semaphore.h>
+
+#include <bluetooth.h>
+#include <console.h>
+#include <metrics.h>
+#include <ramfunc.h>
+#include <relay.h>
+
+#define MSP_HEADER_SIZE 5   //'$', 'M', '<', size, command
+
+typedef enum relay_state_t {
+    RELAY_IDLE = 0,     //between frames, waits for '$'
+    RELAY_HEADER,       //collects the header
+    RELAY_FORWARD,      //header sent, every byte goes out directly
+    RELAY_SKIP          //frame could not be sent, its bytes are dropped
+} relay_state_t;
+
+static relay_state_t state = RELAY_IDLE;
+static uint8_t header[MSP_HEADER_SIZE];
+static uint8_t headerLen;
+static uint8_t remaining;           //payload bytes and checksum still to come
+static uint8_t checksum;
+static uint8_t exitCount;           //RELAY_EXIT_CHAR in a row between frames
+static uint32_t ticksPerUs;
+static volatile uint32_t lastFrame; //Clock tick of the last complete frame
+
+static relay_stats_t stats;
+
+//the frames go to the copter of the RN4871 (BT_LINK_MODULE), whatever the route of the sticks
+static bt_link_t *link;
+static uint32_t uartBase;
+
+static Hwi_Struct relayHwi;
+static Clock_Struct timeoutClock;
+static Semaphore_Struct exitSem;    //posted by the interrupt on "+++"
+
+//the frame can not go out (completely), its remaining bytes are dropped
+static void stall(void)
+{
+    stats.stalls++;
+    metrics_inc(MET_RELAY_ERRORS);
+    state = RELAY_SKIP;
+}
+
+//the header is checked: writes it into the UART FIFO of the link, the rest of the frame follows byte by byte
+static void start_frame(uint32_t entry)
+{
+    uint32_t us;
+    uint8_t i;
+
+    //the failsafe frame of timeout_tick (16 bytes) may still fill the FIFO, the header needs it empty
+    if(!bt_txReady(link) || UARTBusy(uartBase))
+    {
+        stall();    //no waiting in the interrupt, the next frame is newer anyway
+        return;
+    }
+    for(i = 0; i < MSP_HEADER_SIZE; i++)
+    {
+        if(!UARTCharPutNonBlocking(uartBase, header[i]))
+        {
+            stall();
+            return;
+        }
+    }
+    us = (Timestamp_get32() - entry) / ticksPerUs;
+    metrics_observe(MET_HIST_RELAY_US, us);
+    if(us > stats.maxUs)
+    {
+        stats.maxUs = us;
+    }
+    stats.bytes += MSP_HEADER_SIZE;
+    checksum = header[3] ^ header[4];
+    state = RELAY_FORWARD;
+}
+
+static void end_frame(uint8_t c)
+{
+    if(c == checksum)
+    {
+        stats.frames++;
+        metrics_inc(MET_RELAY_FRAMES);
+        lastFrame = Clock_getTicks();
+    }
+    else
+    {
+        stats.badChecksum++;
+        metrics_inc(MET_RELAY_ERRORS);
+    }
+    state = RELAY_IDLE;
+}
+
+static void reject(void)
+{
+    stats.rejected++;
+    metrics_inc(MET_RELAY_ERRORS);
+    state = RELAY_IDLE;
+}
+
+static RAMFUNC void relay_byte(uint8_t c, uint32_t entry)
+{
+    switch(state)
+    {
+        case RELAY_IDLE:
+            if(c == '$')
+            {
+                header[0] = c;
+                headerLen = 1;
+                exitCount = 0;
+                state = RELAY_HEADER;
+            }
+            else if(c == RELAY_EXIT_CHAR && ++exitCount == 3)
+            {
+                Semaphore_post(Semaphore_handle(&exitSem));
+            }
+            else if(c != RELAY_EXIT_CHAR)
+            {
+                exitCount = 0;
+            }
+            break;
+        case RELAY_HEADER:
+            header[headerLen++] = c;
+            if((headerLen == 2 && c != 'M') || (headerLen == 3 && c != '<') || (headerLen == 4 && c > RELAY_MAX_SIZE))
+            {
+                reject();
+            }
+            else if(headerLen == MSP_HEADER_SIZE)
+            {
+                remaining = header[3] + 1;
+                start_frame(entry);
+            }
+            break;
+        case RELAY_FORWARD:
+            if(!UARTCharPutNonBlocking(uartBase, c))
+            {
+                stats.stalls++; //UART6 slower than UART0, the copter resyncs on the next "$M<"
+                metrics_inc(MET_RELAY_ERRORS);
+                state = (--remaining == 0) ? RELAY_IDLE : RELAY_SKIP;
+                break;
+            }
+            stats.bytes++;
+            if(--remaining == 0)
+            {
+                end_frame(c);
+            }
+            else
+            {
+                checksum ^= c;
+            }
+            break;
+        case RELAY_SKIP:
+            if(--remaining == 0)
+            {
+                state = RELAY_IDLE;
+            }
+            break;
+    }
+}
+
+//UART0 receive interrupt, the FIFO is off so every byte comes in its own interrupt
+static RAMFUNC void relay_hwi(UArg arg0)
+{
+    uint32_t entry = Timestamp_get32();
+    int32_t c;
+
+    UARTIntClear(UART0_BASE, UARTIntStatus(UART0_BASE, true));
+    while((c = UARTCharGetNonBlocking(UART0_BASE)) != -1)
+    {
+        if(c & 0xF00)
+        {
+            //framing, parity, break or overrun error: the frame is broken, start over
+            if(state == RELAY_FORWARD || state == RELAY_HEADER)
+            {
+                reject();
+            }
+            continue;
+        }
+        relay_byte(c & 0xFF, entry);
+    }
+}
+
+//disarms the copter while the PC is silent, only between frames so no frame gets split
+static void timeout_tick(UArg arg0)
+{
+    UInt key;
+
+    if(Clock_getTicks() - lastFrame < RELAY_TIMEOUT_MS)
+    {
+        return;
+    }
+    key = Hwi_disable();
+    if(state == RELAY_IDLE)
+    {
+        bt_linkFailsafe(link);
+        stats.failsafes++;
+    }
+    Hwi_restore(key);
+}
+
+void relay_getStats(relay_stats_t *copy)
+{
+    UInt key = Hwi_disable();
+    *copy = stats;
+    Hwi_restore(key);
+}
+
+//runs the relay in the console task until "+++", UART0 belongs to the relay meanwhile
+static void run(void)
+{
+    Types_FreqHz freq;
+    Hwi_Params hwiParams;
+
+    Timestamp_getFreq(&freq);
+    ticksPerUs = freq.lo / 1000000;
+    memset(&stats, 0, sizeof(stats));
+    state = RELAY_IDLE;
+    exitCount = 0;
+    lastFrame = Clock_getTicks();
+
+    bt_setRelay(link, true);
+
+    BIOS_getCpuFreq(&freq);
+    UARTConfigSetExpClk(UART0_BASE, freq.lo, RELAY_BAUD,
+                        UART_CONFIG_WLEN_8 | UART_CONFIG_STOP_ONE | UART_CONFIG_PAR_NONE);
+    UARTFIFODisable(UART0_BASE); //one interrupt per byte, nothing waits for a FIFO level or the RX timeout
+
+    Hwi_Params_init(&hwiParams);
+    hwiParams.priority = RELAY_HWI_PRIORITY;
+    Hwi_construct(&relayHwi, INT_UART0, relay_hwi, &hwiParams, NULL);
+    UARTIntClear(UART0_BASE, UARTIntStatus(UART0_BASE, false));
+    UARTIntEnable(UART0_BASE, UART_INT_RX | UART_INT_OE | UART_INT_FE);
+    Clock_start(Clock_handle(&timeoutClock));
+
+    Semaphore_pend(Semaphore_handle(&exitSem), BIOS_WAIT_FOREVER);
+
+    Clock_stop(Clock_handle(&timeoutClock));
+    UARTIntDisable(UART0_BASE, UART_INT_RX | UART_INT_OE | UART_INT_FE);
+    Hwi_destruct(&relayHwi);
+    UARTDisable(UART0_BASE);
+
+    bt_setRelay(link, false);
+}
+
+static void print_stats(void)
+{
+    relay_stats_t copy;
+
+    relay_getStats(&copy);
+    console_printf("%u frames (%u bytes), %u rejected, %u bad checksum, %u stalls, %u failsafes\r\n",
+                   copy.frames, copy.bytes, copy.rejected, copy.badChecksum, copy.stalls, copy.failsafes);
+    console_printf("longest RX interrupt to TX start %u us, see metrics relay_us\r\n", copy.maxUs);
+}
+
+static void cmd_relay(uint8_t argc, char *argv[])
+{
+    if(argc == 1)
+    {
+        print_stats();
+    }
+    else if(strcmp(argv[1], "on") == 0)
+    {
+        if(!bt_isDataMode(link))
+        {
+            console_printf("the link is not in data mode\r\n");
+            return;
+        }
+        console_printf("relaying MSP frames at %u baud, +++ between frames ends it\r\n", RELAY_BAUD);
+        while(UARTBusy(UART0_BASE))
+        {}
+        console_suspend();
+        run();
+        if(!console_resume())
+        {
+            return;
+        }
+        console_printf("\r\nrelay off: ");
+        print_stats();
+    }
+    else
+    {
+        console_printf("usage: relay [on]\r\n");
+    }
+}
+
+static const console_cmd_t relayCmd = { "relay", "forward MSP frames of the PC to the copter: on", cmd_relay };
+
+void setUpRelay(void)
+{
+    link = bt_getLink(BT_LINK_MODULE);
+    uartBase = bt_uartBase(link);
+
+    Semaphore_Params semParams;
+    Semaphore_Params_init(&semParams);
+    semParams.mode = Semaphore_Mode_BINARY;
+    Semaphore_construct(&exitSem, 0, &semParams);
+
+    Clock_Params clockParams;
+    Clock_Params_init(&clockParams);
+    clockParams.period = RELAY_TIMEOUT_MS / 5;
+    clockParams.startFlag = FALSE;
+    Clock_construct(&timeoutClock, (Clock_FuncPtr) timeout_tick, RELAY_TIMEOUT_MS / 5, &clockParams);
+
+    console_addCommand(&relayCmd);
+}
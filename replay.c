@@ -0,0 +1,276 @@
+/*
+ * replay.c
+ *
+ *  Created on: 19.10.2026
+ *
+ *  Delta encoded ring for the joystick input stream (replay.h), no SYS/BIOS dependencies.
+ *  The ring is split into segments of REPLAY_SEG_SIZE bytes. A segment starts with a keyframe
+ *  (absolute time, ADC pair and caller state), every event after it only stores the difference
+ *  to the previous one, a sample at a steady stick takes 3 bytes instead of 12. When the ring is
+ *  full the oldest segment is dropped, playback always starts at a keyframe.
+ *
+ *  Encoding, tag byte: bits 7-6 kind, bits 5-0 time delta in ms (63: varint follows)
+ *    sample    tag, zigzag varint roll delta, zigzag varint pitch delta
+ *    button    tag, buttons
+ *    keyframe  0x80, time (4), roll (2), pitch (2), state (4), little endian
+ *    end       0xC0, the rest of the segment is unused
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include <replay.h>
+
+#define KIND_SAMPLE     0x00
+#define KIND_BUTTON     0x40
+#define KIND_KEYFRAME   0x80
+#define KIND_END        0xC0
+#define KIND_MASK       0xC0
+#define DT_MASK         0x3F
+#define DT_VARINT       0x3F
+
+#define MAX_EVENT_SIZE  (1 + 5 + 3 + 3)
+#define KEYFRAME_SIZE   13
+
+static uint8_t put_varint(uint8_t *data, uint32_t value)
+{
+    uint8_t n = 0;
+
+    while(value >= 0x80)
+    {
+        data[n++] = (value & 0x7F) | 0x80;
+        value >>= 7;
+    }
+    data[n++] = value;
+    return n;
+}
+
+static uint32_t get_varint(const uint8_t *data, uint16_t *pos)
+{
+    uint32_t value = 0;
+    uint8_t shift = 0;
+    uint8_t byte;
+
+    do
+    {
+        byte = data[(*pos)++];
+        value |= (uint32_t)(byte & 0x7F) << shift;
+        shift += 7;
+    } while((byte & 0x80) && shift < 35);
+    return value;
+}
+
+static uint32_t zigzag(int32_t value)
+{
+    return ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+}
+
+static int32_t unzigzag(uint32_t value)
+{
+    return (int32_t)(value >> 1) ^ -(int32_t)(value & 1);
+}
+
+static void put_le(uint8_t *data, uint32_t value, uint8_t size)
+{
+    while(size--)
+    {
+        *data++ = value;
+        value >>= 8;
+    }
+}
+
+static uint32_t get_le(const uint8_t *data, uint8_t size)
+{
+    uint32_t value = 0;
+
+    while(size--)
+    {
+        value = (value << 8) | data[size];
+    }
+    return value;
+}
+
+//encodes event relative to last, returns the size
+static uint8_t encode(uint8_t *data, const replay_event_t *last, const replay_event_t *event)
+{
+    uint32_t dt = event->time - last->time;
+    uint8_t n = 1;
+
+    if(dt < DT_VARINT)
+    {
+        data[0] = dt;
+    }
+    else
+    {
+        data[0] = DT_VARINT;
+        n += put_varint(&data[n], dt);
+    }
+
+    if(event->type == REPLAY_BUTTON)
+    {
+        data[0] |= KIND_BUTTON;
+        data[n++] = event->buttons;
+    }
+    else
+    {
+        data[0] |= KIND_SAMPLE;
+        n += put_varint(&data[n], zigzag((int32_t)event->roll - last->roll));
+        n += put_varint(&data[n], zigzag((int32_t)event->pitch - last->pitch));
+    }
+    return n;
+}
+
+//closes the head segment and starts the next one with a keyframe, drops the oldest if the ring is full
+static void new_segment(replay_ring_t *ring, const replay_event_t *event)
+{
+    uint8_t *seg;
+
+    if(ring->used > 0)
+    {
+        ring->buffer[ring->head * REPLAY_SEG_SIZE + ring->pos] = KIND_END;
+        ring->head = (ring->head + 1) % ring->segCount;
+    }
+    if(ring->used == ring->segCount)
+    {
+        ring->oldest = (ring->oldest + 1) % ring->segCount;
+        ring->overwritten++;
+    }
+    else
+    {
+        ring->used++;
+    }
+
+    ring->last.time = event->time;
+    ring->last.state = event->state;
+    if(event->type == REPLAY_SAMPLE)
+    {
+        ring->last.roll = event->roll;
+        ring->last.pitch = event->pitch;
+    }
+
+    seg = &ring->buffer[ring->head * REPLAY_SEG_SIZE];
+    seg[0] = KIND_KEYFRAME;
+    put_le(&seg[1], ring->last.time, 4);
+    put_le(&seg[5], ring->last.roll, 2);
+    put_le(&seg[7], ring->last.pitch, 2);
+    put_le(&seg[9], ring->last.state, 4);
+    ring->pos = KEYFRAME_SIZE;
+}
+
+//size must be a multiple of REPLAY_SEG_SIZE
+void replay_init(replay_ring_t *ring, uint8_t *buffer, uint32_t size)
+{
+    ring->buffer = buffer;
+    ring->segCount = size / REPLAY_SEG_SIZE;
+    replay_clear(ring);
+}
+
+void replay_clear(replay_ring_t *ring)
+{
+    ring->oldest = 0;
+    ring->head = 0;
+    ring->used = 0;
+    ring->pos = 0;
+    ring->events = 0;
+    ring->overwritten = 0;
+    memset(&ring->last, 0, sizeof(ring->last));
+    replay_rewind(ring);
+}
+
+//appends an event, never fails: the oldest segment makes room if the ring is full
+void replay_put(replay_ring_t *ring, const replay_event_t *event)
+{
+    uint8_t data[MAX_EVENT_SIZE];
+    uint8_t size = encode(data, &ring->last, event);
+
+    if(ring->used == 0 || ring->pos + size + 1 > REPLAY_SEG_SIZE) //one byte stays for the end tag
+    {
+        new_segment(ring, event);
+        size = encode(data, &ring->last, event);
+    }
+    memcpy(&ring->buffer[ring->head * REPLAY_SEG_SIZE + ring->pos], data, size);
+    ring->pos += size;
+
+    ring->last.time = event->time;
+    if(event->type == REPLAY_SAMPLE)
+    {
+        ring->last.roll = event->roll;
+        ring->last.pitch = event->pitch;
+    }
+    ring->events++;
+}
+
+//moves the playback cursor to the oldest event
+void replay_rewind(replay_ring_t *ring)
+{
+    ring->readSeg = ring->oldest;
+    ring->readPos = 0;
+}
+
+//decodes the next event, returns false at the end of the recording
+bool replay_next(replay_ring_t *ring, replay_event_t *event)
+{
+    const uint8_t *seg;
+    uint16_t limit;
+    uint8_t tag;
+    uint32_t dt;
+
+    if(ring->used == 0)
+    {
+        return false;
+    }
+    while(1)
+    {
+        seg = &ring->buffer[ring->readSeg * REPLAY_SEG_SIZE];
+        limit = (ring->readSeg == ring->head) ? ring->pos : REPLAY_SEG_SIZE;
+        if(ring->readPos >= limit || seg[ring->readPos] == KIND_END)
+        {
+            if(ring->readSeg == ring->head)
+            {
+                return false;
+            }
+            ring->readSeg = (ring->readSeg + 1) % ring->segCount;
+            ring->readPos = 0;
+            continue;
+        }
+
+        tag = seg[ring->readPos++];
+        if((tag & KIND_MASK) == KIND_KEYFRAME)
+        {
+            ring->readLast.time = get_le(&seg[ring->readPos], 4);
+            ring->readLast.roll = get_le(&seg[ring->readPos + 4], 2);
+            ring->readLast.pitch = get_le(&seg[ring->readPos + 6], 2);
+            ring->readLast.state = get_le(&seg[ring->readPos + 8], 4);
+            ring->readPos += KEYFRAME_SIZE - 1;
+            continue;
+        }
+
+        dt = tag & DT_MASK;
+        if(dt == DT_VARINT)
+        {
+            dt = get_varint(seg, &ring->readPos);
+        }
+        ring->readLast.time += dt;
+        if((tag & KIND_MASK) == KIND_BUTTON)
+        {
+            ring->readLast.type = REPLAY_BUTTON;
+            ring->readLast.buttons = seg[ring->readPos++];
+        }
+        else
+        {
+            ring->readLast.type = REPLAY_SAMPLE;
+            ring->readLast.buttons = 0;
+            ring->readLast.roll += unzigzag(get_varint(seg, &ring->readPos));
+            ring->readLast.pitch += unzigzag(get_varint(seg, &ring->readPos));
+        }
+        *event = ring->readLast;
+        return true;
+    }
+}
+
+//bytes in use, for the status output
+uint32_t replay_bytes(const replay_ring_t *ring)
+{
+    return (ring->used > 0) ? (uint32_t)(ring->used - 1) * REPLAY_SEG_SIZE + ring->pos : 0;
+}
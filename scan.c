@@ -0,0 +1,289 @@
+/*
+ * scan.c
+ *
+ *  Created on: 19.10.2026
+ *
+ *  Discovery of advertising copters with the RN4871 scan ("F"), ranked by RSSI.
+ *  The pilot selects a copter with the EDUMKII buttons (up/down, select confirms),
+ *  the choice is cached in the configuration (config.c) so later boots connect without scanning.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include <xdc/std.h>
+#include <xdc/runtime/System.h>
+
+#include <ti/sysbios/knl/Clock.h>
+
+#include <btcmd.h>
+#include <config.h>
+#include <connection.h>
+#include <executor.h>
+#include <joystick.h>
+#include <scan.h>
+
+//devices found during the scan, sorted by RSSI (strongest first)
+static scan_device_t devices[SCAN_MAX_DEVICES];
+static uint8_t deviceCount = 0;
+static volatile bool scanning = false;
+static int8_t selected = -1;
+
+static btcmd_t cmdScan = { "F\r", "Scanning", CONN_CMD_TIMEOUT_MS };
+static btcmd_t cmdScanStop = { "X\r", "AOK", CONN_CMD_TIMEOUT_MS };
+
+static bool is_hex(char c)
+{
+    return (c >= '0' && c <= '9') || (c >= 'A' && c <= 'F') || (c >= 'a' && c <= 'f');
+}
+
+static uint8_t hex_value(char c)
+{
+    if(c >= '0' && c <= '9')
+    {
+        return c - '0';
+    }
+    if(c >= 'a' && c <= 'f')
+    {
+        return c - 'a' + 10;
+    }
+    return c - 'A' + 10;
+}
+
+//RSSI is reported in hex, either with a sign ("-3C") or as two's complement ("C4")
+static int8_t parse_rssi(const char *text)
+{
+    bool negative = false;
+    uint8_t value = 0;
+
+    if(*text == '-')
+    {
+        negative = true;
+        text++;
+    }
+    while(is_hex(*text))
+    {
+        value = (value << 4) | hex_value(*text);
+        text++;
+    }
+    return negative ? -(int8_t)value : (int8_t)value;
+}
+
+//inserts or updates a device, the table stays sorted and keeps the strongest devices only
+static void add_device(const scan_device_t *device)
+{
+    uint8_t i;
+    uint8_t pos;
+
+    //a device advertises repeatedly, remove the old entry first
+    for(i = 0; i < deviceCount; i++)
+    {
+        if(strcmp(devices[i].mac, device->mac) == 0)
+        {
+            memmove(&devices[i], &devices[i + 1], (deviceCount - i - 1) * sizeof(scan_device_t));
+            deviceCount--;
+            break;
+        }
+    }
+
+    for(pos = 0; pos < deviceCount && devices[pos].rssi >= device->rssi; pos++)
+    {}
+    if(pos >= SCAN_MAX_DEVICES)
+    {
+        return; //weaker than all kept devices
+    }
+    if(deviceCount == SCAN_MAX_DEVICES)
+    {
+        deviceCount--; //drop the weakest
+    }
+    memmove(&devices[pos + 1], &devices[pos], (deviceCount - pos) * sizeof(scan_device_t));
+    devices[pos] = *device;
+    deviceCount++;
+}
+
+//scan result "%<mac>,<address type>,<name>,<UUIDs>,<RSSI>%"
+//returns true if the line was a scan result, the first part of a split result is consumed but not listed
+bool scan_onEvent(const char *line)
+{
+    scan_device_t device;
+    const char *field;
+    const char *rssi;
+    size_t len = strlen(line);
+    uint8_t i;
+
+    if(line[0] != '%' || len < BT_MAC_LEN + 4 || line[BT_MAC_LEN + 1] != ',')
+    {
+        return false;
+    }
+    for(i = 0; i < BT_MAC_LEN; i++)
+    {
+        if(!is_hex(line[i + 1]))
+        {
+            return false;
+        }
+    }
+    if(!scanning || line[len - 1] != '%')
+    {
+        return true; //a line cut at BT_LINE_SIZE ends inside the UUIDs, its last field is no RSSI
+    }
+
+    memcpy(device.mac, &line[1], BT_MAC_LEN);
+    device.mac[BT_MAC_LEN] = '\0';
+    device.addrType = line[BT_MAC_LEN + 2] - '0';
+
+    field = &line[BT_MAC_LEN + 4];
+    for(i = 0; i < SCAN_NAME_LEN && field[i] != ',' && field[i] != '%' && field[i] != '\0'; i++)
+    {
+        device.name[i] = field[i];
+    }
+    device.name[i] = '\0';
+
+    rssi = strrchr(line, ',');
+    if(rssi == NULL || rssi < field)
+    {
+        return true; //no RSSI field
+    }
+    device.rssi = parse_rssi(rssi + 1);
+
+    add_device(&device);
+    return true;
+}
+
+static void print_devices(int8_t cursor)
+{
+    uint8_t i;
+
+    System_printf("Copters found:\n");
+    for(i = 0; i < deviceCount; i++)
+    {
+        System_printf("%c %u: %s %-12s %d dBm\n", (i == cursor) ? '>' : ' ', i + 1,
+                      devices[i].mac, devices[i].name, devices[i].rssi);
+    }
+    System_flush();
+}
+
+//child job of the connection manager, the module must be in command mode
+//scans for SCAN_DURATION_MS and lets the pilot select one of the found copters
+int scan_job(exec_job_t *job)
+{
+    static uint32_t deadline;
+    static int8_t cursor;
+    uint8_t buttons;
+
+    JOB_BEGIN(job);
+
+    deviceCount = 0;
+    selected = -1;
+    scanning = true;
+    btcmd_submit(&cmdScan);
+    JOB_WAIT_UNTIL(job, btcmd_done(&cmdScan));
+    if(cmdScan.status != BTCMD_OK)
+    {
+        scanning = false;
+        System_printf("Scan failed\n");
+        System_flush();
+        JOB_EXIT(job);
+    }
+    System_printf("Scanning for copters...\n");
+    System_flush();
+
+    JOB_SLEEP(job, SCAN_DURATION_MS);
+    scanning = false;
+    btcmd_submit(&cmdScanStop);
+    JOB_WAIT_UNTIL(job, btcmd_done(&cmdScanStop));
+
+    if(deviceCount == 0)
+    {
+        System_printf("No copters found\n");
+        System_flush();
+        JOB_EXIT(job);
+    }
+    if(deviceCount == 1)
+    {
+        selected = 0;
+        print_devices(selected);
+        JOB_EXIT(job);
+    }
+
+    //pilot selects: up/down move the cursor, select confirms
+    JOB_WAIT_UNTIL(job, joystick_enterMenu()); //the stick calibration may hold the buttons
+    cursor = 0;
+    print_devices(cursor);
+    deadline = Clock_getTicks() + SCAN_SELECT_TIMEOUT_MS;
+    while(selected < 0)
+    {
+        JOB_WAIT_UNTIL(job, joystick_buttonsPending() || (int32_t)(Clock_getTicks() - deadline) >= 0);
+        buttons = joystick_takeButtons();
+        if(buttons == 0)
+        {
+            selected = 0; //timeout, take the strongest
+        }
+        else if(buttons & JS_BTN_SELECT)
+        {
+            selected = cursor;
+        }
+        else
+        {
+            if((buttons & JS_BTN_UP) && cursor > 0)
+            {
+                cursor--;
+            }
+            if((buttons & JS_BTN_DOWN) && cursor < deviceCount - 1)
+            {
+                cursor++;
+            }
+            print_devices(cursor);
+        }
+    }
+    joystick_leaveMenu();
+
+    System_printf("Selected copter %s\n", devices[selected].mac);
+    System_flush();
+
+    JOB_END(job);
+}
+
+//copter selected by the last scan, returns false if none was selected
+bool scan_getSelected(scan_device_t *device)
+{
+    if(selected < 0)
+    {
+        return false;
+    }
+    *device = devices[selected];
+    return true;
+}
+
+//reads the cached copter from the configuration, returns false if there is none
+bool scan_loadCached(scan_device_t *device)
+{
+    if(config->copter.mac[0] == '\0')
+    {
+        return false;
+    }
+    strcpy(device->mac, config->copter.mac);
+    device->addrType = config->copter.addrType;
+    strcpy(device->name, config->copter.name);
+    device->rssi = 0;
+    return true;
+}
+
+//caches the copter for the next boot
+void scan_storeCached(const scan_device_t *device)
+{
+    cfg_copter_t copter;
+
+    if(strcmp(config->copter.mac, device->mac) == 0 && config->copter.addrType == device->addrType)
+    {
+        return; //already cached, spares the EEPROM
+    }
+    strcpy(copter.mac, device->mac);
+    copter.addrType = device->addrType;
+    strcpy(copter.name, device->name);
+    if(!config_set(CFG_KEY_COPTER, &copter))
+    {
+        System_printf("Copter not cached\n");
+        System_flush();
+    }
+}
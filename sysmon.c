@@ -0,0 +1,224 @@
+/*
+ * sysmon.c
+ *
+ *  Created on: 19.10.2026
+ *
+ *  System monitoring, reported by a job of the housekeeping executor.
+ *  CPU load is measured by the SYS/BIOS Load module (time spent in the idle loop),
+ *  the per-task load is read for every task that registered itself.
+ *  Stack high-water marks rely on Task.initStackFlag: every stack is filled with
+ *  0xBE at creation and Task_stat scans for the first overwritten byte.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include <xdc/std.h>
+#include <xdc/runtime/Error.h>
+#include <xdc/runtime/Memory.h>
+#include <xdc/runtime/System.h>
+#include <xdc/runtime/Timestamp.h>
+#include <xdc/runtime/Types.h>
+
+#include <ti/sysbios/BIOS.h>
+#include <ti/sysbios/hal/Hwi.h>
+#include <ti/sysbios/knl/Clock.h>
+#include <ti/sysbios/knl/Task.h>
+#include <ti/sysbios/utils/Load.h>
+
+#include <executor.h>
+#include <metrics.h>
+#include <sysmon.h>
+#include <tasks.h>
+
+typedef struct sysmon_task_t {
+    Task_Handle handle;
+    const char *name;
+} sysmon_task_t;
+
+static sysmon_task_t tasks[SYSMON_MAX_TASKS];
+static uint8_t taskCount = 0;
+
+static void (*reports[SYSMON_MAX_REPORTS])(void);
+static uint8_t reportCount = 0;
+
+static exec_job_t sysmonJob;
+
+//boot time measurement: main to BIOS_start with the timestamp counter (before the Clock runs),
+//all later milestones in Clock ticks (ms) after BIOS_start
+static uint32_t bootMainTimestamp;
+static uint32_t bootPreBiosUs;
+static uint32_t bootMarks[BOOT_MARK_COUNT];
+static bool bootMarked[BOOT_MARK_COUNT];
+static bool bootReported = false;
+
+static const char *bootNames[BOOT_MARK_COUNT] = {
+    "BIOS started",
+    "ADC calibrated",
+    "UART open",
+    "BLE powered",
+    "connected",
+    "first frame",
+};
+
+//must be called in main right after the system clock is set
+void sysmon_bootStart(void)
+{
+    bootMainTimestamp = Timestamp_get32();
+}
+
+//records the time of a boot milestone, only the first call per milestone counts
+void sysmon_bootMark(sysmon_boot_t mark)
+{
+    if(bootMarked[mark])
+    {
+        return;
+    }
+    if(mark == BOOT_BIOS_START)
+    {
+        Types_FreqHz freq;
+        Timestamp_getFreq(&freq);
+        bootPreBiosUs = (Timestamp_get32() - bootMainTimestamp) / (freq.lo / 1000000);
+    }
+    bootMarks[mark] = Clock_getTicks();
+    bootMarked[mark] = true;
+}
+
+//prints all boot milestones once the first control frame was sent
+static void report_boot(void)
+{
+    uint8_t i;
+
+    if(bootReported || !bootMarked[BOOT_FIRST_FRAME])
+    {
+        return;
+    }
+    System_printf("Boot: main -> BIOS_start %u us\n", bootPreBiosUs);
+    for(i = BOOT_BIOS_START + 1; i < BOOT_MARK_COUNT; i++)
+    {
+        System_printf("  %-16s %5u ms\n", bootNames[i], bootMarks[i]);
+    }
+    System_flush();
+    bootReported = true;
+}
+
+//adds a task to the load report, must be called before BIOS_start
+void sysmon_registerTask(Task_Handle handle, const char *name)
+{
+    if(taskCount >= SYSMON_MAX_TASKS)
+    {
+        System_printf("sysmon: too many tasks, %s not monitored\n", name);
+        System_flush();
+        return;
+    }
+    tasks[taskCount].handle = handle;
+    tasks[taskCount].name = name;
+    taskCount++;
+}
+
+//name a task was registered with, NULL if it is not monitored
+const char *sysmon_taskName(Task_Handle handle)
+{
+    uint8_t i;
+
+    for(i = 0; i < taskCount; i++)
+    {
+        if(tasks[i].handle == handle)
+        {
+            return tasks[i].name;
+        }
+    }
+    return NULL;
+}
+
+//prints the stack high-water mark of one task and warns if it gets close to the end
+static void report_stack(const char *name, Task_Handle handle)
+{
+    Task_Stat stat;
+    Task_stat(handle, &stat);
+
+    System_printf("  %-12s stack %4u/%4u%s\n", name, stat.used, stat.stackSize,
+                  (stat.used * 100 >= stat.stackSize * SYSMON_STACK_WARN_PERCENT) ? " !" : "");
+}
+
+//prints total CPU load and the load of every registered task
+//the headroom is what is left until the idle task does not run anymore
+void sysmon_report(void)
+{
+    Load_Stat stat;
+    uint32_t cpuLoad = Load_getCPULoad();
+
+    metrics_set(MET_CPU_LOAD, cpuLoad);    uint8_t i;
+
+    System_printf("CPU load: %u%% (headroom %u%%)\n", cpuLoad, 100 - cpuLoad);
+    for(i = 0; i < taskCount; i++)
+    {
+        if(Load_getTaskLoad(tasks[i].handle, &stat))
+        {
+            System_printf("  %-12s %u%%\n", tasks[i].name, Load_calculateLoad(&stat));
+        }
+    }
+    System_flush();
+}
+
+//prints the stack high-water marks of all registered tasks, the idle task,
+//the Hwi/system stack and the usage of the default heap
+void sysmon_reportMemory(void)
+{
+    Hwi_StackInfo hwiStack;
+    Memory_Stats heap;
+    uint8_t i;
+
+    System_printf("Stack usage (used/size):\n");
+    for(i = 0; i < taskCount; i++)
+    {
+        report_stack(tasks[i].name, tasks[i].handle);
+    }
+    report_stack("idle", Task_getIdleTask());
+
+    Hwi_getStackInfo(&hwiStack, TRUE);
+    System_printf("  %-12s stack %4u/%4u\n", "hwi", hwiStack.hwiStackPeak, hwiStack.hwiStackSize);
+
+    Memory_getStats(NULL, &heap);
+    System_printf("Heap: %u of %u bytes used, largest free block %u\n",
+                  heap.totalSize - heap.totalFreeSize, heap.totalSize, heap.largestFreeSize);
+    System_flush();
+}
+
+//adds the report of another module to the periodic reports, must be called before BIOS_start
+void sysmon_addReport(void (*report)(void))
+{
+    if(reportCount >= SYSMON_MAX_REPORTS)
+    {
+        System_printf("sysmon: too many reports\n");
+        System_flush();
+        return;
+    }
+    reports[reportCount++] = report;
+}
+
+//executor job: prints the reports every HOUSEKEEPING_PERIOD_MS
+static int sysmon_job(exec_job_t *job)
+{
+    uint8_t i;
+
+    JOB_BEGIN(job);
+    while(1)
+    {
+        JOB_SLEEP(job, HOUSEKEEPING_PERIOD_MS);
+        report_boot();
+        sysmon_report();
+        sysmon_reportMemory();
+        for(i = 0; i < reportCount; i++)
+        {
+            reports[i]();
+        }
+    }
+    JOB_END(job);
+}
+
+//starts the periodic reports, the housekeeping task must be set up before
+void sysmon_start(void)
+{
+    exec_add(&sysmonJob, sysmon_job, "sysmon");
+}
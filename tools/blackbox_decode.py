@@ -0,0 +1,132 @@
+#!/usr/bin/env python3
+"""Decodes a flight recorder file (BBnnnn.BIN from the SD card) into CSV files.
+
+One CSV per record type is written next to the prefix:
+<prefix>_sticks.csv, <prefix>_frames.csv, <prefix>_telemetry.csv, <prefix>_link.csv
+
+    python3 blackbox_decode.py BB0003.BIN
+    python3 blackbox_decode.py BB0003.BIN --prefix flight3
+
+The record format is described in local_inc/blackbox.h.
+"""
+
+import argparse
+import csv
+import os
+import struct
+import sys
+
+BB_PAD, BB_START, BB_SYNC, BB_STICKS, BB_FRAME, BB_TELEMETRY, BB_LINK = range(7)
+BB_MAGIC = 0x31584242
+
+HEADER = struct.Struct("<BBH")
+START = struct.Struct("<IHHIHH")
+SYNC = struct.Struct("<II")
+STICKS = struct.Struct("<HHHHHBB")
+LINK = struct.Struct("<8I")
+
+LINK_FIELDS = ["link_up", "frames_sent", "tx_dropped", "rts_stalls", "rx_bytes", "reconnects",
+               "deadline_misses", "cpu_load"]
+
+
+class Clock:
+    """Extends the 16 bit record times with the last full tick of a start/sync record."""
+
+    def __init__(self):
+        self.tick = 0
+
+    def sync(self, tick):
+        self.tick = tick
+
+    def extend(self, time16):
+        tick = (self.tick & ~0xFFFF) | time16
+        if tick < self.tick:
+            tick += 0x10000
+        self.tick = tick
+        return tick
+
+
+def records(data):
+    """Yields (type, time16, payload) of all records, block by block."""
+    if len(data) < HEADER.size + START.size:
+        sys.exit("file too short")
+    kind, size, _ = HEADER.unpack_from(data, 0)
+    magic, version, block_size, _, _, _ = START.unpack_from(data, HEADER.size)
+    if kind != BB_START or magic != BB_MAGIC:
+        sys.exit("not a blackbox file")
+    if version != 1:
+        print("warning: file version %d, decoder knows version 1" % version, file=sys.stderr)
+
+    for base in range(0, len(data), block_size):
+        block = data[base:base + block_size]
+        pos = 0
+        while pos + HEADER.size <= len(block):
+            kind, size, time16 = HEADER.unpack_from(block, pos)
+            if kind == BB_PAD:
+                break
+            payload = block[pos + HEADER.size:pos + HEADER.size + size]
+            if len(payload) < size:
+                print("warning: cut record at offset %d" % (base + pos), file=sys.stderr)
+                break
+            yield kind, time16, payload
+            pos += HEADER.size + size
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("file")
+    parser.add_argument("--prefix", help="prefix of the CSV files, default: name of the input file")
+    args = parser.parse_args()
+
+    with open(args.file, "rb") as f:
+        data = f.read()
+    prefix = args.prefix or os.path.splitext(args.file)[0]
+
+    outputs = {}
+    files = []
+
+    def writer(name, header):
+        if name not in outputs:
+            f = open("%s_%s.csv" % (prefix, name), "w", newline="")
+            files.append(f)
+            outputs[name] = csv.writer(f)
+            outputs[name].writerow(header)
+        return outputs[name]
+
+    clock = Clock()
+    counts = {}
+    dropped = 0
+    for kind, time16, payload in records(data):
+        counts[kind] = counts.get(kind, 0) + 1
+        if kind == BB_START:
+            _, _, _, tick, loop_ms, _ = START.unpack(payload[:START.size])
+            clock.sync(tick)
+            print("recording started at tick %d, loop period %d ms" % (tick, loop_ms))
+            continue
+        if kind == BB_SYNC:
+            tick, dropped = SYNC.unpack(payload[:SYNC.size])
+            clock.sync(tick)
+            continue
+
+        ms = clock.extend(time16)
+        if kind == BB_STICKS:
+            raw_roll, raw_pitch, roll, pitch, throttle, armed, _ = STICKS.unpack(payload[:STICKS.size])
+            writer("sticks", ["ms", "raw_roll", "raw_pitch", "roll", "pitch", "throttle", "armed"]).writerow(
+                [ms, raw_roll, raw_pitch, roll, pitch, throttle, armed])
+        elif kind == BB_FRAME:
+            writer("frames", ["ms", "size", "hex"]).writerow([ms, len(payload), payload.hex()])
+        elif kind == BB_TELEMETRY:
+            writer("telemetry", ["ms", "size", "hex"]).writerow([ms, len(payload), payload.hex()])
+        elif kind == BB_LINK:
+            writer("link", ["ms"] + LINK_FIELDS).writerow([ms] + list(LINK.unpack(payload[:LINK.size])))
+
+    for f in files:
+        f.close()
+    names = {BB_START: "start", BB_SYNC: "sync", BB_STICKS: "sticks", BB_FRAME: "frames",
+             BB_TELEMETRY: "telemetry", BB_LINK: "link"}
+    print(", ".join("%s %d" % (names.get(k, "type %d" % k), n) for k, n in sorted(counts.items())))
+    print("%d records dropped on the controller" % dropped)
+
+
+if __name__ == "__main__":
+    main()
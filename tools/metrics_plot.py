@@ -0,0 +1,106 @@
+#!/usr/bin/env python3
+"""Polls the metrics snapshot of the controller console (UART0) and plots it live.
+
+Counters are plotted as rate per second, gauges as value. Histograms are printed
+as their latest bucket distribution.
+
+    python3 metrics_plot.py /dev/ttyACM0 frames_sent rts_stalls cpu_load
+    python3 metrics_plot.py COM5 --csv metrics.csv
+
+Requires pyserial and matplotlib.
+"""
+
+import argparse
+import collections
+import csv
+import sys
+import time
+
+import serial
+
+GAUGES = {"cpu_load", "link_up"}
+
+
+def command(port, cmd, prefix, timeout=1.0):
+    """Sends a console command and returns the fields of the answer line starting with prefix."""
+    port.reset_input_buffer()
+    port.write((cmd + "\r\n").encode("ascii"))
+    deadline = time.time() + timeout
+    while time.time() < deadline:
+        line = port.readline().decode("ascii", errors="replace").strip()
+        if line.startswith(prefix + ","):
+            return line.split(",")[1:]
+    raise TimeoutError("no answer to '%s'" % cmd)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("port", help="serial port of the debugger (virtual COM port)")
+    parser.add_argument("metrics", nargs="*", help="metrics to plot, default: all counters and gauges")
+    parser.add_argument("--baud", type=int, default=115200)
+    parser.add_argument("--interval", type=float, default=1.0, help="poll interval in s")
+    parser.add_argument("--window", type=int, default=120, help="number of polls shown")
+    parser.add_argument("--csv", help="also log every snapshot to this file")
+    args = parser.parse_args()
+
+    port = serial.Serial(args.port, args.baud, timeout=0.2)
+    names = command(port, "metrics names", "N")
+    scalars = [n for n in names if "[" not in n]
+    selected = args.metrics or scalars
+    unknown = [m for m in selected if m not in scalars]
+    if unknown:
+        sys.exit("unknown metrics: %s (known: %s)" % (", ".join(unknown), ", ".join(scalars)))
+
+    import matplotlib.pyplot as plt
+
+    plt.ion()
+    fig, ax = plt.subplots()
+    lines = {m: ax.plot([], [], label=m + ("" if m in GAUGES else " /s"))[0] for m in selected}
+    ax.set_xlabel("controller time [s]")
+    ax.legend(loc="upper left")
+    history = {m: collections.deque(maxlen=args.window) for m in selected}
+    times = collections.deque(maxlen=args.window)
+
+    writer = None
+    if args.csv:
+        logfile = open(args.csv, "w", newline="")
+        writer = csv.writer(logfile)
+        writer.writerow(["tick"] + names)
+
+    last = None
+    while plt.fignum_exists(fig.number):
+        try:
+            fields = command(port, "metrics raw", "M")
+        except TimeoutError as err:
+            print(err, file=sys.stderr)
+            continue
+        tick = int(fields[0])
+        values = dict(zip(names, (int(v) for v in fields[1:])))
+        if writer:
+            writer.writerow([tick] + fields[1:])
+
+        if last is not None and tick > last[0]:
+            dt = (tick - last[0]) / 1000.0
+            times.append(tick / 1000.0)
+            for m in selected:
+                if m in GAUGES:
+                    history[m].append(values[m])
+                else:
+                    history[m].append((values[m] - last[1][m]) / dt)
+            for m in selected:
+                lines[m].set_data(times, history[m])
+            ax.relim()
+            ax.autoscale_view()
+            fig.canvas.draw_idle()
+
+            hists = collections.OrderedDict()
+            for name in names:
+                if "[" in name:
+                    hists.setdefault(name.split("[")[0], []).append(values[name])
+            print("  ".join("%s %s" % (h, "/".join(str(b) for b in buckets)) for h, buckets in hists.items()))
+        last = (tick, values)
+        plt.pause(args.interval)
+
+
+if __name__ == "__main__":
+    main()
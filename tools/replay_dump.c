@@ -0,0 +1,104 @@
+/*
+ * replay_dump.c
+ *
+ *  Created on: 19.10.2026
+ *
+ *  Host build of the input replay (replay.c): reads the output of the console command
+ *  "replay dump" and prints the recorded events as CSV.
+ *
+ *    cc -std=c99 -I../local_inc -o replay_dump replay_dump.c ../replay.c
+ *    ./replay_dump capture.txt > inputs.csv
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <replay.h>
+
+#define LINE_SIZE   512
+
+static uint8_t buffer[REPLAY_RING_SIZE * 4];
+
+static int hex_value(char c)
+{
+    if(c >= '0' && c <= '9')
+    {
+        return c - '0';
+    }
+    if(c >= 'A' && c <= 'F')
+    {
+        return c - 'A' + 10;
+    }
+    if(c >= 'a' && c <= 'f')
+    {
+        return c - 'a' + 10;
+    }
+    return -1;
+}
+
+int main(int argc, char *argv[])
+{
+    char line[LINE_SIZE];
+    unsigned segSize, segCount, oldest, head, used, pos;
+    bool header = false;
+    uint32_t size = 0;
+    replay_ring_t ring;
+    replay_event_t event;
+    FILE *in;
+    char *p;
+
+    if(argc != 2)
+    {
+        fprintf(stderr, "usage: %s <capture of 'replay dump'>\n", argv[0]);
+        return 1;
+    }
+    in = fopen(argv[1], "r");
+    if(in == NULL)
+    {
+        perror(argv[1]);
+        return 1;
+    }
+
+    while(fgets(line, sizeof(line), in) != NULL)
+    {
+        if(sscanf(line, "RP,%u,%u,%u,%u,%u,%u", &segSize, &segCount, &oldest, &head, &used, &pos) == 6)
+        {
+            header = true;
+            size = 0;
+        }
+        else if(strncmp(line, "RD,", 3) == 0 && header)
+        {
+            for(p = &line[3]; hex_value(p[0]) >= 0 && hex_value(p[1]) >= 0 && size < sizeof(buffer); p += 2)
+            {
+                buffer[size++] = (hex_value(p[0]) << 4) | hex_value(p[1]);
+            }
+        }
+    }
+    fclose(in);
+
+    if(!header || segSize != REPLAY_SEG_SIZE || size != segSize * segCount)
+    {
+        fprintf(stderr, "no complete dump found (segment size %u, %u of %u bytes)\n",
+                segSize, size, segSize * segCount);
+        return 1;
+    }
+
+    //same ring state as on the target
+    replay_init(&ring, buffer, size);
+    ring.oldest = oldest;
+    ring.head = head;
+    ring.used = used;
+    ring.pos = pos;
+    replay_rewind(&ring);
+
+    printf("time_ms,type,raw_roll,raw_pitch,buttons,throttle,armed\n");
+    while(replay_next(&ring, &event))
+    {
+        printf("%u,%s,%u,%u,%u,%u,%u\n", event.time, (event.type == REPLAY_BUTTON) ? "button" : "sample",
+               event.roll, event.pitch, event.buttons, event.state & 0xFFFF, event.state >> 16);
+    }
+    return 0;
+}
@@ -0,0 +1,130 @@
+#!/usr/bin/env python3
+"""Converts the event trace of the controller (trace dump / trace stream) into a Chrome trace.
+
+The JSON opens in https://ui.perfetto.dev or chrome://tracing: one track per task, one track
+for the interrupts, semaphore posts as instant events.
+
+    python3 trace_to_perfetto.py dump.txt -o trace.json
+    python3 trace_to_perfetto.py --port /dev/ttyACM0 --stream 5 -o trace.json
+
+Reading from the port requires pyserial.
+"""
+
+import argparse
+import json
+import sys
+import time
+
+TASK_SWITCH, HWI_BEGIN, HWI_END, SEM_POST, MARK = range(1, 6)
+
+# exception numbers of tm4c1294ncpdt (hw_ints.h)
+VECTORS = {15: "SysTick", 21: "UART0", 22: "UART1", 30: "ADC0SS0", 31: "ADC0SS1", 35: "Timer0A",
+           37: "Timer1A", 39: "Timer2A", 70: "SSI2", 75: "UART6"}
+SEMAPHORES = ["sample_tick", "adc_done", "tx_frame", "exec_wake"]
+
+PID = 1
+HWI_TID = 1000
+
+
+def read_port(port, seconds, baud):
+    import serial
+
+    ser = serial.Serial(port, baud, timeout=0.5)
+    ser.reset_input_buffer()
+    ser.write(("trace stream %d\r\n" % seconds if seconds else "trace dump\r\n").encode("ascii"))
+    lines = []
+    deadline = time.time() + seconds + 30
+    while time.time() < deadline:
+        line = ser.readline().decode("ascii", errors="replace").strip()
+        lines.append(line)
+        if line == "TE":
+            break
+    return lines
+
+
+def parse(lines):
+    """Returns (frequency, task names, records as (time, arg, type), lost records)."""
+    freq = None
+    names = {}
+    records = []
+    lost = 0
+    for line in lines:
+        fields = line.strip().split(",")
+        if fields[0] == "T":
+            freq = int(fields[1])
+            lost += int(fields[3])
+        elif fields[0] == "TN":
+            names[int(fields[1])] = fields[2]
+        elif fields[0] == "TL":
+            lost += int(fields[1])
+        elif fields[0] == "TR":
+            data = fields[1]
+            for pos in range(0, len(data) - 13, 14):
+                records.append((int(data[pos:pos + 8], 16), int(data[pos + 8:pos + 12], 16),
+                                int(data[pos + 12:pos + 14], 16)))
+    if freq is None:
+        sys.exit("no trace header (T,...) found")
+    return freq, names, records, lost
+
+
+def convert(freq, names, records):
+    events = [{"ph": "M", "pid": PID, "name": "process_name", "args": {"name": "copter controller"}},
+              {"ph": "M", "pid": PID, "tid": HWI_TID, "name": "thread_name", "args": {"name": "interrupts"}}]
+    for index, name in names.items():
+        events.append({"ph": "M", "pid": PID, "tid": index, "name": "thread_name",
+                       "args": {"name": "%s (%d)" % (name, index)}})
+
+    # the 32 bit timestamp wraps, records are in order so every step backwards is a wrap
+    base = 0
+    prev = None
+    current = None
+    start = 0.0
+    for raw, arg, kind in records:
+        if prev is not None and raw < prev:
+            base += 1 << 32
+        prev = raw
+        us = (base + raw) * 1e6 / freq
+
+        if kind == TASK_SWITCH:
+            if current is not None:
+                events.append({"ph": "X", "pid": PID, "tid": current, "ts": start, "dur": us - start,
+                               "name": names.get(current, "task %d" % current)})
+            current = arg
+            start = us
+        elif kind in (HWI_BEGIN, HWI_END):
+            events.append({"ph": "B" if kind == HWI_BEGIN else "E", "pid": PID, "tid": HWI_TID, "ts": us,
+                           "name": VECTORS.get(arg, "vector %d" % arg)})
+        elif kind == SEM_POST:
+            events.append({"ph": "i", "s": "t", "pid": PID, "tid": current if current is not None else HWI_TID,
+                           "ts": us, "name": "post " + (SEMAPHORES[arg] if arg < len(SEMAPHORES) else str(arg))})
+        elif kind == MARK:
+            events.append({"ph": "i", "s": "g", "pid": PID, "ts": us, "name": "mark %d" % arg})
+    return events
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("input", nargs="?", help="captured console output, default: stdin")
+    parser.add_argument("--port", help="read directly from the console port")
+    parser.add_argument("--stream", type=int, default=0, help="stream for this many seconds instead of a dump")
+    parser.add_argument("--baud", type=int, default=115200)
+    parser.add_argument("-o", "--output", default="trace.json")
+    args = parser.parse_args()
+
+    if args.port:
+        lines = read_port(args.port, args.stream, args.baud)
+    elif args.input:
+        with open(args.input) as f:
+            lines = f.readlines()
+    else:
+        lines = sys.stdin.readlines()
+
+    freq, names, records, lost = parse(lines)
+    events = convert(freq, names, records)
+    with open(args.output, "w") as f:
+        json.dump({"traceEvents": events, "displayTimeUnit": "ns"}, f)
+    print("%d records, %d lost, written to %s" % (len(records), lost, args.output))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,261 @@
+#!/usr/bin/env python3
+"""Ground station for the UDP bridge of the controller (udpbridge.c), and a simulated controller.
+
+    python3 udp_station.py 192.168.10.2                         print the telemetry as CSV lines
+    python3 udp_station.py 192.168.10.2 --input 1500,1500,1200,1 fly from the PC at --rate Hz
+    python3 udp_station.py 192.168.10.2 --msp 244d3c00646400
+    python3 udp_station.py --loopback --duration 5              station against a simulated controller
+
+Every line: station time in ms, record type, decoded fields. Frame records carry the seq of the
+remote input they were built from, the round trip (input sent -> packet to the copter reported back)
+is printed with them. The loopback mode runs the controller side of the protocol in a thread on
+127.0.0.1 and prints a summary: datagrams, losses and round trips.
+The handset takes the remote input over from the sticks only disarmed: the first input has armed 0,
+the sweep arms after SWEEP_ARM_S. After a button press it refuses the input until "remote on".
+The protocol is described in local_inc/udpbridge.h, the record payloads in local_inc/blackbox.h.
+"""
+
+import argparse
+import math
+import socket
+import struct
+import sys
+import threading
+import time
+
+NET_PORT = 5760
+NET_MAGIC = 0x4243
+NET_VERSION = 1
+NET_TELEMETRY, NET_INPUT, NET_MSP, NET_HELLO = range(1, 5)
+NET_PERIOD_MS = 20
+NET_LINK_PERIOD_MS = 100
+JS_REMOTE_TIMEOUT_MS = 500
+SWEEP_ARM_S = 0.5
+NET_PEER_TIMEOUT_MS = 2000
+NET_VALUE_MIN, NET_VALUE_MAX = 1000, 2000
+
+BB_STICKS, BB_FRAME, BB_TELEMETRY, BB_LINK = 3, 4, 5, 6
+NET_REC_FRAME_INFO = 0x10
+
+HEADER = struct.Struct("<HBBII")
+RECORD = struct.Struct("<BBH")
+INPUT = struct.Struct("<HHHBB")
+STICKS = struct.Struct("<HHHHHBB")
+LINK = struct.Struct("<8I")
+FRAME_INFO = struct.Struct("<IIIHHBBH")
+
+
+def now_ms():
+    return int(time.monotonic() * 1000) & 0xFFFFFFFF
+
+
+def datagram(kind, seq, payload=b""):
+    return HEADER.pack(NET_MAGIC, NET_VERSION, kind, seq, now_ms()) + payload
+
+
+def records(data):
+    """Yields (type, time16, payload) of a telemetry datagram."""
+    pos = HEADER.size
+    while pos + RECORD.size <= len(data):
+        kind, size, time16 = RECORD.unpack_from(data, pos)
+        yield kind, time16, data[pos + RECORD.size:pos + RECORD.size + size]
+        pos += RECORD.size + size
+
+
+def build_rc_frame(roll, pitch, throttle, armed):
+    """MSP_SET_RAW_RC as build_rc_frame in bluetooth.c."""
+    aux = 2000 if armed else 1000
+    data = struct.pack("<HHHHH", pitch, roll, throttle, 1500, aux)
+    body = bytes([10, 200]) + data
+    checksum = 0
+    for byte in body:
+        checksum ^= byte
+    return b"$M<" + body + bytes([checksum])
+
+
+class SimulatedController(threading.Thread):
+    """Controller side of the protocol: learns the station, applies the inputs, publishes records."""
+
+    def __init__(self, port):
+        super().__init__(daemon=True)
+        self.sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+        self.sock.bind(("127.0.0.1", port))
+        self.sock.settimeout(NET_PERIOD_MS / 1000)
+        self.peer = None
+        self.peer_seq = self.peer_tick = 0
+        self.seq = 0
+        self.block = []
+        self.input = (1500, 1500, 1000, 0)
+        self.input_seq = self.input_time = self.input_tick = 0
+        self.packets = 0
+        self.running = True
+
+    def put(self, kind, payload):
+        self.block.append(RECORD.pack(kind, len(payload), now_ms() & 0xFFFF) + payload)
+
+    def run(self):
+        last_flush = last_link = last_sample = now_ms()
+        while self.running:
+            try:
+                data, sender = self.sock.recvfrom(2048)
+                self.execute(data, sender)
+            except socket.timeout:
+                pass
+            tick = now_ms()
+            if self.peer is None:
+                continue
+            if tick - last_sample >= 50:
+                last_sample = tick
+                self.sample(tick)
+            if tick - last_link >= NET_LINK_PERIOD_MS:
+                last_link = tick
+                self.put(BB_LINK, LINK.pack(1, self.packets, 0, 0, 0, 0, 0, 12))
+            if tick - last_flush >= NET_PERIOD_MS and self.block:
+                last_flush = tick
+                self.sock.sendto(datagram(NET_TELEMETRY, self.seq, b"".join(self.block)), self.peer)
+                self.seq += 1
+                self.block = []
+
+    def execute(self, data, sender):
+        if len(data) < HEADER.size:
+            return
+        magic, version, kind, seq, stamp = HEADER.unpack_from(data)
+        if magic != NET_MAGIC or version != NET_VERSION:
+            return
+        if self.peer is not None and sender != self.peer:
+            if now_ms() - self.peer_tick < NET_PEER_TIMEOUT_MS:
+                return
+            self.peer = None
+        if self.peer is not None and not 0 < (seq - self.peer_seq) & 0xFFFFFFFF < 0x80000000:
+            return  # not above the last seq of the station
+        if kind == NET_INPUT and len(data) >= HEADER.size + INPUT.size:
+            values = INPUT.unpack_from(data, HEADER.size)[:4]
+            if not all(NET_VALUE_MIN <= value <= NET_VALUE_MAX for value in values[:3]):
+                return
+            remote = self.input_tick and now_ms() - self.input_tick < JS_REMOTE_TIMEOUT_MS
+            if remote or not values[3]:  # an armed take-over of the sticks is refused
+                self.input = values
+                self.input_seq, self.input_time, self.input_tick = seq, stamp, now_ms()
+        self.peer, self.peer_seq, self.peer_tick = sender, seq, now_ms()
+
+    def sample(self, tick):
+        roll, pitch, throttle, armed = self.input
+        if tick - self.input_tick >= JS_REMOTE_TIMEOUT_MS:
+            roll, pitch, throttle, armed = 1500, 1500, 1000, 0
+        self.put(BB_STICKS, STICKS.pack(2048, 2048, roll, pitch, throttle, armed, 0))
+        packet = build_rc_frame(roll, pitch, throttle, armed)
+        self.put(BB_FRAME, packet)
+        self.put(NET_REC_FRAME_INFO, FRAME_INFO.pack(self.packets, self.input_seq, self.input_time,
+                                                     (tick - self.input_tick) & 0xFFFF, 1400, len(packet), 1, 0))
+        self.packets += 1
+
+
+class Station:
+    def __init__(self, address, port, quiet):
+        self.sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+        self.sock.settimeout(0.01)
+        self.target = (address, port)
+        self.quiet = quiet
+        self.seq = 0
+        self.last_rx = None
+        self.datagrams = self.lost = 0
+        self.round_trips = []
+
+    def send(self, kind, payload=b""):
+        self.sock.sendto(datagram(kind, self.seq, payload), self.target)
+        self.seq += 1
+
+    def receive(self):
+        try:
+            data, _ = self.sock.recvfrom(2048)
+        except socket.timeout:
+            return
+        if len(data) < HEADER.size:
+            return
+        magic, version, kind, seq, _ = HEADER.unpack_from(data)
+        if magic != NET_MAGIC or kind != NET_TELEMETRY:
+            return
+        if self.last_rx is not None and seq != self.last_rx + 1:
+            self.lost += seq - self.last_rx - 1
+        self.last_rx = seq
+        self.datagrams += 1
+        for kind, _, payload in records(data):
+            self.record(kind, payload)
+
+    def record(self, kind, payload):
+        if kind == NET_REC_FRAME_INFO and len(payload) >= FRAME_INFO.size:
+            packet, input_seq, input_time, age, send_us, size, frames, _ = FRAME_INFO.unpack_from(payload)
+            rtt = (now_ms() - input_time) & 0xFFFFFFFF if input_seq or input_time else None
+            if rtt is not None:
+                self.round_trips.append(rtt)
+            self.line("frame_info,%d,%d,%s,%d,%d,%d,%d" % (packet, input_seq, rtt, age, send_us, size, frames))
+        elif kind == BB_STICKS and len(payload) >= STICKS.size:
+            self.line("sticks," + ",".join(str(v) for v in STICKS.unpack_from(payload)[:6]))
+        elif kind == BB_FRAME:
+            self.line("frame,%s" % payload.hex())
+        elif kind == BB_TELEMETRY:
+            self.line("telemetry,%s" % payload.hex())
+        elif kind == BB_LINK and len(payload) >= LINK.size:
+            self.line("link," + ",".join(str(v) for v in LINK.unpack_from(payload)))
+
+    def line(self, text):
+        if not self.quiet:
+            print("%d,%s" % (now_ms(), text))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("address", nargs="?", help="address of the controller")
+    parser.add_argument("--port", type=int, default=NET_PORT)
+    parser.add_argument("--input", help="roll,pitch,throttle,armed sent at --rate")
+    parser.add_argument("--rate", type=float, default=50.0, help="remote inputs per second")
+    parser.add_argument("--msp", action="append", default=[], help="MSP frame (hex) for the copter")
+    parser.add_argument("--duration", type=float, help="seconds, default: until Ctrl-C")
+    parser.add_argument("--loopback", action="store_true", help="against a simulated controller on 127.0.0.1")
+    parser.add_argument("--quiet", action="store_true", help="only the summary")
+    args = parser.parse_args()
+
+    if args.loopback:
+        controller = SimulatedController(args.port)
+        controller.start()
+        args.address = "127.0.0.1"
+        if args.input is None:
+            args.input = "sweep"
+        if args.duration is None:
+            args.duration = 5.0
+    elif args.address is None:
+        parser.error("address or --loopback required")
+
+    station = Station(args.address, args.port, args.quiet)
+    station.send(NET_HELLO)
+    for msp in args.msp:
+        station.send(NET_MSP, bytes.fromhex(msp))
+
+    start = time.monotonic()
+    next_input = start
+    try:
+        while args.duration is None or time.monotonic() - start < args.duration:
+            if args.input and time.monotonic() >= next_input:
+                next_input += 1.0 / args.rate
+                if args.input == "sweep":
+                    phase = (time.monotonic() - start) * 2 * math.pi / 4
+                    values = (1500 + int(400 * math.sin(phase)), 1500 + int(400 * math.cos(phase)), 1300,
+                              int(time.monotonic() - start >= SWEEP_ARM_S))
+                else:
+                    values = tuple(int(v) for v in args.input.split(","))
+                station.send(NET_INPUT, INPUT.pack(values[0], values[1], values[2], values[3], 0))
+            station.receive()
+    except KeyboardInterrupt:
+        pass
+
+    trips = sorted(station.round_trips)
+    print("%d datagrams, %d lost" % (station.datagrams, station.lost), file=sys.stderr)
+    if trips:
+        print("round trip input -> packet: min %d ms, median %d ms, max %d ms (%d packets)"
+              % (trips[0], trips[len(trips) // 2], trips[-1], len(trips)), file=sys.stderr)
+    if args.loopback and (station.datagrams == 0 or not trips):
+        sys.exit("loopback failed: no telemetry or no remote input reported back")
+
+
+if __name__ == "__main__":
+    main()
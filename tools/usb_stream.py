@@ -0,0 +1,126 @@
+#!/usr/bin/env python3
+"""Reads the USB telemetry stream of the controller (virtual COM port) and prints it as CSV lines.
+
+    python3 usb_stream.py /dev/ttyACM0
+    python3 usb_stream.py COM7 --types sticks,link
+    python3 usb_stream.py /dev/ttyACM0 --msp 244d3c0064006400 > stream.csv
+
+Every line: host time in ms, sequence number, type, decoded fields.
+Lost frames (gaps in the sequence number) are reported on stderr.
+The frame format is described in local_inc/usbcdc.h, the payloads in local_inc/blackbox.h.
+Needs pyserial.
+"""
+
+import argparse
+import struct
+import sys
+import time
+
+import serial
+
+BB_PAD, BB_START, BB_SYNC, BB_STICKS, BB_FRAME, BB_TELEMETRY, BB_LINK = range(7)
+USB_SYNC = 0xA5
+USB_CMD_MSP = 0x80
+USB_CMD_STREAM = 0x81
+MAX_PAYLOAD = 64
+
+STICKS = struct.Struct("<HHHHHBB")
+LINK = struct.Struct("<8I")
+
+TYPES = {"sticks": BB_STICKS, "frames": BB_FRAME, "telemetry": BB_TELEMETRY, "link": BB_LINK}
+
+
+def crc8(data):
+    crc = 0
+    for byte in data:
+        crc ^= byte
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x07) & 0xFF if crc & 0x80 else (crc << 1) & 0xFF
+    return crc
+
+
+def frame(kind, payload):
+    body = bytes([kind, len(payload), 0]) + payload
+    return bytes([USB_SYNC]) + body + bytes([crc8(body)])
+
+
+class Parser:
+    """Splits the byte stream into (type, seq, payload), resynchronizes on CRC errors."""
+
+    def __init__(self):
+        self.buffer = bytearray()
+        self.errors = 0
+
+    def feed(self, data):
+        self.buffer += data
+        while True:
+            start = self.buffer.find(USB_SYNC)
+            if start < 0:
+                self.buffer.clear()
+                return
+            del self.buffer[:start]
+            if len(self.buffer) < 4:
+                return
+            size = self.buffer[2]
+            if size > MAX_PAYLOAD:
+                self.errors += 1
+                del self.buffer[:1]
+                continue
+            if len(self.buffer) < 5 + size:
+                return
+            if crc8(self.buffer[1:4 + size]) != self.buffer[4 + size]:
+                self.errors += 1
+                del self.buffer[:1]
+                continue
+            yield self.buffer[1], self.buffer[3], bytes(self.buffer[4:4 + size])
+            del self.buffer[:5 + size]
+
+
+def decode(kind, payload):
+    if kind == BB_STICKS and len(payload) >= STICKS.size:
+        raw_roll, raw_pitch, roll, pitch, throttle, armed, _ = STICKS.unpack(payload[:STICKS.size])
+        return "sticks,%d,%d,%d,%d,%d,%d" % (raw_roll, raw_pitch, roll, pitch, throttle, armed)
+    if kind == BB_FRAME:
+        return "frame,%s" % payload.hex()
+    if kind == BB_TELEMETRY:
+        return "telemetry,%s" % payload.hex()
+    if kind == BB_LINK and len(payload) >= LINK.size:
+        return "link," + ",".join(str(v) for v in LINK.unpack(payload[:LINK.size]))
+    return "type%d,%s" % (kind, payload.hex())
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("port")
+    parser.add_argument("--types", help="comma separated subset of %s" % ",".join(TYPES))
+    parser.add_argument("--msp", action="append", default=[], help="MSP frame (hex) to send to the copter")
+    args = parser.parse_args()
+
+    port = serial.Serial(args.port, timeout=0.1)
+    if args.types:
+        mask = 0
+        for name in args.types.split(","):
+            mask |= 1 << TYPES[name]
+        port.write(frame(USB_CMD_STREAM, bytes([mask])))
+    for msp in args.msp:
+        port.write(frame(USB_CMD_MSP, bytes.fromhex(msp)))
+
+    stream = Parser()
+    start = time.monotonic()
+    last_seq = None
+    lost = 0
+    try:
+        while True:
+            for kind, seq, payload in stream.feed(port.read(4096)):
+                if last_seq is not None and seq != (last_seq + 1) & 0xFF:
+                    lost += (seq - last_seq - 1) & 0xFF
+                    print("lost %d frames so far" % lost, file=sys.stderr)
+                last_seq = seq
+                print("%d,%d,%s" % ((time.monotonic() - start) * 1000, seq, decode(kind, payload)))
+    except KeyboardInterrupt:
+        pass
+    print("%d frames lost, %d CRC errors" % (lost, stream.errors), file=sys.stderr)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,264 @@
+/*
+ * trace.c
+ *
+ *  Created on: 19.10.2026
+ *
+ *  Event trace in SRAM: task switches, Hwi begin/end and the posts of the main semaphores are
+ *  recorded with the 32 bit timestamp into a ring of TRACE_RING_SIZE records. The oldest records
+ *  are overwritten, recording costs a few cycles and never blocks.
+ *  The SYS/BIOS hooks are configured in application.cfg (Task.addHookSet, Hwi.addHookSet),
+ *  this needs no UIA and no logger, BIOS.logsEnabled stays false.
+ *  Console:
+ *    trace start|stop      enable/disable recording
+ *    trace dump            stops recording and prints the ring
+ *    trace stream <s>      prints new records every TRACE_STREAM_PERIOD_MS for s seconds
+ *  Output format:
+ *    T,<timestamp frequency>,<records>,<lost>  header
+ *    TN,<index>,<name>                         task names
+ *    TR,<tttttttt aaaa yy>...                  records in hex: time, arg, type
+ *    TL,<lost>                                 records overwritten before they were streamed
+ *    TE                                        end of the dump
+ *  tools/trace_to_perfetto.py converts it into a Chrome/Perfetto trace.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <inc/hw_ints.h>
+#include <inc/hw_nvic.h>
+#include <inc/hw_types.h>
+
+#include <xdc/std.h>
+#include <xdc/runtime/Error.h>
+#include <xdc/runtime/System.h>
+#include <xdc/runtime/Timestamp.h>
+#include <xdc/runtime/Types.h>
+
+#include <ti/sysbios/BIOS.h>
+#include <ti/sysbios/hal/Hwi.h>
+#include <ti/sysbios/knl/Clock.h>
+#include <ti/sysbios/knl/Task.h>
+
+#include <console.h>
+#include <ramfunc.h>
+#include <sysmon.h>
+#include <trace.h>
+
+#define TRACE_MAX_TASKS     16
+#define TRACE_REC_CHARS     14  //hex characters of one record
+
+static trace_rec_t ring[TRACE_RING_SIZE];
+static volatile uint32_t writeIndex = 0;   //total number of records, never wraps in practice
+static volatile bool enabled = true;
+static volatile uint16_t ignoredVector = 0; //the console UART while streaming, it would trace itself
+
+static Int hookId;
+static Task_Handle taskTable[TRACE_MAX_TASKS];
+static uint8_t taskCount = 0;
+
+static char line[3 + TRACE_DUMP_PER_LINE * TRACE_REC_CHARS + 3];
+
+//adds a record, can be called from Task, Swi and Hwi context
+RAMFUNC void trace_event(trace_type_t type, uint16_t arg)
+{
+    trace_rec_t *rec;
+    UInt key;
+
+    if(!enabled)
+    {
+        return;
+    }
+    key = Hwi_disable();
+    rec = &ring[writeIndex & (TRACE_RING_SIZE - 1)];
+    rec->time = Timestamp_get32();
+    rec->arg = arg;
+    rec->type = type;
+    writeIndex++;
+    Hwi_restore(key);
+}
+
+void trace_taskRegister(Int id)
+{
+    hookId = id;
+}
+
+//numbers every task in the order of creation, the index is the argument of the switch records
+void trace_taskCreate(Task_Handle task, Error_Block *eb)
+{
+    UInt key = Hwi_disable();
+    uint8_t index = taskCount;
+
+    if(taskCount < TRACE_MAX_TASKS)
+    {
+        taskTable[taskCount++] = task;
+    }
+    Hwi_restore(key);
+    Task_setHookContext(task, hookId, (Ptr)(uintptr_t)index);
+}
+
+void trace_taskSwitch(Task_Handle prev, Task_Handle next)
+{
+    trace_event(TRACE_TASK_SWITCH, (uint16_t)(uintptr_t)Task_getHookContext(next, hookId));
+}
+
+//the hooks run inside the dispatcher, the active vector of the NVIC identifies the interrupt
+RAMFUNC void trace_hwiBegin(Hwi_Handle hwi)
+{
+    uint16_t vector = HWREG(NVIC_INT_CTRL) & NVIC_INT_CTRL_VEC_ACT_M;
+
+    if(vector != ignoredVector)
+    {
+        trace_event(TRACE_HWI_BEGIN, vector);
+    }
+}
+
+RAMFUNC void trace_hwiEnd(Hwi_Handle hwi)
+{
+    uint16_t vector = HWREG(NVIC_INT_CTRL) & NVIC_INT_CTRL_VEC_ACT_M;
+
+    if(vector != ignoredVector)
+    {
+        trace_event(TRACE_HWI_END, vector);
+    }
+}
+
+static const char *task_name(uint8_t index)
+{
+    const char *name = sysmon_taskName(taskTable[index]);
+
+    if(name == NULL && taskTable[index] == Task_getIdleTask())
+    {
+        name = "idle";
+    }
+    return (name != NULL) ? name : "task";
+}
+
+static void print_header(uint32_t count, uint32_t lost)
+{
+    Types_FreqHz freq;
+    uint8_t i;
+
+    Timestamp_getFreq(&freq);
+    console_printf("T,%u,%u,%u\r\n", freq.lo, count, lost);
+    for(i = 0; i < taskCount; i++)
+    {
+        console_printf("TN,%u,%s\r\n", i, task_name(i));
+    }
+}
+
+static char *put_hex(char *pos, uint32_t value, uint8_t digits)
+{
+    static const char hex[] = "0123456789ABCDEF";
+
+    while(digits--)
+    {
+        *pos++ = hex[(value >> (digits * 4)) & 0xF];
+    }
+    return pos;
+}
+
+//prints the records from first up to last (exclusive), TRACE_DUMP_PER_LINE per line
+static void print_records(uint32_t first, uint32_t last)
+{
+    const trace_rec_t *rec;
+    char *pos;
+    uint8_t n;
+
+    while(first != last)
+    {
+        pos = line;
+        *pos++ = 'T';
+        *pos++ = 'R';
+        *pos++ = ',';
+        for(n = 0; n < TRACE_DUMP_PER_LINE && first != last; n++, first++)
+        {
+            rec = &ring[first & (TRACE_RING_SIZE - 1)];
+            pos = put_hex(pos, rec->time, 8);
+            pos = put_hex(pos, rec->arg, 4);
+            pos = put_hex(pos, rec->type, 2);
+        }
+        *pos++ = '\r';
+        *pos++ = '\n';
+        console_write(line, pos - line);
+    }
+}
+
+static void dump(void)
+{
+    uint32_t last;
+    uint32_t first;
+
+    enabled = false;
+    last = writeIndex;
+    first = (last > TRACE_RING_SIZE) ? last - TRACE_RING_SIZE : 0;
+    print_header(last - first, first);
+    print_records(first, last);
+    console_printf("TE\r\n");
+}
+
+//streams new records, the writer may overtake the reader, those records are reported as lost
+static void stream(uint32_t seconds)
+{
+    uint32_t end = Clock_getTicks() + seconds * 1000;
+    uint32_t next;
+    uint32_t last;
+
+    ignoredVector = INT_UART0;
+    enabled = true;
+    next = writeIndex;
+    print_header(0, 0);
+    while((int32_t)(Clock_getTicks() - end) < 0)
+    {
+        Task_sleep(TRACE_STREAM_PERIOD_MS);
+        last = writeIndex;
+        if(last - next > TRACE_RING_SIZE)
+        {
+            console_printf("TL,%u\r\n", last - next - TRACE_RING_SIZE);
+            next = last - TRACE_RING_SIZE;
+        }
+        print_records(next, last);
+        next = last;
+    }
+    ignoredVector = 0;
+    console_printf("TE\r\n");
+}
+
+static void cmd_trace(uint8_t argc, char *argv[])
+{
+    if(argc == 1)
+    {
+        console_printf("%s, %u records\r\n", enabled ? "recording" : "stopped", writeIndex);
+    }
+    else if(strcmp(argv[1], "start") == 0)
+    {
+        enabled = true;
+    }
+    else if(strcmp(argv[1], "stop") == 0)
+    {
+        enabled = false;
+    }
+    else if(strcmp(argv[1], "dump") == 0)
+    {
+        dump();
+    }
+    else if(strcmp(argv[1], "stream") == 0 && argc == 3)
+    {
+        stream(strtoul(argv[2], NULL, 0));
+    }
+    else
+    {
+        console_printf("usage: trace [start|stop|dump|stream <s>]\r\n");
+    }
+}
+
+static const console_cmd_t traceCmd = { "trace", "task/Hwi trace: start|stop|dump|stream <s>", cmd_trace };
+
+/*
+ *  Adds the trace command to the console, recording runs from the first task creation on
+ */
+void trace_start(void)
+{
+    console_addCommand(&traceCmd);
+}
@@ -0,0 +1,388 @@
+/*
+ * udpbridge.c
+ *
+ *  Created on: 19.10.2026
+ *
+ *  UDP bridge to a ground station over the on-board Ethernet (EMAC + NDK).
+ *  The controller listens on NET_PORT. The first station that sends a valid datagram receives
+ *  the telemetry: datagrams of records as in the blackbox (sticks, sent packets with a
+ *  net_frame_t each, telemetry of the copter, link metrics), see udpbridge.h.
+ *  Another host is ignored until the station was silent for NET_PEER_TIMEOUT_MS, datagrams of the
+ *  station with a seq not above the last one (reordered, repeated) are dropped.
+ *  The station sends NET_INPUT datagrams to fly from the PC (joystick_setRemote) and NET_MSP
+ *  datagrams with frames for the copter. The handset refuses the input while it is armed, for an
+ *  armed first input and after the pilot ended the remote input with a button (console "remote on").
+ *  Sending: udp_publish and udp_frameSent append the records with interrupts disabled into one of
+ *  two datagrams, the MSP bytes are copied from the packet buffer of the link TX task into it.
+ *  The bridge task hands the full datagram to sendto every NET_PERIOD_MS, which copies it once more
+ *  into the network buffers (NDK has no no-copy send for UDP): one staging copy plus the NDK copy.
+ *  Receiving: recvncfrom lends the driver frame to the task, it is parsed in place and freed.
+ *  The task is created once the stack has an IP address (udp_ipAddrHook, application.cfg).
+ *  tools/udp_station.py is the station and also simulates the controller on loopback.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include <xdc/std.h>
+#include <xdc/runtime/System.h>
+
+#include <ti/ndk/inc/netmain.h>
+
+#include <ti/sysbios/BIOS.h>
+#include <ti/sysbios/hal/Hwi.h>
+#include <ti/sysbios/knl/Clock.h>
+#include <ti/sysbios/knl/Task.h>
+
+#include <blackbox.h>
+#include <bluetooth.h>
+#include <console.h>
+#include <joystick.h>
+#include <sysmon.h>
+#include <tasks.h>
+#include <udpbridge.h>
+
+//datagrams: blocks[fillBlock] is filled by the producers, the other one is sent by the task
+static uint8_t blocks[2][NET_BLOCK_SIZE];
+static volatile uint8_t fillBlock = 0;
+static volatile uint16_t fillLen = sizeof(net_header_t);
+static uint32_t txSeq = 0;
+
+//the station: receiver of the telemetry and only accepted sender, only used by the bridge task
+//apart from peerValid
+static struct sockaddr_in peer;
+static volatile bool peerValid = false;
+static uint32_t peerSeq;        //seq of its latest valid datagram
+static uint32_t peerTick;       //Clock tick of its latest valid datagram
+
+//latest remote input, reported with every sent packet
+static uint32_t inputSeq = 0;
+static uint32_t inputTime = 0;
+static uint32_t inputTick = 0;
+static uint32_t packets = 0;
+
+static udp_stats_t stats;
+static uint32_t ipAddr = 0;
+
+static Task_Struct udpTaskStruct;
+static Char udpTaskStack[TASK_STACK_NET];
+static bool taskStarted = false;
+
+//appends a record to the filled datagram, interrupts must be disabled
+static bool put_locked(uint8_t type, const void *data, uint8_t size)
+{
+    bb_header_t header;
+
+    if(fillLen + sizeof(header) + size > NET_BLOCK_SIZE)
+    {
+        stats.txDropped++;
+        return false;
+    }
+    header.type = type;
+    header.size = size;
+    header.time = Clock_getTicks();
+    memcpy(&blocks[fillBlock][fillLen], &header, sizeof(header));
+    memcpy(&blocks[fillBlock][fillLen + sizeof(header)], data, size);
+    fillLen += sizeof(header) + size;
+    return true;
+}
+
+//adds a record to the next datagram, can be called from Task, Swi and Hwi context and never blocks
+void udp_publish(uint8_t type, const void *data, uint8_t size)
+{
+    UInt key;
+
+    if(!peerValid || size > NET_MAX_PAYLOAD)
+    {
+        return;
+    }
+    key = Hwi_disable();
+    put_locked(type, data, size);
+    Hwi_restore(key);
+}
+
+//called by the link TX task for every packet sent to the copter: the packet and its link metrics
+void udp_frameSent(const char *packet, uint8_t size, uint8_t frames, uint32_t sendUs)
+{
+    net_frame_t info;
+    UInt key;
+
+    if(!peerValid || size > NET_MAX_PAYLOAD)
+    {
+        return;
+    }
+    key = Hwi_disable();
+    info.packet = packets++;
+    info.inputSeq = inputSeq;
+    info.inputTime = inputTime;
+    info.inputAgeMs = Clock_getTicks() - inputTick;
+    info.sendUs = sendUs;
+    info.size = size;
+    info.frames = frames;
+    info.reserved = 0;
+    if(put_locked(BB_FRAME, packet, size))
+    {
+        put_locked(NET_REC_FRAME_INFO, &info, sizeof(info));
+    }
+    Hwi_restore(key);
+}
+
+void udp_getStats(udp_stats_t *copy)
+{
+    UInt key = Hwi_disable();
+    *copy = stats;
+    Hwi_restore(key);
+}
+
+//sends the filled datagram if it has records, the producers continue in the other one
+static void flush(SOCKET s)
+{
+    net_header_t *header;
+    uint8_t *block;
+    uint16_t length;
+    UInt key;
+
+    key = Hwi_disable();
+    if(fillLen == sizeof(net_header_t))
+    {
+        Hwi_restore(key);
+        return;
+    }
+    block = blocks[fillBlock];
+    length = fillLen;
+    fillBlock ^= 1;
+    fillLen = sizeof(net_header_t);
+    Hwi_restore(key);
+
+    header = (net_header_t *)block;
+    header->magic = NET_MAGIC;
+    header->version = NET_VERSION;
+    header->kind = NET_TELEMETRY;
+    header->seq = txSeq++;
+    header->time = Clock_getTicks();
+    if(sendto(s, block, length, 0, (PSA)&peer, sizeof(peer)) == length)
+    {
+        stats.txDatagrams++;
+    }
+}
+
+//true if the datagram comes from the station and is newer than its last one
+//another host takes over once the station was silent for NET_PEER_TIMEOUT_MS
+static bool accept_sender(const net_header_t *header, const struct sockaddr_in *from)
+{
+    if(peerValid && (peer.sin_addr.s_addr != from->sin_addr.s_addr || peer.sin_port != from->sin_port))
+    {
+        if(Clock_getTicks() - peerTick < NET_PEER_TIMEOUT_MS)
+        {
+            stats.rxRejected++;
+            return false;
+        }
+        peerValid = false; //silent station, the new one starts its own seq
+    }
+    if(peerValid && (int32_t)(header->seq - peerSeq) <= 0)
+    {
+        stats.rxStale++;
+        return false;
+    }
+    return true;
+}
+
+static bool in_range(uint16_t value)
+{
+    return value >= NET_VALUE_MIN && value <= NET_VALUE_MAX;
+}
+
+//executes a datagram of the station, the data stays in the driver frame
+static void execute(const uint8_t *data, int size, struct sockaddr_in *from)
+{
+    net_header_t header;
+    net_input_t input;
+    js_remote_t remote;
+    uint16_t payload;
+    UInt key;
+
+    if(size < (int)sizeof(header))
+    {
+        stats.rxErrors++;
+        return;
+    }
+    memcpy(&header, data, sizeof(header));
+    if(header.magic != NET_MAGIC || header.version != NET_VERSION)
+    {
+        stats.rxErrors++;
+        return;
+    }
+    if(!accept_sender(&header, from))
+    {
+        return;
+    }
+    data += sizeof(header);
+    payload = size - sizeof(header);
+
+    switch(header.kind)
+    {
+        case NET_INPUT:
+            if(payload < sizeof(input))
+            {
+                stats.rxErrors++;
+                return;
+            }
+            memcpy(&input, data, sizeof(input));
+            if(!in_range(input.roll) || !in_range(input.pitch) || !in_range(input.throttle))
+            {
+                stats.rxErrors++;
+                return;
+            }
+            remote.roll = input.roll;
+            remote.pitch = input.pitch;
+            remote.throttle = input.throttle;
+            remote.armed = input.armed != 0;
+            if(!joystick_setRemote(&remote))
+            {
+                stats.rxRefused++; //still the station, only its input is not taken
+                break;
+            }
+            key = Hwi_disable();
+            inputSeq = header.seq;
+            inputTime = header.time;
+            inputTick = Clock_getTicks();
+            Hwi_restore(key);
+            break;
+        case NET_MSP:
+            if(payload == 0 || payload > BT_PAYLOAD_MAX || !bt_queueFrame((const char *)data, payload))
+            {
+                stats.rxErrors++;
+                return;
+            }
+            break;
+        case NET_HELLO:
+            break;
+        default:
+            stats.rxErrors++;
+            return;
+    }
+    stats.rxDatagrams++;
+
+    peer = *from;
+    peerSeq = header.seq;
+    peerTick = Clock_getTicks();
+    peerValid = true;
+}
+
+/*
+ *  Bridge task: receives the datagrams of the station and sends the telemetry every NET_PERIOD_MS
+ */
+void udpBridge_fnx(UArg arg0, UArg arg1)
+{
+    struct sockaddr_in local;
+    struct sockaddr_in from;
+    struct timeval timeout;
+    uint32_t lastFlush = 0;
+    uint32_t lastLink = 0;
+    bb_link_t link;
+    HANDLE frame;
+    uint8_t *data;
+    int fromLen;
+    int size;
+    SOCKET s;
+
+    fdOpenSession(TaskSelf());
+
+    s = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if(s == INVALID_SOCKET)
+    {
+        System_printf("udp: no socket (%d)\n", fdError());
+        System_flush();
+        fdCloseSession(TaskSelf());
+        return;
+    }
+    memset(&local, 0, sizeof(local));
+    local.sin_family = AF_INET;
+    local.sin_addr.s_addr = INADDR_ANY;
+    local.sin_port = htons(NET_PORT);
+    timeout.tv_sec = 0;
+    timeout.tv_usec = NET_PERIOD_MS * 1000;
+    if(bind(s, (PSA)&local, sizeof(local)) < 0
+       || setsockopt(s, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout)) < 0)
+    {
+        System_printf("udp: binding port %u failed (%d)\n", NET_PORT, fdError());
+        System_flush();
+        fdClose(s);
+        fdCloseSession(TaskSelf());
+        return;
+    }
+
+    while(1)
+    {
+        fromLen = sizeof(from);
+        size = recvncfrom(s, (void **)&data, 0, (PSA)&from, &fromLen, &frame);
+        if(size >= 0)
+        {
+            execute(data, size, &from);
+            recvncfree(frame);
+        }
+
+        if(peerValid && Clock_getTicks() - lastLink >= NET_LINK_PERIOD_MS)
+        {
+            lastLink = Clock_getTicks();
+            blackbox_linkRecord(&link);
+            udp_publish(BB_LINK, &link, sizeof(link));
+        }
+        if(peerValid && Clock_getTicks() - lastFlush >= NET_PERIOD_MS)
+        {
+            lastFlush = Clock_getTicks();
+            flush(s);
+        }
+    }
+}
+
+/*
+ *  NDK hook (Global.networkIPAddrHook): starts the bridge task with the first IP address
+ */
+void udp_ipAddrHook(unsigned int addr, unsigned int ifIdx, unsigned int fAdd)
+{
+    ipAddr = fAdd ? ntohl(addr) : 0;
+    if(!fAdd || taskStarted)
+    {
+        return;
+    }
+    taskStarted = true;
+
+    Task_Params taskParams;
+    Task_Params_init(&taskParams);
+    taskParams.stack = &udpTaskStack;
+    taskParams.stackSize = sizeof(udpTaskStack);
+    taskParams.priority = TASK_PRIO_NET;
+    Task_construct(&udpTaskStruct, (Task_FuncPtr) udpBridge_fnx, &taskParams, NULL);
+
+    sysmon_registerTask(Task_handle(&udpTaskStruct), "udp");
+}
+
+static void cmd_udp(uint8_t argc, char *argv[])
+{
+    udp_stats_t copy;
+    uint32_t peerAddr = ntohl(peer.sin_addr.s_addr);
+
+    udp_getStats(&copy);
+    console_printf("address %u.%u.%u.%u:%u\r\n", (ipAddr >> 24) & 0xFF, (ipAddr >> 16) & 0xFF,
+                   (ipAddr >> 8) & 0xFF, ipAddr & 0xFF, NET_PORT);
+    if(peerValid)
+    {
+        console_printf("station %u.%u.%u.%u:%u\r\n", (peerAddr >> 24) & 0xFF, (peerAddr >> 16) & 0xFF,
+                       (peerAddr >> 8) & 0xFF, peerAddr & 0xFF, ntohs(peer.sin_port));
+    }
+    console_printf("tx %u datagrams (%u records dropped), rx %u datagrams (%u errors, %u stale, %u rejected, %u refused)\r\n",
+                   copy.txDatagrams, copy.txDropped, copy.rxDatagrams, copy.rxErrors, copy.rxStale, copy.rxRejected,
+                   copy.rxRefused);
+}
+
+static const console_cmd_t udpCmd = { "udp", "Ethernet ground station bridge state", cmd_udp };
+
+/*
+ *  Board_initEMAC must have been called, the task itself is started by udp_ipAddrHook
+ */
+void setUpUdpBridge(void)
+{
+    console_addCommand(&udpCmd);
+}
@@ -0,0 +1,417 @@
+/*
+ * usbcdc.c
+ *
+ *  Created on: 19.10.2026
+ *
+ *  USB device (CDC, virtual COM port on the USB OTG connector) as fast side channel for the bench.
+ *  The controller streams framed binary telemetry (usbcdc.h): stick samples, sent packets,
+ *  received telemetry and the link metrics every USB_LINK_PERIOD_MS. The PC can send MSP frames
+ *  for the copter and select the streamed types.
+ *  Sending is double buffered: usbcdc_send only copies the frame into the block that is filled
+ *  and wakes the USB task if nothing is in flight. The USB task starts the transmission, the USB
+ *  interrupt sends the other block packet by packet and swaps the blocks when it is done.
+ *  The producers never call into the USB stack and never wait, a frame that does not fit is dropped.
+ *  A packet the endpoint does not take (not idle) leaves txBusy clear, the USB task retries it.
+ *  usblib places the endpoint FIFOs itself, the two blocks provide the double buffering instead.
+ *  Received packets stay in the endpoint (the host gets NAKs) until the USB task read them.
+ *  tools/usb_stream.py decodes the stream on the PC.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include <inc/hw_ints.h>
+#include <usblib/usblib.h>
+#include <usblib/usbcdc.h>
+#include <usblib/usb-ids.h>
+#include <usblib/device/usbdevice.h>
+#include <usblib/device/usbdcdc.h>
+
+#include <xdc/std.h>
+#include <xdc/runtime/System.h>
+
+#include <ti/sysbios/BIOS.h>
+#include <ti/sysbios/hal/Hwi.h>
+#include <ti/sysbios/knl/Clock.h>
+#include <ti/sysbios/knl/Semaphore.h>
+#include <ti/sysbios/knl/Task.h>
+
+#include <blackbox.h>
+#include <bluetooth.h>
+#include <console.h>
+#include <sysmon.h>
+#include <tasks.h>
+#include <usbcdc.h>
+
+static uint32_t control_handler(void *cbData, uint32_t event, uint32_t msgValue, void *msgData);
+static uint32_t rx_handler(void *cbData, uint32_t event, uint32_t msgValue, void *msgData);
+static uint32_t tx_handler(void *cbData, uint32_t event, uint32_t msgValue, void *msgData);
+
+static const uint8_t langDescriptor[] = {
+    4, USB_DTYPE_STRING, USBShort(USB_LANG_EN_US)
+};
+static const uint8_t manufacturerString[] = {
+    (5 + 1) * 2, USB_DTYPE_STRING,
+    'T', 0, 'H', 0, 'W', 0, 'S', 0, 'B', 0
+};
+static const uint8_t productString[] = {
+    (16 + 1) * 2, USB_DTYPE_STRING,
+    'C', 0, 'o', 0, 'p', 0, 't', 0, 'e', 0, 'r', 0, ' ', 0, 'c', 0,
+    'o', 0, 'n', 0, 't', 0, 'r', 0, 'o', 0, 'l', 0, 'l', 0, 'e', 0
+};
+static const uint8_t serialNumberString[] = {
+    (4 + 1) * 2, USB_DTYPE_STRING,
+    '0', 0, '0', 0, '0', 0, '1', 0
+};
+static const uint8_t controlInterfaceString[] = {
+    (9 + 1) * 2, USB_DTYPE_STRING,
+    'T', 0, 'e', 0, 'l', 0, 'e', 0, 'm', 0, 'e', 0, 't', 0, 'r', 0, 'y', 0
+};
+static const uint8_t configString[] = {
+    (12 + 1) * 2, USB_DTYPE_STRING,
+    'S', 0, 'e', 0, 'l', 0, 'f', 0, ' ', 0, 'p', 0, 'o', 0, 'w', 0,
+    'e', 0, 'r', 0, 'e', 0, 'd', 0
+};
+static const uint8_t * const stringDescriptors[] = {
+    langDescriptor,
+    manufacturerString,
+    productString,
+    serialNumberString,
+    controlInterfaceString,
+    configString
+};
+
+static tUSBDCDCDevice cdcDevice = {
+    USB_VID_TI_1CBE,
+    USB_PID_SERIAL,
+    0,
+    USB_CONF_ATTR_SELF_PWR,
+    control_handler,
+    NULL,
+    rx_handler,
+    NULL,
+    tx_handler,
+    NULL,
+    stringDescriptors,
+    sizeof(stringDescriptors) / sizeof(stringDescriptors[0])
+};
+
+//the PC ignores the line coding, reported as 115200 8N1
+static tLineCoding lineCoding = { 115200, USB_CDC_STOP_BITS_1, USB_CDC_PARITY_NONE, 8 };
+
+static volatile bool connected = false;
+static volatile uint8_t streamMask = 0xFF;
+
+//transmit blocks: txFill is filled by usbcdc_send, the other one is sent while txBusy
+static uint8_t txBlocks[2][USB_TX_BLOCK_SIZE];
+static volatile uint8_t txFill = 0;
+static volatile uint16_t txFillLen = 0;
+static volatile bool txBusy = false;
+static uint16_t txSendLen;
+static uint16_t txSendPos;
+static bool txZeroPacket;           //the block ended with a full packet, the host needs a short one
+static uint8_t txSeq = 0;
+
+static usbcdc_stats_t stats;
+
+static Hwi_Struct usbHwi;
+static Semaphore_Struct usbSem;     //posted when a packet arrived or a frame waits to be sent
+static Task_Struct usbTaskStruct;
+static Char usbTaskStack[TASK_STACK_USB];
+
+static uint8_t crc8(uint8_t crc, const uint8_t *data, uint8_t size)
+{
+    uint8_t bit;
+
+    while(size--)
+    {
+        crc ^= *data++;
+        for(bit = 0; bit < 8; bit++)
+        {
+            crc = (crc & 0x80) ? (crc << 1) ^ 0x07 : crc << 1;
+        }
+    }
+    return crc;
+}
+
+//sends the next packet of the block in flight (a zero length one after a full last packet) or
+//hands the filled block to the USB and starts filling the other one, interrupts must be disabled
+//only called by the USB task and the USB interrupt, txBusy is set while a packet is with the controller
+static void send_next_locked(void)
+{
+    uint16_t size;
+
+    if(txSendPos == txSendLen && !txZeroPacket)
+    {
+        if(txFillLen == 0)
+        {
+            txBusy = false;
+            return;
+        }
+        txSendLen = txFillLen;
+        txSendPos = 0;
+        txFill ^= 1;
+        txFillLen = 0;
+    }
+    size = txSendLen - txSendPos;
+    if(size > USB_PACKET_SIZE)
+    {
+        size = USB_PACKET_SIZE;
+    }
+    //a write into a busy endpoint returns 0 and no TX_COMPLETE follows, the USB task retries
+    if(USBDCDCTxPacketAvailable(&cdcDevice) == 0
+       || USBDCDCPacketWrite(&cdcDevice, &txBlocks[txFill ^ 1][txSendPos], size, true) != size)
+    {
+        stats.txRetries++;
+        txBusy = false;
+        return;
+    }
+    txZeroPacket = (size == USB_PACKET_SIZE);
+    txSendPos += size;
+    txBusy = true;
+}
+
+//adds a frame to the stream, can be called from Task, Swi and Hwi context and never blocks
+void usbcdc_send(uint8_t type, const void *data, uint8_t size)
+{
+    uint8_t *frame;
+    UInt key;
+
+    if(!connected || type > 7 || !(streamMask & (1 << type)) || size > USB_MAX_PAYLOAD)
+    {
+        return;
+    }
+    key = Hwi_disable();
+    if(txFillLen + USB_FRAME_OVERHEAD + size > USB_TX_BLOCK_SIZE)
+    {
+        stats.txDropped++;
+        Hwi_restore(key);
+        return;
+    }
+    frame = &txBlocks[txFill][txFillLen];
+    frame[0] = USB_SYNC;
+    frame[1] = type;
+    frame[2] = size;
+    frame[3] = txSeq++;
+    memcpy(&frame[4], data, size);
+    frame[4 + size] = crc8(0, &frame[1], 3 + size);
+    txFillLen += USB_FRAME_OVERHEAD + size;
+    stats.txFrames++;
+    Hwi_restore(key);
+
+    if(!txBusy)
+    {
+        Semaphore_post(Semaphore_handle(&usbSem)); //the USB task starts the transmission
+    }
+}
+
+void usbcdc_getStats(usbcdc_stats_t *copy)
+{
+    UInt key = Hwi_disable();
+    *copy = stats;
+    Hwi_restore(key);
+}
+
+//USB interrupt: the previous packet is on its way, send the next one or the next block
+static uint32_t tx_handler(void *cbData, uint32_t event, uint32_t msgValue, void *msgData)
+{
+    UInt key;
+
+    if(event != USB_EVENT_TX_COMPLETE)
+    {
+        return 0;
+    }
+    key = Hwi_disable();
+    send_next_locked();
+    Hwi_restore(key);
+    return 0;
+}
+
+static uint32_t rx_handler(void *cbData, uint32_t event, uint32_t msgValue, void *msgData)
+{
+    if(event == USB_EVENT_RX_AVAILABLE)
+    {
+        Semaphore_post(Semaphore_handle(&usbSem));
+    }
+    return 0; //the packet is read by the USB task, the endpoint holds it meanwhile
+}
+
+static uint32_t control_handler(void *cbData, uint32_t event, uint32_t msgValue, void *msgData)
+{
+    UInt key;
+
+    switch(event)
+    {
+        case USB_EVENT_CONNECTED:
+            key = Hwi_disable();
+            txFillLen = 0;
+            txSendLen = 0;
+            txSendPos = 0;
+            txBusy = false;
+            txZeroPacket = false;
+            Hwi_restore(key);
+            connected = true;
+            break;
+        case USB_EVENT_DISCONNECTED:
+        case USB_EVENT_SUSPEND:
+            connected = false;
+            break;
+        case USB_EVENT_RESUME:
+            connected = true;
+            break;
+        case USBD_CDC_EVENT_GET_LINE_CODING:
+            *(tLineCoding *)msgData = lineCoding;
+            break;
+        case USBD_CDC_EVENT_SET_LINE_CODING:
+            lineCoding = *(tLineCoding *)msgData;
+            break;
+        default:
+            break;
+    }
+    return 0;
+}
+
+static void usb_hwi(UArg arg0)
+{
+    USB0DeviceIntHandler();
+}
+
+//executes a complete frame from the PC
+static void execute(uint8_t type, const uint8_t *payload, uint8_t size)
+{
+    switch(type)
+    {
+        case USB_CMD_MSP:
+            if(!bt_queueFrame((const char *)payload, size))
+            {
+                stats.rxErrors++; //TX queue full or frame too long
+                return;
+            }
+            break;
+        case USB_CMD_STREAM:
+            if(size == 1)
+            {
+                streamMask = payload[0];
+            }
+            break;
+        default:
+            stats.rxErrors++;
+            return;
+    }
+    stats.rxFrames++;
+}
+
+//frame parser, fed byte by byte, frames may span several packets
+static void parse(uint8_t c)
+{
+    static uint8_t frame[4 + USB_MAX_PAYLOAD + 1];
+    static uint8_t length = 0;
+
+    if(length == 0 && c != USB_SYNC)
+    {
+        return;
+    }
+    frame[length++] = c;
+    if(length == 3 && frame[2] > USB_MAX_PAYLOAD)
+    {
+        stats.rxErrors++;
+        length = 0;
+        return;
+    }
+    if(length < 4 || length < USB_FRAME_OVERHEAD + frame[2])
+    {
+        return;
+    }
+    if(crc8(0, &frame[1], 3 + frame[2]) == frame[4 + frame[2]])
+    {
+        execute(frame[1], &frame[4], frame[2]);
+    }
+    else
+    {
+        stats.rxErrors++;
+    }
+    length = 0;
+}
+
+/*
+ *  USB task: reads the packets of the PC, starts sending the stream and adds the link metrics to it
+ */
+void usbcdc_fnx(UArg arg0, UArg arg1)
+{
+    static uint8_t packet[USB_PACKET_SIZE];
+    uint32_t lastLink = 0;
+    uint32_t size;
+    uint32_t i;
+    bb_link_t link;
+    UInt key;
+
+    while(1)
+    {
+        Semaphore_pend(Semaphore_handle(&usbSem), USB_LINK_PERIOD_MS);
+        while(connected && (size = USBDCDCPacketRead(&cdcDevice, packet, sizeof(packet), true)) > 0)
+        {
+            for(i = 0; i < size; i++)
+            {
+                parse(packet[i]);
+            }
+        }
+        if(Clock_getTicks() - lastLink >= USB_LINK_PERIOD_MS)
+        {
+            lastLink = Clock_getTicks();
+            blackbox_linkRecord(&link);
+            usbcdc_send(BB_LINK, &link, sizeof(link));
+        }
+        key = Hwi_disable();
+        if(connected && !txBusy)
+        {
+            send_next_locked();
+        }
+        Hwi_restore(key);
+    }
+}
+
+static void cmd_usb(uint8_t argc, char *argv[])
+{
+    usbcdc_stats_t copy;
+
+    usbcdc_getStats(&copy);
+    console_printf("%s, stream mask 0x%02x, tx %u frames (%u dropped, %u retries), rx %u frames (%u errors)\r\n",
+                   connected ? "connected" : "not connected", streamMask, copy.txFrames, copy.txDropped,
+                   copy.txRetries, copy.rxFrames, copy.rxErrors);
+}
+
+static const console_cmd_t usbCmd = { "usb", "USB telemetry stream state", cmd_usb };
+
+/*
+ *  Starts the USB device and creates the USB task, Board_initUSB(Board_USBDEVICE) must have been called
+ */
+void setUpUsbCdc_Task(void)
+{
+    Hwi_Params hwiParams;
+    Hwi_Params_init(&hwiParams);
+    Hwi_construct(&usbHwi, INT_USB0, usb_hwi, &hwiParams, NULL);
+
+    Semaphore_Params semParams;
+    Semaphore_Params_init(&semParams);
+    semParams.mode = Semaphore_Mode_BINARY;
+    Semaphore_construct(&usbSem, 0, &semParams);
+
+    USBStackModeSet(0, eUSBModeForceDevice, 0);
+    if(USBDCDCInit(0, &cdcDevice) == NULL)
+    {
+        System_printf("Error initializing the USB device\n");
+        System_flush();
+        return;
+    }
+
+    Task_Params taskParams;
+    Task_Params_init(&taskParams);
+    taskParams.stack = &usbTaskStack;
+    taskParams.stackSize = sizeof(usbTaskStack);
+    taskParams.priority = TASK_PRIO_USB;
+    Task_construct(&usbTaskStruct, (Task_FuncPtr) usbcdc_fnx, &taskParams, NULL);
+
+    sysmon_registerTask(Task_handle(&usbTaskStruct), "usb");
+    console_addCommand(&usbCmd);
+}